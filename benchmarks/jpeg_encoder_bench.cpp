@@ -0,0 +1,107 @@
+// Compares the JPEG encoder backends on one frame.
+// Usage: bench_jpeg_encoder [width] [height] [iterations] [quality] [frame.bgra]
+// frame.bgra is a raw BGRA dump of a captured frame (e.g. a "raw" StreamFrames payload);
+// without it a synthetic frame is used.
+
+#include "jpeg_encoder.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool LoadFrame(const char *path, size_t expectedSize, std::vector<uint8_t> &frame) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        printf("Cannot open %s\n", path);
+        return false;
+    }
+    frame.resize(expectedSize);
+    file.read(reinterpret_cast<char *>(frame.data()), static_cast<std::streamsize>(expectedSize));
+    if (static_cast<size_t>(file.gcount()) != expectedSize) {
+        printf("%s is smaller than %zu bytes\n", path, expectedSize);
+        return false;
+    }
+    return true;
+}
+
+void Run(const JpegOptions &options, const std::vector<uint8_t> &frame, int width, int height,
+         int quality, int iterations, double &baselineMs) {
+    JpegEncoder encoder(options);
+    std::vector<uint8_t> out;
+
+    // Warm up: first call opens the codec / compressor
+    if (!encoder.Encode(frame.data(), width, height, quality, out)) {
+        printf("%-28s encode failed\n", options.Key().c_str());
+        return;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        encoder.Encode(frame.data(), width, height, quality, out);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+
+    if (baselineMs <= 0.0) {
+        baselineMs = ms;
+    }
+    printf("%-28s %8.3f ms  %8zu bytes  speedup %5.2fx\n", options.Key().c_str(), ms, out.size(),
+           baselineMs / ms);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    int width = argc > 1 ? atoi(argv[1]) : 1920;
+    int height = argc > 2 ? atoi(argv[2]) : 1080;
+    int iterations = argc > 3 ? atoi(argv[3]) : 100;
+    int quality = argc > 4 ? atoi(argv[4]) : 85;
+
+    std::vector<uint8_t> frame;
+    const size_t frameSize = static_cast<size_t>(width) * height * 4;
+    if (argc > 5) {
+        if (!LoadFrame(argv[5], frameSize, frame)) {
+            return 1;
+        }
+    } else {
+        // Gradients plus noise: compresses roughly like game footage
+        frame.resize(frameSize);
+        std::mt19937 rng(42);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                uint8_t *p = &frame[(static_cast<size_t>(y) * width + x) * 4];
+                p[0] = static_cast<uint8_t>(x * 255 / width + (rng() & 0x0F));
+                p[1] = static_cast<uint8_t>(y * 255 / height + (rng() & 0x0F));
+                p[2] = static_cast<uint8_t>((x ^ y) & 0xFF);
+                p[3] = 255;
+            }
+        }
+    }
+
+    printf("Frame: %dx%d BGRA (%s), quality %d, %d iterations\n\n", width, height,
+           argc > 5 ? argv[5] : "synthetic", quality, iterations);
+
+    const ChromaSubsampling subsamplings[] = {ChromaSubsampling::S420, ChromaSubsampling::S422,
+                                              ChromaSubsampling::S444};
+
+    // The first line (FFmpeg 4:2:0) is the baseline the speedups are relative to
+    double baselineMs = 0.0;
+    for (JpegBackend backend : {JpegBackend::FFmpeg, JpegBackend::TurboJpeg}) {
+        for (ChromaSubsampling subsampling : subsamplings) {
+            for (bool fastDct : {false, true}) {
+                JpegOptions options;
+                options.backend = backend;
+                options.subsampling = subsampling;
+                options.fastDct = fastDct;
+                Run(options, frame, width, height, quality, iterations, baselineMs);
+            }
+        }
+    }
+
+    return 0;
+}
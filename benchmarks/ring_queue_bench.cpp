@@ -0,0 +1,259 @@
+// Contention benchmark for RingQueue against the mutex + condition variable queue it replaced.
+// 1. Throughput with P producers and C consumers pushing small items as fast as they can.
+//    Every item is checked: nothing lost or duplicated, and each producer's items arrive in order.
+// 2. Handoff latency of one paced stage (an item every 200 us, like a pipeline handing frames
+//    over) while other threads saturate their own queues, i.e. with the machine under load.
+// Usage: bench_ring_queue [items_per_producer] [load_pairs]
+
+#include "ring_queue.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Item {
+    uint32_t producer = 0;
+    uint32_t sequence = 0;
+    int64_t pushedNs = 0;
+};
+
+int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch())
+        .count();
+}
+
+// The previous BoundedQueue: one mutex, two condition variables, one item per pop
+template <typename T> class MutexQueue {
+  public:
+    explicit MutexQueue(size_t capacity) : capacity_(capacity), closed_(false) {}
+
+    bool push(T &&item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notFull_.wait(lock, [this] { return queue_.size() < capacity_ || closed_; });
+        if (closed_) {
+            return false;
+        }
+        queue_.push(std::move(item));
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    size_t pop_n(T *out, size_t max) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notEmpty_.wait(lock, [this] { return !queue_.empty() || closed_; });
+        if (queue_.empty() || max == 0) {
+            return 0;
+        }
+        out[0] = std::move(queue_.front());
+        queue_.pop();
+        notFull_.notify_one();
+        return 1;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+  private:
+    std::queue<T> queue_;
+    size_t capacity_;
+    std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    bool closed_;
+};
+
+struct ThroughputResult {
+    double itemsPerSecond;
+    bool ok;
+};
+
+template <typename Queue>
+ThroughputResult RunThroughput(int producers, int consumers, uint32_t itemsPerProducer,
+                               size_t batch) {
+    Queue queue(1024);
+    std::vector<std::vector<uint32_t>> lastSeen(consumers,
+                                                std::vector<uint32_t>(producers, 0));
+    std::vector<uint64_t> received(consumers, 0);
+    std::atomic<bool> ordered{true};
+
+    auto start = Clock::now();
+    std::vector<std::thread> consumerThreads;
+    for (int c = 0; c < consumers; ++c) {
+        consumerThreads.emplace_back([&, c] {
+            std::vector<Item> items(batch);
+            size_t n;
+            while ((n = queue.pop_n(items.data(), batch)) > 0) {
+                for (size_t i = 0; i < n; ++i) {
+                    // Sequences start at 1, so each consumer sees a rising subsequence
+                    uint32_t &last = lastSeen[c][items[i].producer];
+                    if (items[i].sequence <= last) {
+                        ordered = false;
+                    }
+                    last = items[i].sequence;
+                }
+                received[c] += n;
+            }
+        });
+    }
+
+    std::vector<std::thread> producerThreads;
+    for (int p = 0; p < producers; ++p) {
+        producerThreads.emplace_back([&, p] {
+            for (uint32_t i = 1; i <= itemsPerProducer; ++i) {
+                Item item;
+                item.producer = static_cast<uint32_t>(p);
+                item.sequence = i;
+                queue.push(std::move(item));
+            }
+        });
+    }
+    for (auto &thread : producerThreads) {
+        thread.join();
+    }
+    queue.close();
+    for (auto &thread : consumerThreads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    uint64_t total = 0;
+    for (uint64_t count : received) {
+        total += count;
+    }
+    bool ok = ordered && total == static_cast<uint64_t>(producers) * itemsPerProducer;
+    return {total / seconds, ok};
+}
+
+struct LatencyResult {
+    double p50Us;
+    double p99Us;
+    double maxUs;
+};
+
+template <typename Queue> LatencyResult RunLatency(int loadPairs, int samples) {
+    // Background stages hammering their own queues
+    std::atomic<bool> stopLoad{false};
+    std::vector<std::unique_ptr<Queue>> loadQueues;
+    std::vector<std::thread> loadThreads;
+    for (int i = 0; i < loadPairs; ++i) {
+        loadQueues.push_back(std::make_unique<Queue>(64));
+        Queue *queue = loadQueues.back().get();
+        loadThreads.emplace_back([queue, &stopLoad] {
+            while (!stopLoad) {
+                queue->push(Item());
+            }
+        });
+        loadThreads.emplace_back([queue] {
+            Item items[16];
+            while (queue->pop_n(items, 16) > 0) {
+            }
+        });
+    }
+
+    Queue queue(16);
+    std::vector<double> latenciesUs;
+    latenciesUs.reserve(samples);
+    std::thread consumer([&] {
+        Item item;
+        while (queue.pop_n(&item, 1) > 0) {
+            latenciesUs.push_back((NowNs() - item.pushedNs) / 1000.0);
+        }
+    });
+
+    auto next = Clock::now();
+    for (int i = 0; i < samples; ++i) {
+        next += std::chrono::microseconds(200);
+        while (Clock::now() < next) {
+        }
+        Item item;
+        item.pushedNs = NowNs();
+        queue.push(std::move(item));
+    }
+    queue.close();
+    consumer.join();
+
+    stopLoad = true;
+    for (auto &loadQueue : loadQueues) {
+        loadQueue->close();
+    }
+    for (auto &thread : loadThreads) {
+        thread.join();
+    }
+
+    std::sort(latenciesUs.begin(), latenciesUs.end());
+    size_t n = latenciesUs.size();
+    return {latenciesUs[n / 2], latenciesUs[std::min(n - 1, n * 99 / 100)], latenciesUs[n - 1]};
+}
+
+using SpscQueue = RingQueue<Item, QueueConcurrency::Spsc>;
+using MpmcQueue = RingQueue<Item, QueueConcurrency::Mpmc>;
+
+void PrintThroughput(const char *name, int producers, int consumers, size_t batch,
+                     const ThroughputResult &result) {
+    printf("  %-22s %dx%-2d batch %-3zu %8.2f M items/s  %s\n", name, producers, consumers,
+           batch, result.itemsPerSecond / 1e6, result.ok ? "ok" : "FAILED");
+}
+
+void PrintLatency(const char *name, const LatencyResult &result) {
+    printf("  %-22s p50 %7.1f us  p99 %7.1f us  max %8.1f us\n", name, result.p50Us,
+           result.p99Us, result.maxUs);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    uint32_t items = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 1000000;
+    int maxLoadPairs = argc > 2 ? atoi(argv[2])
+                                : static_cast<int>(std::thread::hardware_concurrency());
+    bool ok = true;
+
+    printf("Throughput (%u items per producer, capacity 1024)\n", items);
+    {
+        auto result = RunThroughput<MutexQueue<Item>>(1, 1, items, 1);
+        PrintThroughput("mutex", 1, 1, 1, result);
+        ok &= result.ok;
+        result = RunThroughput<SpscQueue>(1, 1, items, 1);
+        PrintThroughput("ring spsc", 1, 1, 1, result);
+        ok &= result.ok;
+        result = RunThroughput<SpscQueue>(1, 1, items, 32);
+        PrintThroughput("ring spsc pop_n", 1, 1, 32, result);
+        ok &= result.ok;
+    }
+    for (int threads : {1, 2, 4, 8}) {
+        auto result = RunThroughput<MutexQueue<Item>>(threads, threads, items, 1);
+        PrintThroughput("mutex", threads, threads, 1, result);
+        ok &= result.ok;
+        result = RunThroughput<MpmcQueue>(threads, threads, items, 1);
+        PrintThroughput("ring mpmc", threads, threads, 1, result);
+        ok &= result.ok;
+        result = RunThroughput<MpmcQueue>(threads, threads, items, 32);
+        PrintThroughput("ring mpmc pop_n", threads, threads, 32, result);
+        ok &= result.ok;
+    }
+
+    printf("\nPaced handoff latency (one item every 200 us) with saturating load pairs\n");
+    for (int pairs = 0; pairs <= maxLoadPairs; pairs = pairs == 0 ? 1 : pairs * 2) {
+        printf(" load pairs: %d\n", pairs);
+        PrintLatency("mutex", RunLatency<MutexQueue<Item>>(pairs, 5000));
+        PrintLatency("ring spsc", RunLatency<SpscQueue>(pairs, 5000));
+    }
+
+    return ok ? 0 : 1;
+}
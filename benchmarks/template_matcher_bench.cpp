@@ -0,0 +1,171 @@
+// Detection check and benchmark for TemplateMatcher on synthetic frames: templates cut from a
+// known position are planted in a noisy scene and must be found at that position with the scalar
+// and AVX2 kernels.
+// Usage: bench_template_matcher [width] [height] [iterations]
+
+#include "template_matcher.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Case {
+    const char *label;
+    int32_t width;
+    int32_t height;
+    MatchMethod method;
+    int pyramidLevels;
+    int brightness; // Added to the planted copy; NCC should not care
+    bool useRegion; // Restrict the search to a window around the target
+};
+
+// Blocky noise: HUD-like edges at several scales, so coarse pyramid levels keep some structure
+std::vector<uint8_t> MakeScene(int width, int height, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> frame(static_cast<size_t>(width) * height * 4);
+    const int block = 4;
+    std::vector<uint8_t> blocks(static_cast<size_t>((width + block - 1) / block) *
+                                ((height + block - 1) / block) * 3);
+    for (auto &v : blocks) {
+        v = static_cast<uint8_t>(rng());
+    }
+    const int blocksPerRow = (width + block - 1) / block;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const uint8_t *b = &blocks[((y / block) * blocksPerRow + x / block) * 3];
+            uint8_t *p = &frame[(static_cast<size_t>(y) * width + x) * 4];
+            p[0] = static_cast<uint8_t>(b[0] / 2 + (rng() & 63));
+            p[1] = static_cast<uint8_t>(b[1] / 2 + (rng() & 63));
+            p[2] = static_cast<uint8_t>(b[2] / 2 + (rng() & 63));
+            p[3] = 255;
+        }
+    }
+    return frame;
+}
+
+// Copy a w x h patch from one scene into the frame at (x, y), shifted in brightness
+void Plant(const std::vector<uint8_t> &patchScene, int sceneWidth, std::vector<uint8_t> &frame,
+           int frameWidth, int x, int y, int w, int h, int brightness,
+           std::vector<uint8_t> &templ) {
+    templ.resize(static_cast<size_t>(w) * h * 4);
+    for (int ty = 0; ty < h; ++ty) {
+        for (int tx = 0; tx < w; ++tx) {
+            const uint8_t *src = &patchScene[(static_cast<size_t>(ty) * sceneWidth + tx) * 4];
+            uint8_t *t = &templ[(static_cast<size_t>(ty) * w + tx) * 4];
+            uint8_t *dst = &frame[(static_cast<size_t>(y + ty) * frameWidth + x + tx) * 4];
+            for (int c = 0; c < 4; ++c) {
+                t[c] = src[c];
+                dst[c] = c == 3 ? src[c]
+                                : static_cast<uint8_t>(std::clamp(src[c] + brightness, 0, 255));
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    int width = argc > 1 ? atoi(argv[1]) : 1920;
+    int height = argc > 2 ? atoi(argv[2]) : 1080;
+    int iterations = argc > 3 ? atoi(argv[3]) : 10;
+
+    const Case cases[] = {
+        {"ncc 96x32 auto     ", 96, 32, MatchMethod::NCC, -1, 0, false},
+        {"ncc 96x32 +25 bright", 96, 32, MatchMethod::NCC, -1, 25, false},
+        {"sad 96x32 auto     ", 96, 32, MatchMethod::SAD, -1, 0, false},
+        {"ncc 37x21 odd      ", 37, 21, MatchMethod::NCC, -1, 0, false},
+        {"sad 200x40 roi     ", 200, 40, MatchMethod::SAD, -1, 0, true},
+        {"ncc 24x24 no pyr   ", 24, 24, MatchMethod::NCC, 0, 0, true},
+    };
+
+    printf("Frame %dx%d, %d iterations\n", width, height, iterations);
+    const std::vector<uint8_t> patchScene = MakeScene(256, 256, 7);
+    std::mt19937 rng(42);
+    bool ok = true;
+
+    for (const Case &c : cases) {
+        std::vector<uint8_t> frame = MakeScene(width, height, rng());
+        const int targetX = static_cast<int>(rng() % (width - c.width));
+        const int targetY = static_cast<int>(rng() % (height - c.height));
+
+        TemplateSpec spec;
+        spec.name = c.label;
+        spec.width = c.width;
+        spec.height = c.height;
+        spec.method = c.method;
+        spec.pyramidLevels = c.pyramidLevels;
+        spec.threshold = 0.9f;
+        Plant(patchScene, 256, frame, width, targetX, targetY, c.width, c.height, c.brightness,
+              spec.bgra);
+        if (c.useRegion) {
+            spec.searchRegion.x = std::max(0, targetX - 150);
+            spec.searchRegion.y = std::max(0, targetY - 100);
+            spec.searchRegion.width = 300 + c.width;
+            spec.searchRegion.height = 200 + c.height;
+        }
+
+        TemplateMatcher matcher;
+        std::string error;
+        int32_t templateId = matcher.AddTemplate(spec, error);
+        if (templateId < 0) {
+            printf("%s: AddTemplate failed: %s\n", c.label, error.c_str());
+            ok = false;
+            continue;
+        }
+
+        double ms[2] = {0, 0};
+        for (int simd = 0; simd < 2; ++simd) {
+            FrameConverter::SetSimdEnabled(simd == 1);
+            std::vector<TemplateMatch> results;
+            matcher.Match(frame.data(), width, height, {}, results);
+            const TemplateMatch &m = results[0];
+            if (!m.matched || m.x != targetX || m.y != targetY) {
+                printf("%s: %s found (%d,%d) score %.3f, expected (%d,%d)\n", c.label,
+                       simd ? "avx2" : "scalar", m.x, m.y, m.score, targetX, targetY);
+                ok = false;
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                matcher.Match(frame.data(), width, height, {templateId}, results);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            ms[simd] = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+        }
+        printf("%s  scalar %8.3f ms   %s %8.3f ms   speedup %5.2fx\n", c.label, ms[0],
+               FrameConverter::IsSimdEnabled() ? "avx2" : "n/a ", ms[1], ms[0] / ms[1]);
+    }
+
+    // Absent template: best score must stay under the threshold
+    {
+        FrameConverter::SetSimdEnabled(true);
+        std::vector<uint8_t> frame = MakeScene(width, height, 99);
+        TemplateSpec spec;
+        spec.width = 64;
+        spec.height = 32;
+        spec.bgra.resize(64 * 32 * 4);
+        for (int y = 0; y < 32; ++y) {
+            for (int x = 0; x < 64; ++x) {
+                std::copy_n(&patchScene[(static_cast<size_t>(y) * 256 + x) * 4], 4,
+                            &spec.bgra[(static_cast<size_t>(y) * 64 + x) * 4]);
+            }
+        }
+        TemplateMatcher matcher;
+        std::string error;
+        matcher.AddTemplate(spec, error);
+        std::vector<TemplateMatch> results;
+        matcher.Match(frame.data(), width, height, {}, results);
+        printf("absent template          best score %.3f\n", results[0].score);
+        if (results[0].matched) {
+            printf("absent template reported as matched\n");
+            ok = false;
+        }
+    }
+
+    printf(ok ? "All templates found\n" : "Detection failed\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+// Bit-exactness check and benchmark for YuvConverter: the SSE4.1 and AVX2 kernels and the
+// multi-threaded path must reproduce the single-threaded scalar output byte for byte, and the
+// scalar output must stay within 1 of a floating-point reference.
+// Usage: bench_yuv_converter [width] [height] [iterations]
+
+#include "yuv_converter.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int kStridePadding = 12; // Extra bytes at the end of each row, to catch stride mistakes
+constexpr uint8_t kFill = 0xCD;
+
+// Converted frame with padded planes
+struct YuvBuffer {
+    std::vector<uint8_t> planes[3];
+    YuvPlanes view;
+
+    YuvBuffer(int width, int height, YuvLayout layout) {
+        const int chromaWidth = (width + 1) / 2;
+        const int chromaHeight = (height + 1) / 2;
+        const int widths[3] = {width, layout == YuvLayout::NV12 ? chromaWidth * 2 : chromaWidth,
+                               layout == YuvLayout::NV12 ? 0 : chromaWidth};
+        const int heights[3] = {height, chromaHeight, chromaHeight};
+        for (int p = 0; p < 3; ++p) {
+            if (widths[p] == 0) {
+                continue;
+            }
+            view.linesize[p] = widths[p] + kStridePadding;
+            planes[p].assign(static_cast<size_t>(view.linesize[p]) * heights[p], kFill);
+            view.data[p] = planes[p].data();
+        }
+    }
+
+    bool operator==(const YuvBuffer &other) const {
+        return planes[0] == other.planes[0] && planes[1] == other.planes[1] &&
+               planes[2] == other.planes[2];
+    }
+};
+
+std::vector<uint8_t> MakeFrame(int width, int height, size_t stride, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> frame(stride * height);
+    for (auto &v : frame) {
+        v = static_cast<uint8_t>(rng());
+    }
+    // Saturated corners exercise clamping in every kernel
+    if (width >= 2 && height >= 2) {
+        for (int i = 0; i < 4; ++i) {
+            frame[i] = 255;
+            frame[4 + i] = i == 0 ? 0 : 255;
+        }
+    }
+    return frame;
+}
+
+// Largest difference between the scalar output and a double-precision conversion
+int MaxReferenceError(const std::vector<uint8_t> &frame, int width, int height, size_t stride,
+                      YuvMatrix matrix, bool fullRange, const YuvBuffer &out) {
+    const double kr = matrix == YuvMatrix::BT709 ? 0.2126 : 0.299;
+    const double kb = matrix == YuvMatrix::BT709 ? 0.0722 : 0.114;
+    const double kg = 1.0 - kr - kb;
+    const double yScale = fullRange ? 1.0 : 219.0 / 255.0;
+    const double cScale = fullRange ? 1.0 : 224.0 / 255.0;
+    const double yOffset = fullRange ? 0.0 : 16.0;
+    auto pixel = [&](int x, int y, int ch) {
+        return static_cast<double>(frame[y * stride + std::min(x, width - 1) * 4 + ch]);
+    };
+    auto clamp = [](double v) {
+        return static_cast<int>(std::lround(std::clamp(v, 0.0, 255.0)));
+    };
+
+    int worst = 0;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const double luma = kr * pixel(x, y, 2) + kg * pixel(x, y, 1) + kb * pixel(x, y, 0);
+            const int expected = clamp(luma * yScale + yOffset);
+            const int got = out.view.data[0][y * out.view.linesize[0] + x];
+            worst = std::max(worst, std::abs(expected - got));
+        }
+    }
+    for (int cy = 0; cy < (height + 1) / 2; ++cy) {
+        for (int cx = 0; cx < (width + 1) / 2; ++cx) {
+            const int y1 = std::min(cy * 2 + 1, height - 1);
+            double rgb[3];
+            for (int ch = 0; ch < 3; ++ch) {
+                rgb[ch] = (pixel(cx * 2, cy * 2, ch) + pixel(cx * 2 + 1, cy * 2, ch) +
+                           pixel(cx * 2, y1, ch) + pixel(cx * 2 + 1, y1, ch)) /
+                          4.0;
+            }
+            const double luma = kr * rgb[2] + kg * rgb[1] + kb * rgb[0];
+            const int u = clamp((rgb[0] - luma) / (2.0 * (1.0 - kb)) * cScale + 128.0);
+            const int v = clamp((rgb[2] - luma) / (2.0 * (1.0 - kr)) * cScale + 128.0);
+            const uint8_t *chroma = out.view.data[1] + cy * out.view.linesize[1];
+            const bool nv12 = out.view.data[2] == nullptr;
+            const int gotU = nv12 ? chroma[cx * 2] : chroma[cx];
+            const int gotV = nv12 ? chroma[cx * 2 + 1]
+                                  : out.view.data[2][cy * out.view.linesize[2] + cx];
+            worst = std::max({worst, std::abs(u - gotU), std::abs(v - gotV)});
+        }
+    }
+    return worst;
+}
+
+// Every kernel and thread count against the single-threaded scalar output at one size
+bool CheckSize(int width, int height) {
+    const size_t stride = static_cast<size_t>(width) * 4 + kStridePadding;
+    const std::vector<uint8_t> frame = MakeFrame(width, height, stride, width * 7919 + height);
+    const YuvKernel kernels[] = {YuvKernel::SSE41, YuvKernel::AVX2};
+    bool ok = true;
+
+    for (YuvMatrix matrix : {YuvMatrix::BT601, YuvMatrix::BT709}) {
+        for (bool fullRange : {false, true}) {
+            for (YuvLayout layout : {YuvLayout::I420, YuvLayout::NV12}) {
+                const std::string label = std::to_string(width) + "x" + std::to_string(height) +
+                                          " " + YuvConverter::MatrixName(matrix) +
+                                          (fullRange ? " full " : " limited ") +
+                                          (layout == YuvLayout::NV12 ? "nv12" : "i420");
+
+                YuvConverter scalar(matrix, fullRange, layout, 1);
+                scalar.SetKernel(YuvKernel::Scalar);
+                YuvBuffer reference(width, height, layout);
+                scalar.Convert(frame.data(), width, height, stride, reference.view);
+
+                const int error =
+                    MaxReferenceError(frame, width, height, stride, matrix, fullRange, reference);
+                if (error > 1) {
+                    printf("%s: scalar off by %d from the float reference\n", label.c_str(),
+                           error);
+                    ok = false;
+                }
+
+                for (int threads : {1, 3}) {
+                    for (YuvKernel kernel : kernels) {
+                        YuvConverter converter(matrix, fullRange, layout, threads);
+                        converter.SetKernel(kernel);
+                        if (converter.GetKernel() != kernel) {
+                            continue; // Not supported by this CPU
+                        }
+                        YuvBuffer out(width, height, layout);
+                        converter.Convert(frame.data(), width, height, stride, out.view);
+                        if (!(out == reference)) {
+                            printf("MISMATCH: %s %s with %d threads\n", label.c_str(),
+                                   YuvConverter::KernelName(kernel).c_str(), threads);
+                            ok = false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    int width = argc > 1 ? atoi(argv[1]) : 2560;
+    int height = argc > 2 ? atoi(argv[2]) : 1440;
+    int iterations = argc > 3 ? atoi(argv[3]) : 50;
+
+    bool ok = true;
+    const int sizes[][2] = {{1, 1}, {2, 2}, {3, 3}, {17, 5}, {37, 21}, {64, 33}, {1279, 719}};
+    for (const auto &size : sizes) {
+        ok = CheckSize(size[0], size[1]) && ok;
+    }
+    printf(ok ? "All kernels bit-exact with the scalar reference\n" : "Bit-exactness FAILED\n");
+
+    printf("\nFrame %dx%d BT.709 limited, %d iterations\n", width, height, iterations);
+    const size_t stride = static_cast<size_t>(width) * 4;
+    const std::vector<uint8_t> frame = MakeFrame(width, height, stride, 42);
+    for (YuvLayout layout : {YuvLayout::I420, YuvLayout::NV12}) {
+        for (int threads : {1, 0}) {
+            YuvConverter converter(YuvMatrix::BT709, false, layout, threads);
+            YuvBuffer out(width, height, layout);
+            printf("%s %d thread%s:", layout == YuvLayout::NV12 ? "nv12" : "i420",
+                   converter.GetThreadCount(), converter.GetThreadCount() == 1 ? " " : "s");
+            for (YuvKernel kernel : {YuvKernel::Scalar, YuvKernel::SSE41, YuvKernel::AVX2}) {
+                converter.SetKernel(kernel);
+                if (converter.GetKernel() != kernel) {
+                    printf("   %s n/a", YuvConverter::KernelName(kernel).c_str());
+                    continue;
+                }
+                converter.Convert(frame.data(), width, height, 0, out.view); // Warm up
+                auto start = std::chrono::high_resolution_clock::now();
+                for (int i = 0; i < iterations; ++i) {
+                    converter.Convert(frame.data(), width, height, 0, out.view);
+                }
+                auto end = std::chrono::high_resolution_clock::now();
+                const double ms =
+                    std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+                printf("   %s %7.3f ms", YuvConverter::KernelName(kernel).c_str(), ms);
+            }
+            printf("\n");
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "observation_sampler.h"
+#include "process_attribute.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Value types of attribute table columns
+enum class AttributeColumnType {
+    Int32,   // "int" attributes and frame_number
+    Int64,   // Timestamps
+    Float32, // "float"
+    Bool,    // "bool", one bit per row
+    Bytes,   // "array", AttributeLength bytes per row
+};
+
+struct AttributeColumn {
+    std::string name;
+    AttributeColumnType type;
+    size_t byteWidth; // Bytes per row; 0 for Bool
+    bool nullable;    // Attribute columns are null where the read failed
+};
+
+// Writes attribute samples as an Arrow IPC file (Feather v2) with a fixed, typed schema built
+// from the attribute list: frame_number, timestamp_us, read_timestamp_us, then one column per
+// attribute. Rows are buffered into column blocks and written as a record batch every
+// rowsPerBatch rows, so Append only copies values and nothing is formatted while sampling.
+// Load with pyarrow.ipc.open_file(pyarrow.memory_map(path)) for zero-copy columns. A file that
+// was never closed has no footer but still reads as an IPC stream from byte 8.
+class AttributeTableWriter {
+  public:
+    AttributeTableWriter();
+    ~AttributeTableWriter();
+
+    AttributeTableWriter(const AttributeTableWriter &) = delete;
+    AttributeTableWriter &operator=(const AttributeTableWriter &) = delete;
+
+    // attributes must be in the order the samples list them
+    bool Open(const std::string &path, const std::vector<ProcessAttribute> &attributes,
+              size_t rowsPerBatch = 256);
+
+    void Append(const ObservationSample &sample, int32_t frameNumber, int64_t timestampUs);
+
+    // Write the open batch and the footer
+    bool Close();
+
+    // Convert the closed file to CSV: failed reads are empty, arrays are hex
+    bool ExportCsv(const std::string &csvPath) const;
+
+    size_t GetRowCount() const { return rowsWritten_ + rowsInBatch_; }
+    const std::vector<AttributeColumn> &GetColumns() const { return columns_; }
+
+    // Column type for a ProcessAttribute type ("int", "float", "bool", "array")
+    static bool ColumnTypeFor(const std::string &attributeType, AttributeColumnType &type);
+
+  private:
+    static constexpr size_t kKeyColumns = 3; // frame_number, timestamp_us, read_timestamp_us
+
+    struct Block {
+        int64_t offset;         // Start of the message in the file
+        int32_t metadataLength; // Prefix and flatbuffer, padded
+        int64_t bodyLength;
+        size_t rows;
+    };
+
+    // Where each column's validity bitmap and values sit in a batch body
+    struct BufferSpan {
+        int64_t offset;
+        int64_t length;
+    };
+    std::vector<BufferSpan> BatchLayout(size_t rows, int64_t &bodyLength) const;
+
+    bool WriteMessage(uint8_t headerType, const std::vector<uint8_t> &metadata,
+                      const std::vector<uint8_t> &body, int32_t &metadataLength);
+    bool WriteBatch();
+
+    std::string path_;
+    std::ofstream file_;
+    std::vector<AttributeColumn> columns_;
+    std::vector<std::vector<uint8_t>> values_;   // Column blocks of the open batch
+    std::vector<std::vector<uint8_t>> validity_; // Empty for non-nullable columns
+    std::vector<int64_t> nullCounts_;
+    size_t rowsPerBatch_;
+    size_t rowsInBatch_;
+    size_t rowsWritten_;
+    int64_t fileOffset_;
+    std::vector<Block> blocks_;
+    bool open_;
+};
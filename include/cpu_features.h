@@ -0,0 +1,80 @@
+#pragma once
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+// Functions using AVX2 intrinsics must be tagged so GCC/Clang emit them without a global -mavx2.
+// MSVC allows intrinsics anywhere, so the tag is empty there.
+#if defined(_MSC_VER)
+#define SIPHON_TARGET_AVX2
+#define SIPHON_TARGET_SSE41
+#else
+#define SIPHON_TARGET_AVX2 __attribute__((target("avx2")))
+#define SIPHON_TARGET_SSE41 __attribute__((target("sse4.1")))
+#endif
+
+// Runtime CPU feature detection for SIMD kernel dispatch
+class CpuFeatures {
+  public:
+    static bool HasAVX2() {
+        static const bool hasAvx2 = DetectAVX2();
+        return hasAvx2;
+    }
+
+    static bool HasSSE41() {
+        static const bool hasSse41 = DetectSSE41();
+        return hasSse41;
+    }
+
+  private:
+    static void CpuId(int leaf, int subleaf, int regs[4]) {
+#if defined(_MSC_VER)
+        __cpuidex(regs, leaf, subleaf);
+#else
+        unsigned int a, b, c, d;
+        __cpuid_count(leaf, subleaf, a, b, c, d);
+        regs[0] = static_cast<int>(a);
+        regs[1] = static_cast<int>(b);
+        regs[2] = static_cast<int>(c);
+        regs[3] = static_cast<int>(d);
+#endif
+    }
+
+    static bool DetectSSE41() {
+        int regs[4];
+        CpuId(1, 0, regs);
+        return (regs[2] & (1 << 19)) != 0;
+    }
+
+    static bool DetectAVX2() {
+        int regs[4];
+        CpuId(0, 0, regs);
+        if (regs[0] < 7) {
+            return false;
+        }
+
+        // OS must save YMM state (OSXSAVE + XCR0 bits 1 and 2)
+        CpuId(1, 0, regs);
+        bool osxsave = (regs[2] & (1 << 27)) != 0;
+        bool avx = (regs[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx) {
+            return false;
+        }
+#if defined(_MSC_VER)
+        unsigned long long xcr0 = _xgetbv(0);
+#else
+        unsigned int eax, edx;
+        __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        unsigned long long xcr0 = (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+        if ((xcr0 & 0x6) != 0x6) {
+            return false;
+        }
+
+        CpuId(7, 0, regs);
+        return (regs[1] & (1 << 5)) != 0;
+    }
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Forward declaration for zstd
+struct ZSTD_CCtx_s;
+
+enum class DeltaCompression {
+    Zstd,
+    LZ4,
+};
+
+struct DeltaEncoderOptions {
+    DeltaCompression compression = DeltaCompression::Zstd;
+    int level = 1;             // zstd level, or LZ4 acceleration (1 = default)
+    int keyframeInterval = 60; // Frames between self-contained keyframes
+};
+
+// Lossless frame encoder for "raw-delta" streams. Each frame is XORed against the previous frame
+// it encoded and compressed; keyframes compress the frame itself. Every output carries a chain
+// sequence number so clients can detect gaps and wait for the next keyframe.
+// Not thread-safe: one instance per stream.
+class DeltaFrameEncoder {
+  public:
+    explicit DeltaFrameEncoder(const DeltaEncoderOptions &options = DeltaEncoderOptions());
+    ~DeltaFrameEncoder();
+
+    DeltaFrameEncoder(const DeltaFrameEncoder &) = delete;
+    DeltaFrameEncoder &operator=(const DeltaFrameEncoder &) = delete;
+
+    // Encode size bytes of pixels into out. A layout change (width/height/size) forces a keyframe.
+    bool Encode(const uint8_t *pixels, size_t size, int width, int height,
+                std::vector<uint8_t> &out, bool &keyframe, uint64_t &sequence);
+
+    // Make the next frame a keyframe
+    void ForceKeyframe() { forceKeyframe_ = true; }
+
+    static bool ParseCompression(const std::string &name, DeltaCompression &compression);
+    static const char *CompressionName(DeltaCompression compression);
+
+  private:
+    bool Compress(const uint8_t *data, size_t size, std::vector<uint8_t> &out);
+
+    DeltaEncoderOptions options_;
+    ZSTD_CCtx_s *zstdContext_;
+
+    std::vector<uint8_t> previous_; // Last encoded frame (reference for the next delta)
+    std::vector<uint8_t> delta_;    // XOR scratch buffer
+    int width_;
+    int height_;
+    int framesSinceKeyframe_;
+    uint64_t sequence_;
+    bool forceKeyframe_;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "frame_converter.h"
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Identifies one encoded representation of a broadcast frame
+struct EncodedFrameKey {
+    int32_t frameNumber = 0;
+    std::string format; // "jpeg", ...
+    int quality = 0;
+    std::string options;  // Other encoder settings that change the output bytes
+    FrameOutputSpec spec; // Output size/layout the frame was converted to
+
+    bool operator<(const EncodedFrameKey &other) const {
+        return std::tie(frameNumber, format, quality, options, spec) <
+               std::tie(other.frameNumber, other.format, other.quality, other.options, other.spec);
+    }
+};
+
+using EncodedBuffer = std::shared_ptr<const std::vector<uint8_t>>;
+
+// Encode-once cache shared by all frame stream subscribers. The first subscriber that needs a
+// representation encodes it; concurrent and later subscribers reuse the same bytes. Entries for
+// a frame are dropped as soon as a newer frame is requested.
+class EncodedFrameCache {
+  public:
+    using EncodeFn = std::function<bool(std::vector<uint8_t> &)>;
+
+    EncodedFrameCache() : newestFrame_(-1), hits_(0), misses_(0) {}
+
+    // Returns the encoded bytes for key, running encode() only if no other subscriber has.
+    // Returns nullptr if encoding failed.
+    EncodedBuffer GetOrEncode(const EncodedFrameKey &key, const EncodeFn &encode);
+
+    void Clear();
+
+    uint64_t GetHits() const { return hits_; }
+    uint64_t GetMisses() const { return misses_; }
+
+  private:
+    std::mutex mutex_;
+    std::map<EncodedFrameKey, std::shared_future<EncodedBuffer>> entries_;
+    int32_t newestFrame_;
+    uint64_t hits_;
+    uint64_t misses_;
+};
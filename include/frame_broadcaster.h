@@ -1,11 +1,15 @@
 #pragma once
 
+#include "encoded_frame_cache.h"
+#include "frame_converter.h"
 #include "process_capture.h"
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <d3d11.h>
 #include <dxgi1_2.h>
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <thread>
@@ -18,16 +22,36 @@ using Microsoft::WRL::ComPtr;
 
 // Frame data structure shared with subscribers
 struct CapturedFrame {
-    std::vector<uint8_t> pixels; // BGRA format
+    std::vector<uint8_t> pixels; // BGRA unless converted for the subscriber
     int64_t timestampUs;
     int32_t width;
     int32_t height;
     int32_t frameNumber;
+    PixelFormat pixelFormat = PixelFormat::BGRA;
 };
 
 // Callback type for frame subscribers
 using FrameCallback = std::function<void(const CapturedFrame &)>;
 
+// Per-subscriber decimation, applied before conversion so skipped frames cost nothing
+struct FrameRateLimit {
+    float maxFps = 0.0f;   // 0 = no cap
+    int everyNthFrame = 1; // Deliver one of every N captured frames
+
+    bool IsUnlimited() const { return maxFps <= 0.0f && everyNthFrame <= 1; }
+};
+
+struct FrameSubscriber {
+    FrameCallback callback;
+    FrameOutputSpec spec; // Conversion applied before the callback runs
+    FrameRateLimit rateLimit;
+
+    // Decimation state (capture thread only)
+    uint64_t framesSeen = 0;
+    double fpsCredit = 1.0; // Frames owed under maxFps; one is spent per delivery
+    int64_t lastTimestampUs = -1;
+};
+
 // Thread-safe frame broadcaster that captures once and distributes to multiple consumers
 class FrameBroadcaster {
   private:
@@ -48,19 +72,28 @@ class FrameBroadcaster {
 
     // Subscribers
     std::mutex subscribersMutex_;
-    std::unordered_map<uint64_t, FrameCallback> subscribers_;
+    std::unordered_map<uint64_t, FrameSubscriber> subscribers_;
     std::atomic<uint64_t> nextSubscriberId_;
 
     // Frame statistics
     std::atomic<int32_t> currentFrame_;
     std::atomic<int64_t> lastFrameTimestampUs_;
 
+    // Encoded representations shared across stream subscribers
+    EncodedFrameCache encodedFrameCache_;
+
+    // Most recent frame, kept for single-shot reads
+    std::mutex latestFrameMutex_;
+    std::condition_variable latestFrameCv_;
+    std::shared_ptr<const CapturedFrame> latestFrame_;
+
     // Private methods
     void CaptureLoop();
     bool InitializeDXGICapture(HWND window);
     void CleanupDXGICapture();
     std::vector<uint8_t> CaptureFrameDXGI();
     void BroadcastFrame(const CapturedFrame &frame);
+    static bool ShouldDeliver(FrameSubscriber &subscriber, const CapturedFrame &frame);
 
   public:
     FrameBroadcaster(ProcessCapture *fallbackCapture);
@@ -71,12 +104,23 @@ class FrameBroadcaster {
     void Stop();
     bool IsRunning() const { return isRunning_; }
 
-    // Subscribe to frames (returns subscription ID)
-    uint64_t Subscribe(FrameCallback callback);
+    // Subscribe to frames (returns subscription ID). Frames are decimated by rateLimit and then
+    // resized/converted to spec; each distinct spec is computed once per frame and shared by its
+    // subscribers.
+    uint64_t Subscribe(FrameCallback callback, const FrameOutputSpec &spec = FrameOutputSpec(),
+                       const FrameRateLimit &rateLimit = FrameRateLimit());
     void Unsubscribe(uint64_t subscriptionId);
 
     // Get current stats
     int32_t GetCurrentFrame() const { return currentFrame_; }
     int64_t GetLastFrameTimestamp() const { return lastFrameTimestampUs_; }
+
+    // Most recent frame with frameNumber >= minFrameNumber, waiting up to timeout for one to be
+    // captured. Returns nullptr on timeout. The frame is shared, not copied.
+    std::shared_ptr<const CapturedFrame> GetLatestFrame(int32_t minFrameNumber,
+                                                        std::chrono::milliseconds timeout);
+
+    // Encode-once cache for representations of broadcast frames
+    EncodedFrameCache &GetEncodedFrameCache() { return encodedFrameCache_; }
 };
 
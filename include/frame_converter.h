@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Output pixel layouts supported by the conversion stage
+enum class PixelFormat {
+    BGRA,          // 4 bytes per pixel, capture layout
+    RGB24,         // 3 bytes per pixel, interleaved
+    GRAY8,         // 1 byte per pixel, BT.601 luma
+    RGBPlanarF32,  // 3 float planes (R, G, B) normalized to [0, 1]
+};
+
+enum class ResizeFilter {
+    Box,      // Area average, best for large downscales
+    Bilinear, // Two-tap interpolation, best for mild scaling
+};
+
+// Source rectangle in capture pixels (width/height 0 = to the right/bottom edge)
+struct FrameRegion {
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+
+    bool IsFull() const { return x == 0 && y == 0 && width == 0 && height == 0; }
+
+    bool operator<(const FrameRegion &other) const {
+        return std::tie(x, y, width, height) < std::tie(other.x, other.y, other.width, other.height);
+    }
+
+    bool operator==(const FrameRegion &other) const {
+        return std::tie(x, y, width, height) ==
+               std::tie(other.x, other.y, other.width, other.height);
+    }
+};
+
+// Requested output of the conversion stage (width/height 0 = keep region size). The region is
+// cropped first, so pixels outside it are never read.
+struct FrameOutputSpec {
+    int32_t width = 0;
+    int32_t height = 0;
+    PixelFormat pixelFormat = PixelFormat::BGRA;
+    ResizeFilter filter = ResizeFilter::Box;
+    FrameRegion region;
+
+    bool IsPassthrough() const {
+        return width == 0 && height == 0 && pixelFormat == PixelFormat::BGRA && region.IsFull();
+    }
+
+    bool operator<(const FrameOutputSpec &other) const {
+        return std::tie(width, height, pixelFormat, filter, region) <
+               std::tie(other.width, other.height, other.pixelFormat, other.filter, other.region);
+    }
+
+    bool operator==(const FrameOutputSpec &other) const {
+        return std::tie(width, height, pixelFormat, filter, region) ==
+               std::tie(other.width, other.height, other.pixelFormat, other.filter, other.region);
+    }
+};
+
+// Resize and pixel format conversion kernels (AVX2 with scalar fallback)
+class FrameConverter {
+  public:
+    // Convert a BGRA frame according to spec. Crops to spec.region, resolves 0 dimensions
+    // (keeping aspect ratio when only one is given) and writes the result dimensions to
+    // outWidth/outHeight. Fails if the region lies outside the frame.
+    static bool Convert(const uint8_t *bgra, int width, int height, const FrameOutputSpec &spec,
+                        std::vector<uint8_t> &out, int32_t &outWidth, int32_t &outHeight);
+
+    // Resize BGRA -> BGRA. srcStride is the distance between source rows in bytes
+    // (0 = tightly packed).
+    static void ResizeBGRA(const uint8_t *src, int srcWidth, int srcHeight, uint8_t *dst,
+                           int dstWidth, int dstHeight, ResizeFilter filter, size_t srcStride = 0);
+
+    // Clamp region to a width x height frame; false if nothing of it is inside
+    static bool ResolveRegion(const FrameRegion &region, int width, int height,
+                              FrameRegion &resolved);
+
+    // Pixel format conversions from BGRA (tightly packed rows)
+    static void BGRAToRGB24(const uint8_t *src, uint8_t *dst, size_t pixelCount);
+    static void BGRAToGray8(const uint8_t *src, uint8_t *dst, size_t pixelCount);
+    static void BGRAToPlanarF32(const uint8_t *src, float *dst, size_t pixelCount);
+
+    // Bytes needed for a frame of the given format
+    static size_t FrameSize(PixelFormat format, int width, int height);
+
+    // Parse/format names used on the wire ("bgra", "rgb24", "gray8", "rgb_f32_planar")
+    static bool ParsePixelFormat(const std::string &name, PixelFormat &format);
+    static std::string PixelFormatName(PixelFormat format);
+    static bool ParseResizeFilter(const std::string &name, ResizeFilter &filter);
+
+    // Force the scalar kernels (used by the benchmark to compare implementations)
+    static void SetSimdEnabled(bool enabled);
+    static bool IsSimdEnabled();
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "encoded_frame_cache.h"
+#include "frame_broadcaster.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A frame together with its encoded bytes
+struct EncodedFrame {
+    CapturedFrame frame;
+    EncodedBuffer data; // nullptr if the format sends frame.pixels as-is
+    bool keyframe = false;
+    uint64_t sequence = 0; // Chain position for formats that reference earlier frames
+    int quality = 0;       // Encoder quality used, where applicable
+    bool skipped = false;  // Dropped by rate control instead of being encoded
+    bool ok = false;
+};
+
+// Encodes successive frames on a small worker pool and hands them back in submission order,
+// so frame N+1 encodes while frame N is being written to the stream.
+class FrameEncodePipeline {
+  public:
+    // Called on a worker thread with encoded.frame set; fills in the remaining fields. worker is
+    // a stable index in [0, numThreads) so callers can keep per-thread encoder state.
+    using EncodeFn = std::function<bool(EncodedFrame &encoded, size_t worker)>;
+
+    // maxInFlight bounds frames queued, encoding or waiting to be written; further frames are
+    // dropped until the consumer catches up
+    FrameEncodePipeline(size_t numThreads, size_t maxInFlight, EncodeFn encode);
+    ~FrameEncodePipeline();
+
+    FrameEncodePipeline(const FrameEncodePipeline &) = delete;
+    FrameEncodePipeline &operator=(const FrameEncodePipeline &) = delete;
+
+    // Queue a frame for encoding. Returns false if the pipeline is full and the frame was dropped.
+    bool Submit(const CapturedFrame &frame);
+
+    // Wait up to timeout for the next frame in submission order
+    bool Next(EncodedFrame &out, std::chrono::milliseconds timeout);
+
+    void Stop();
+
+    uint64_t GetDroppedFrames() const { return droppedFrames_; }
+
+  private:
+    void WorkerLoop(size_t worker);
+
+    EncodeFn encode_;
+    size_t maxInFlight_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable workCv_;
+    std::condition_variable doneCv_;
+    std::deque<std::pair<uint64_t, CapturedFrame>> pending_;
+    std::map<uint64_t, EncodedFrame> done_; // Reorder buffer keyed by submission sequence
+    uint64_t nextSequence_;
+    uint64_t nextOutput_;
+    std::atomic<uint64_t> droppedFrames_;
+    bool stopping_;
+};
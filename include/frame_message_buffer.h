@@ -0,0 +1,20 @@
+#pragma once
+
+#include "encoded_frame_cache.h"
+#include "siphon_service.pb.h"
+#include <grpcpp/support/byte_buffer.h>
+
+// Serializes streamed frame messages without copying the payload. The message fields are
+// serialized normally and the payload is appended as the FrameData data field through a gRPC
+// slice that holds a reference to the encoded buffer until the transport has sent it.
+class FrameMessageBuffer {
+  public:
+    // FrameData with payload as its data field (frame.data must be empty)
+    static grpc::ByteBuffer BuildFrame(const siphon_service::FrameData &frame,
+                                       const EncodedBuffer &payload);
+
+    // Observation whose frame field is frame plus payload (observation.frame must be unset)
+    static grpc::ByteBuffer BuildObservation(const siphon_service::Observation &observation,
+                                             const siphon_service::FrameData &frame,
+                                             const EncodedBuffer &payload);
+};
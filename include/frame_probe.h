@@ -0,0 +1,35 @@
+#pragma once
+
+#include "frame_converter.h"
+#include <cstdint>
+#include <vector>
+
+// Per-channel statistics of one region of a BGRA frame (channel order B, G, R, A)
+struct RegionStats {
+    FrameRegion region; // Clamped to the frame
+    uint64_t pixelCount = 0;
+    uint64_t sum[4] = {0, 0, 0, 0};
+    uint8_t min[4] = {0, 0, 0, 0};
+    uint8_t max[4] = {0, 0, 0, 0};
+    std::vector<uint32_t> histogram; // bins per channel, channel-major (all B bins, then G, ...)
+
+    float Mean(int channel) const {
+        return pixelCount ? static_cast<float>(sum[channel]) / pixelCount : 0.0f;
+    }
+};
+
+// Pixel probes and region reductions over BGRA frames, so clients that only need a few numbers
+// (bar fill, icon present, average colour) don't have to pull whole frames. Sum/min/max use AVX2
+// when FrameConverter's SIMD kernels are enabled.
+class FrameProbe {
+  public:
+    // BGRA value at (x, y); false (and zeros) outside the frame
+    static bool ReadPixel(const uint8_t *bgra, int width, int height, int x, int y,
+                          uint8_t out[4]);
+
+    // Statistics over region; histogramBins (0-256) per channel, 0 = no histogram. Returns false
+    // (with pixelCount 0) if the region lies outside the frame.
+    static bool ComputeRegionStats(const uint8_t *bgra, int width, int height,
+                                   const FrameRegion &region, int histogramBins,
+                                   RegionStats &stats);
+};
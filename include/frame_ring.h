@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Shared-memory frame ring for consumers on the same host. The segment holds a header followed by
+// slotCount fixed-size slots; frame i is written to slot i % slotCount. Each slot is guarded by a
+// seqlock so readers can use pixels in place and detect when the writer overwrote them.
+// Publishing bumps a wake counter that readers block on (futex on Linux, named semaphore on
+// Windows); readers register in a waiter count so the writer only wakes when someone waits.
+// Plain C++ with no server dependencies, so clients can build it on their own.
+
+constexpr uint32_t FRAME_RING_MAGIC = 0x47524653; // "SFRG"
+constexpr uint32_t FRAME_RING_VERSION = 2;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+              "Frame ring needs address-free atomics");
+
+// Segment header (offset 0)
+struct alignas(64) FrameRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t headerSize;             // Offset of the first slot
+    uint64_t slotStride;             // Distance between slots
+    uint64_t slotCapacity;           // Max pixel bytes per slot
+    std::atomic<uint64_t> published; // Frames published so far
+    std::atomic<uint32_t> wakeCounter; // Bumped on every publish (futex word)
+    std::atomic<uint32_t> writerOpen;  // Cleared when the writer closes the ring
+    std::atomic<uint32_t> waiters;     // Readers blocked in Wait
+};
+
+// Per-slot metadata, followed by the pixels at the next 64-byte boundary
+struct alignas(64) FrameRingSlot {
+    std::atomic<uint64_t> sequence; // Odd while the writer is filling the slot
+    uint64_t frameIndex;            // Position in the ring's frame stream
+    int64_t timestampUs;
+    int32_t width;
+    int32_t height;
+    int32_t frameNumber;
+    uint32_t pixelFormat; // PixelFormat value
+    uint64_t size;        // Valid pixel bytes
+};
+
+// Platform shared-memory segment (POSIX shm_open/mmap or a Windows file mapping) plus the
+// notification primitive
+class SharedFrameSegment {
+  public:
+    SharedFrameSegment();
+    ~SharedFrameSegment();
+
+    SharedFrameSegment(const SharedFrameSegment &) = delete;
+    SharedFrameSegment &operator=(const SharedFrameSegment &) = delete;
+
+    bool Create(const std::string &name, size_t size);
+    bool Open(const std::string &name);
+    void Close();
+
+    uint8_t *GetBase() const { return base_; }
+    size_t GetSize() const { return size_; }
+
+    // Wake all waiters / wait until wakeCounter != expected (or timeout)
+    void Notify(std::atomic<uint32_t> &wakeCounter, std::atomic<uint32_t> &waiters);
+    void Wait(std::atomic<uint32_t> &wakeCounter, std::atomic<uint32_t> &waiters,
+              uint32_t expected, int timeoutMs);
+
+  private:
+    std::string name_;
+    uint8_t *base_;
+    size_t size_;
+    bool owner_;
+    int fd_;       // POSIX
+    void *handle_; // Windows file mapping
+    void *event_;  // Windows named semaphore, one permit per waiter to wake
+};
+
+class FrameRingWriter {
+  public:
+    FrameRingWriter() = default;
+    ~FrameRingWriter() { Close(); }
+
+    // Creates (or replaces) the named segment
+    bool Create(const std::string &name, uint32_t slotCount, uint64_t slotCapacity);
+    void Close();
+
+    // Copy one frame into the next slot and wake readers. Fails if size exceeds the slot.
+    bool Publish(const uint8_t *pixels, uint64_t size, int32_t width, int32_t height,
+                 int32_t frameNumber, int64_t timestampUs, uint32_t pixelFormat);
+
+    bool IsOpen() const { return header_ != nullptr; }
+    const std::string &GetName() const { return name_; }
+    uint32_t GetSlotCount() const { return header_ ? header_->slotCount : 0; }
+    uint64_t GetSlotCapacity() const { return header_ ? header_->slotCapacity : 0; }
+
+  private:
+    SharedFrameSegment segment_;
+    FrameRingHeader *header_ = nullptr;
+    std::string name_;
+};
+
+// Zero-copy view of a slot. Pixels stay valid only while the writer hasn't lapped the ring;
+// check FrameRingReader::IsValid after using them.
+struct FrameRingView {
+    const uint8_t *pixels = nullptr;
+    uint64_t size = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t frameNumber = 0;
+    int64_t timestampUs = 0;
+    uint32_t pixelFormat = 0;
+    uint64_t frameIndex = 0;
+    uint32_t slot = 0;
+    uint64_t sequence = 0;
+};
+
+class FrameRingReader {
+  public:
+    FrameRingReader() = default;
+
+    bool Open(const std::string &name);
+    void Close();
+
+    // Wait up to timeoutMs for a frame newer than the last one returned and map the newest.
+    // Frames the reader was too slow for are skipped and counted.
+    bool Next(FrameRingView &view, int timeoutMs);
+
+    // True if the slot behind view has not been rewritten since Next returned it
+    bool IsValid(const FrameRingView &view) const;
+
+    // Copying variant of Next; retries if the writer laps the slot mid-copy
+    bool ReadNext(std::vector<uint8_t> &pixels, FrameRingView &meta, int timeoutMs);
+
+    bool IsWriterOpen() const { return header_ && header_->writerOpen.load(); }
+    uint64_t GetSkippedFrames() const { return skippedFrames_; }
+
+  private:
+    bool MapSlot(uint64_t frameIndex, FrameRingView &view) const;
+
+    SharedFrameSegment segment_;
+    FrameRingHeader *header_ = nullptr;
+    uint64_t nextIndex_ = 0;
+    uint64_t skippedFrames_ = 0;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "frame_broadcaster.h"
+#include "frame_ring.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+// Publishes broadcaster frames (converted to spec) into a shared-memory frame ring for
+// consumers on the same host
+class FrameRingPublisher {
+  public:
+    FrameRingPublisher(FrameBroadcaster *broadcaster, const FrameOutputSpec &spec,
+                       const std::string &name, uint32_t slotCount);
+    ~FrameRingPublisher();
+
+    FrameRingPublisher(const FrameRingPublisher &) = delete;
+    FrameRingPublisher &operator=(const FrameRingPublisher &) = delete;
+
+    // Subscribe and wait for the first frame, which sizes the ring's slots
+    bool Start(std::chrono::milliseconds timeout);
+    void Stop();
+
+    const std::string &GetName() const { return name_; }
+    uint32_t GetSlotCount() const { return slotCount_; }
+    uint64_t GetSlotCapacity() const { return writer_.GetSlotCapacity(); }
+
+  private:
+    void OnFrame(const CapturedFrame &frame);
+
+    FrameBroadcaster *broadcaster_;
+    FrameOutputSpec spec_;
+    std::string name_;
+    uint32_t slotCount_;
+    uint64_t subscriptionId_;
+    bool subscribed_;
+
+    std::mutex mutex_;
+    std::condition_variable readyCv_;
+    FrameRingWriter writer_;
+    bool failed_;
+    bool oversizeWarned_;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <H5Cpp.h>
+
+// Fast compression filters for HDF5 datasets, under the filter ids registered with The HDF Group
+// so readers with the standard plugins (e.g. Python hdf5plugin) can decode them. LZ4 and zstd are
+// built in and use the same chunk format as the reference plugins; Blosc is only available as a
+// plugin on HDF5_PLUGIN_PATH.
+class H5CompressionFilters {
+  public:
+    static constexpr H5Z_filter_t kBlosc = 32001;
+    static constexpr H5Z_filter_t kLz4 = 32004;
+    static constexpr H5Z_filter_t kZstd = 32015;
+
+    // True if the filter can be used for writing. Registers the built-in LZ4/zstd filters unless
+    // HDF5 already has them (from a plugin).
+    static bool EnsureAvailable(H5Z_filter_t filter);
+};
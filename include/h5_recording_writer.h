@@ -1,75 +1,14 @@
 #pragma once
 
+#include "ring_queue.h"
 #include <H5Cpp.h>
+#include <array>
 #include <atomic>
-#include <condition_variable>
-#include <map>
-#include <mutex>
-#include <queue>
+#include <functional>
 #include <string>
 #include <thread>
 #include <vector>
 
-// Bounded queue for async frame buffering
-template <typename T> class BoundedQueue {
-  public:
-    explicit BoundedQueue(size_t maxSize) : maxSize_(maxSize), stopped_(false) {}
-
-    ~BoundedQueue() { stop(); }
-
-    void push(T item) {
-        std::unique_lock<std::mutex> lock(mutex_);
-
-        // Wait if queue is full
-        cvNotFull_.wait(lock, [this] { return queue_.size() < maxSize_ || stopped_; });
-
-        if (stopped_) {
-            return;
-        }
-
-        queue_.push(std::move(item));
-        cvNotEmpty_.notify_one();
-    }
-
-    bool pop(T &item) {
-        std::unique_lock<std::mutex> lock(mutex_);
-
-        // Wait if queue is empty
-        cvNotEmpty_.wait(lock, [this] { return !queue_.empty() || stopped_; });
-
-        if (stopped_ && queue_.empty()) {
-            return false;
-        }
-
-        item = std::move(queue_.front());
-        queue_.pop();
-        cvNotFull_.notify_one();
-        return true;
-    }
-
-    void stop() {
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            stopped_ = true;
-        }
-        cvNotEmpty_.notify_all();
-        cvNotFull_.notify_all();
-    }
-
-    size_t size() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return queue_.size();
-    }
-
-  private:
-    std::queue<T> queue_;
-    size_t maxSize_;
-    mutable std::mutex mutex_;
-    std::condition_variable cvNotEmpty_;
-    std::condition_variable cvNotFull_;
-    std::atomic<bool> stopped_;
-};
-
 // Frame data structure for HDF5 writing
 struct H5FrameData {
     int frameNumber;
@@ -77,21 +16,46 @@ struct H5FrameData {
     std::vector<uint8_t> pixels; // BGRA pixel data
     int width;
     int height;
-    std::map<std::string, std::string> memoryData;
-    double frameCaptureMs;
-    double memoryReadMs;
-    double diskWriteMs;
-    double totalLatencyMs;
+    std::vector<float> memoryValues;  // One per attribute, NaN where the read failed
+    std::array<uint8_t, 32> keyState; // Bit vk is set while virtual key vk is down
+    double frameCaptureMs; // Capture until the recorder picked the frame up
+    double memoryReadMs;   // Capture until the attributes were read
+    double keyStateMs;     // Capture until the key state was read
+    int64_t queuedUs = 0;  // Set by QueueFrame
+};
+
+// Filter applied to the frames dataset
+enum class H5FrameCompression {
+    None,
+    Deflate, // zlib, readable everywhere
+    Lz4,     // Needs the LZ4 plugin (e.g. hdf5plugin) to read
+    Zstd,    // Needs the zstd plugin to read
+    Blosc,   // Blosc/LZ4 with byte shuffle; needs the Blosc plugin to write and read
 };
 
-// HDF5 recording writer with async queue
+struct H5WriterOptions {
+    size_t queueSize = 16;     // Frames waiting for the writer thread
+    size_t batchFrames = 8;    // Frames written per extend and hyperslab write
+    size_t extentFrames = 512; // Rows added to every dataset when it runs out of space
+    H5FrameCompression compression = H5FrameCompression::Deflate;
+    int compressionLevel = 1; // Deflate 0-9, zstd 1-22, Blosc 0-9; unused by LZ4
+    int tileSize = 0;         // Square frame chunks of tileSize pixels; 0 = one frame per chunk
+    bool dropAlpha = false;   // Store BGR frames [N,H,W,3]; captured alpha is constant
+    // Column names for the inputs dataset; defaults to UNKNOWN_<vk>
+    std::function<std::string(int vk)> keyName;
+};
+
+// HDF5 recording writer with async queue. Frames are buffered into batches and each dataset
+// is written with one hyperslab per batch; datasets grow in large extents and are trimmed to the
+// frames written when the file is finalized. See HDF5_SCHEMA.md.
 class H5RecordingWriter {
   public:
     H5RecordingWriter(const std::string &filepath, int width, int height,
-                      const std::vector<std::string> &attributeNames, size_t queueSize = 120);
+                      const std::vector<std::string> &attributeNames,
+                      const H5WriterOptions &options = H5WriterOptions());
     ~H5RecordingWriter();
 
-    // Queue a frame for writing (non-blocking)
+    // Queue a frame for writing (blocks while the queue is full)
     void QueueFrame(H5FrameData frameData);
 
     // Stop writing and wait for queue to drain
@@ -99,27 +63,60 @@ class H5RecordingWriter {
 
     // Get current queue size
     size_t GetQueueSize() const { return queue_.size(); }
+    size_t GetQueueCapacity() const { return options_.queueSize; }
 
     // Get total frames written
     int GetFramesWritten() const { return framesWritten_.load(); }
 
+    static constexpr int kInputColumns = 300;
+    static constexpr int kLatencyColumns = 5;
+
+    static bool ParseCompression(const std::string &name, H5FrameCompression &compression);
+    static const char *CompressionName(H5FrameCompression compression);
+
+    // False if the compression needs an HDF5 filter plugin that cannot be loaded
+    static bool CompressionAvailable(H5FrameCompression compression);
+
   private:
     void WriterThread();
-    void WriteFrame(const H5FrameData &frameData);
+    void AddToBatch(const H5FrameData &frameData);
+    void WriteBatch();
+    void EnsureCapacity(hsize_t rows);
+    void WriteRows(H5::DataSet &dataset, hsize_t rows, const void *data,
+                   const H5::PredType &type);
     void InitializeDatasets();
+    void WriteKeyMapping();
 
     std::string filepath_;
     int width_;
     int height_;
+    int channels_; // 4, or 3 with dropAlpha
     std::vector<std::string> attributeNames_;
+    H5WriterOptions options_;
 
     H5::H5File file_;
     H5::DataSet framesDataset_;
+    H5::DataSet frameNumbersDataset_;
     H5::DataSet timestampsDataset_;
     H5::DataSet memoryDataset_;
+    H5::DataSet inputsDataset_;
     H5::DataSet latenciesDataset_;
 
-    BoundedQueue<H5FrameData> queue_;
+    // Current batch, laid out like the datasets so each is written with a single call
+    size_t batchRows_;
+    std::vector<uint8_t> batchPixels_;
+    std::vector<int32_t> batchFrameNumbers_;
+    std::vector<int64_t> batchTimestamps_;
+    std::vector<float> batchMemory_;
+    std::vector<uint8_t> batchInputs_;
+    std::vector<float> batchLatencies_;
+    hsize_t capacity_; // Rows allocated in every dataset
+
+    // Inputs columns are assigned to keys in the order they are first pressed
+    std::array<int, 256> keyColumns_;
+    std::vector<int> columnKeys_;
+
+    RingQueue<H5FrameData, QueueConcurrency::Spsc> queue_;
     std::thread writerThread_;
     std::atomic<int> framesWritten_;
     std::atomic<bool> finalized_;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "ring_queue.h"
 #include <atomic>
 #include <chrono>
 #include <fstream>
@@ -32,10 +33,11 @@ class InputEventLogger {
     std::ofstream outputFile_;
     std::mutex fileMutex_;
 
-    // Event buffer
-    std::vector<InputEvent> eventBuffer_;
-    std::mutex bufferMutex_;
-    size_t maxBufferSize_;
+    // Event buffer: hook thread -> writer thread. Events that don't fit are dropped, the hook
+    // must not block.
+    static constexpr size_t kMaxBufferedEvents = 10000;
+    RingQueue<InputEvent, QueueConcurrency::Spsc> events_;
+    std::atomic<size_t> droppedEvents_;
 
     // Hooks
     HHOOK keyboardHook_;
@@ -46,7 +48,8 @@ class InputEventLogger {
     void HookMessageLoop();
     void WriterLoop();
     void FlushBuffer();
-    std::string VirtualKeyToString(DWORD vkCode);
+    void PushEvent(InputEvent &&event);
+    void WriteEvents(const InputEvent *events, size_t count);
     int64_t GetCurrentTimestampUs();
 
     static LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam);
@@ -60,4 +63,7 @@ class InputEventLogger {
     bool StopLogging();
     bool IsLogging() const { return isLogging_; }
     size_t GetEventCount() const;
+
+    // Key name used in inputs.csv and the HDF5 key_mapping, UNKNOWN_<vk> if unmapped
+    static std::string VirtualKeyToString(DWORD vkCode);
 };
@@ -1,13 +1,82 @@
 #pragma once
 
-#include <vector>
 #include <cstdint>
+#include <string>
+#include <vector>
+
+// Forward declarations for FFmpeg types
+struct AVCodec;
+struct AVCodecContext;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+enum class JpegBackend {
+    TurboJpeg, // libjpeg-turbo: BGRA in directly, SIMD colour conversion and DCT
+    FFmpeg,    // swscale BGRA -> YUV, then the MJPEG encoder
+};
+
+enum class ChromaSubsampling {
+    S420,
+    S422,
+    S444,
+};
+
+struct JpegOptions {
+    JpegBackend backend = JpegBackend::TurboJpeg;
+    ChromaSubsampling subsampling = ChromaSubsampling::S420;
+    bool fastDct = false; // Faster, slightly less accurate DCT
+
+    // Compact identifier of the settings that affect the encoded bytes (e.g. "turbojpeg/420")
+    std::string Key() const;
+};
 
-// Simple JPEG encoder using FFmpeg
+// Reusable JPEG encoder. Backend state (FFmpeg codec context, YUV frame, scaler and packet, or
+// the TurboJPEG handle and output buffer) is kept across frames and only rebuilt when the frame
+// size changes.
+// Not thread-safe: use one instance per thread.
 class JpegEncoder {
   public:
-    // Encode BGRA pixels to JPEG
-    // Returns empty vector on failure
-    static std::vector<uint8_t> EncodeBGRA(const uint8_t* pixels, int width, int height, int quality = 85);
-};
+    explicit JpegEncoder(const JpegOptions &options = JpegOptions());
+    ~JpegEncoder();
+
+    JpegEncoder(const JpegEncoder &) = delete;
+    JpegEncoder &operator=(const JpegEncoder &) = delete;
+
+    // Encode BGRA pixels to JPEG into out (resized to the encoded size, capacity is reused)
+    // Returns false on failure
+    bool Encode(const uint8_t *pixels, int width, int height, int quality,
+                std::vector<uint8_t> &out);
+
+    const JpegOptions &GetOptions() const { return options_; }
+
+    // Option parsing; empty strings select the defaults
+    static bool ParseBackend(const std::string &name, JpegBackend &backend);
+    static bool ParseSubsampling(const std::string &name, ChromaSubsampling &subsampling);
+    static const char *BackendName(JpegBackend backend);
+    static const char *SubsamplingName(ChromaSubsampling subsampling);
 
+  private:
+    bool EncodeTurbo(const uint8_t *pixels, int width, int height, int quality,
+                     std::vector<uint8_t> &out);
+    bool EncodeFFmpeg(const uint8_t *pixels, int width, int height, int quality,
+                      std::vector<uint8_t> &out);
+
+    bool Open(int width, int height);
+    void Close();
+
+    JpegOptions options_;
+
+    // TurboJPEG backend
+    void *tjHandle_;
+    std::vector<uint8_t> turboBuffer_; // Worst-case output buffer, grown only on larger frames
+
+    // FFmpeg backend
+    const AVCodec *codec_;
+    AVCodecContext *codecCtx_;
+    AVFrame *yuvFrame_;
+    SwsContext *swsCtx_;
+    AVPacket *packet_;
+    int width_;
+    int height_;
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "frame_broadcaster.h"
+#include "process_attribute.h"
+#include "process_memory.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One typed attribute read
+struct AttributeValue {
+    std::string name;
+    std::string type; // "int", "float", "array" or "bool"
+    bool valid = false;
+    int32_t intValue = 0;
+    float floatValue = 0.0f;
+    std::vector<uint8_t> arrayValue;
+    bool boolValue = false;
+};
+
+// Bit vk is set while virtual key vk (keyboard keys and mouse buttons) is down
+using KeyStateBitmap = std::array<uint8_t, 32>;
+
+// Attributes and input state sampled right after a frame was captured
+struct ObservationSample {
+    int32_t frameNumber = 0;
+    int64_t captureTimestampUs = 0;
+    int64_t attributesTimestampUs = 0;
+    std::vector<AttributeValue> attributes;
+    bool hasKeyState = false;
+    KeyStateBitmap keyState{};
+    int64_t keyStateTimestampUs = 0;
+};
+
+// Samples attributes and key state at frame capture time for observation streams. Key state is
+// read inside the broadcaster callback, so it is exact for the frame. Attribute reads go through
+// ProcessMemory and can be slow, so a worker thread reads them as soon as a frame arrives; frames
+// captured while a read is in flight share the next sample.
+class ObservationSampler {
+  public:
+    // attributes are resolved by the caller from the process config
+    ObservationSampler(ProcessMemory *memory, const std::vector<ProcessAttribute> &attributes,
+                       bool keyState);
+    ~ObservationSampler();
+
+    ObservationSampler(const ObservationSampler &) = delete;
+    ObservationSampler &operator=(const ObservationSampler &) = delete;
+
+    void Start();
+    void Stop();
+
+    // Broadcaster callback hook
+    void OnCapture(const CapturedFrame &frame);
+
+    // Wait up to timeout for the first sample taken after frameNumber was captured
+    bool WaitForSample(int32_t frameNumber, ObservationSample &out,
+                       std::chrono::milliseconds timeout);
+
+    // Hand every sample to callback (on the sampler thread, in frame order). Samples are only
+    // kept for WaitForSample as well if keepSamples is set. Set before Start.
+    void SetSampleCallback(std::function<void(const ObservationSample &)> callback,
+                           bool keepSamples = false);
+
+    // Read every attribute once, stamped with a single timestamp
+    void ReadAttributes(ObservationSample &sample);
+
+    static void ReadKeyState(KeyStateBitmap &keyState);
+    static int64_t NowUs();
+
+  private:
+    struct PendingCapture {
+        int64_t captureTimestampUs = 0;
+        KeyStateBitmap keyState{};
+        int64_t keyStateTimestampUs = 0;
+    };
+
+    void SamplerThread();
+    void CompleteSample(ObservationSample &&sample);
+
+    ProcessMemory *memory_;
+    std::vector<ProcessAttribute> attributes_;
+    bool keyState_;
+    std::function<void(const ObservationSample &)> sampleCallback_;
+    bool keepSamples_;
+
+    std::thread samplerThread_;
+    std::atomic<bool> shouldStop_;
+    std::mutex mutex_;
+    std::condition_variable captureCv_;
+    std::condition_variable sampleCv_;
+    std::map<int32_t, PendingCapture> pending_; // Captures waiting for an attribute read
+    std::map<int32_t, ObservationSample> samples_; // Completed samples by frame number
+};
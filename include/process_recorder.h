@@ -1,13 +1,17 @@
 #pragma once
 
+#include "attribute_table_writer.h"
 #include "frame_broadcaster.h"
+#include "h5_recording_writer.h"
 #include "input_event_logger.h"
 #include "interception.h"
+#include "observation_sampler.h"
 #include "process_attribute.h"
 #include "process_capture.h"
 #include "process_input.h"
 #include "process_memory.h"
-#include "video_encoder.h"
+#include "ring_queue.h"
+#include "segmented_video_encoder.h"
 #include <atomic>
 #include <chrono>
 #include <fstream>
@@ -19,12 +23,6 @@
 #include <vector>
 #include <windows.h>
 
-// Structure for memory data per frame
-struct MemoryFrameData {
-    int64_t timestampUs;
-    std::map<std::string, std::string> memoryData;
-};
-
 // Recording session statistics
 struct RecordingStats {
     int totalFrames;
@@ -36,6 +34,46 @@ struct RecordingStats {
     int64_t endTimeMs;
     double actualDurationSeconds;
     double actualFps;
+    int encoderDroppedFrames; // Discarded because the encoder queue was full
+    int missedFrames;         // Captured but never picked up by the recording loop
+    std::string stitchError;  // Set when segments could not be stitched; they stay in segments/
+};
+
+// Encoder queue state reported by GetRecordingStatus
+struct RecordingQueueStatus {
+    size_t queueSize = 0;
+    size_t queueCapacity = 0;
+    int encoderDroppedFrames = 0;
+    int missedFrames = 0;
+    int degradeLevel = 0;
+    double lastEncodeMs = 0.0;
+    double averageEncodeMs = 0.0;
+    int segments = 0;     // Segment files started (segmented recording only)
+    int openSegments = 0; // Segments still encoding
+};
+
+// When memory_data rows are taken
+enum class AttributeSampling {
+    PerFrame, // One row per captured frame, stamped with its frame number and capture time
+    Interval, // Fixed rate on its own thread, independent of capture
+};
+
+// Where frames are written
+enum class RecordingSink {
+    Video, // Encoded video file plus memory_data.arrow
+    Hdf5,  // recording.h5 with frames, attributes and key state per frame (HDF5_SCHEMA.md)
+};
+
+struct RecordingOptions {
+    RecordingSink sink = RecordingSink::Video;
+    H5WriterOptions hdf5; // RecordingSink::Hdf5 only
+    VideoEncoderConfig encoder;
+    size_t encoderQueueFrames = 0; // 0 = 8, or half a second of frames per segment
+    QueueFullPolicy queueFullPolicy = QueueFullPolicy::DropOldest;
+    SegmentOptions segments; // Stitched into the usual video file when recording stops
+    AttributeSampling attributeSampling = AttributeSampling::PerFrame;
+    double attributeSampleHz = 60.0; // AttributeSampling::Interval only
+    bool exportMemoryCsv = true;     // memory_data.csv next to memory_data.arrow
 };
 
 class ProcessRecorder {
@@ -62,37 +100,63 @@ class ProcessRecorder {
     std::atomic<int> currentFrame_;
     std::atomic<int> droppedFrames_;
     std::atomic<double> currentLatencyMs_;
+    std::atomic<int> missedFrames_;
+    int32_t lastFrameNumber_;
     RecordingStats stats_;
     std::mutex statsMutex_;
 
-    // Video encoder (lossless)
-    std::unique_ptr<VideoEncoder> videoEncoder_;
+    // Video encoder, optionally split into segment files
+    std::unique_ptr<SegmentedVideoEncoder> videoEncoder_;
+    std::string videoPath_;
+
+    // Single-file HDF5 writer, used instead of the video encoder for RecordingSink::Hdf5
+    RecordingSink sink_;
+    std::unique_ptr<H5RecordingWriter> h5Writer_;
 
     // Input event logger (runs independently)
     std::unique_ptr<InputEventLogger> inputLogger_;
 
-    // Memory data CSV writer
-    std::ofstream memoryFile_;
+    // Attribute sampling; the sampler also performs the batched reads in interval mode
+    std::unique_ptr<ObservationSampler> attributeSampler_;
+    AttributeSampling attributeSampling_;
+    double attributeSampleHz_;
+    std::atomic<int> skippedSamples_; // Interval ticks missed because reads overran
+
+    // Typed memory data table (memory_data.arrow)
+    std::unique_ptr<AttributeTableWriter> memoryTable_;
     std::mutex memoryMutex_;
+    bool exportMemoryCsv_;
 
     // Performance data CSV writer
     std::ofstream perfFile_;
     std::mutex perfMutex_;
 
-    // Frame subscription
+    // Frames missing from the video, so the timeline can be reconstructed
+    std::ofstream droppedFile_;
+    std::mutex droppedMutex_;
+
+    // Per-frame encode times (written by the encoder thread)
+    std::ofstream encodeFile_;
+
+    // Frame subscription: broadcaster callback -> recording loop. When full the callback evicts
+    // the oldest capture (multi-consumer), which shows up as not_collected.
     uint64_t frameSubscriptionId_;
-    std::atomic<bool> hasNewFrame_;
-    std::mutex frameMutex_;
-    CapturedFrame latestFrame_;
+    RingQueue<CapturedFrame, QueueConcurrency::Mpmc> frameMailbox_;
 
     // Private methods
+    void AbortStart();
+    bool StartVideoEncoder(const RecordingOptions &options);
     void RecordingLoop();
     void MemoryReadingLoop();
-    void WriteMemoryHeader();
-    void WriteMemoryFrame(const MemoryFrameData &data);
+    void QueueH5Frame(CapturedFrame &frame);
+    void WriteMemorySample(const ObservationSample &sample, int32_t frameNumber,
+                           int64_t timestampUs);
     void WritePerfHeader();
     void WritePerfData(int frame, int64_t timestampUs, double totalMs, double captureMs, double fps,
                        size_t queueSize, int dropped);
+    void WriteDroppedHeader();
+    void WriteDroppedFrame(int32_t frameNumber, int64_t timestampUs, const char *reason);
+    void WriteEncodeTime(const EncoderFrame &frame, double encodeMs);
     std::string GenerateSessionId();
     bool CreateOutputDirectories();
 
@@ -103,10 +167,18 @@ class ProcessRecorder {
 
     // Main API
     bool StartRecording(const std::vector<std::string> &attributeNames,
-                        const std::string &outputDirectory, int maxDurationSeconds);
+                        const std::string &outputDirectory, int maxDurationSeconds,
+                        const RecordingOptions &options = RecordingOptions());
     bool StopRecording(RecordingStats &stats);
     bool GetStatus(bool &isRecording, int &currentFrame, double &elapsedTime,
                    double &currentLatency, int &droppedFrames);
+    bool GetQueueStatus(RecordingQueueStatus &status);
 
     std::string GetSessionId() const { return sessionId_; }
+
+    // Wire names "frame" (default) and "interval"
+    static bool ParseAttributeSampling(const std::string &name, AttributeSampling &sampling);
+
+    // Wire names "video" (default) and "hdf5"
+    static bool ParseRecordingSink(const std::string &name, RecordingSink &sink);
 };
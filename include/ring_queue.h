@@ -0,0 +1,281 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Futex-style wakeup for RingQueue. Waiters sleep on a 32-bit sequence that notifiers bump
+// (WaitOnAddress on Windows, futex on Linux), after a short spin. A notify only writes shared
+// memory or makes a system call when a thread went to sleep since the last one, so a busy
+// pipeline hands items over without either.
+class alignas(64) QueueEvent {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    QueueEvent() : sequence_(0), sleeping_(false) {}
+
+    QueueEvent(const QueueEvent &) = delete;
+    QueueEvent &operator=(const QueueEvent &) = delete;
+
+    // Wait until ready() or the deadline (Clock::time_point::max() = none); returns ready()
+    template <typename Ready> bool WaitUntil(Ready ready, Clock::time_point deadline) {
+        for (int spin = 0; spin < kSpinCount; ++spin) {
+            if (ready()) {
+                return true;
+            }
+            CpuRelax();
+        }
+
+        while (true) {
+            // Announce the sleep before the last check, so a notify after it must see it
+            sleeping_.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const uint32_t expected = sequence_.load();
+            if (ready()) {
+                return true;
+            }
+
+            int64_t timeoutUs = -1;
+            if (deadline != Clock::time_point::max()) {
+                auto remaining = deadline - Clock::now();
+                if (remaining <= Clock::duration::zero()) {
+                    return false;
+                }
+                timeoutUs =
+                    std::chrono::duration_cast<std::chrono::microseconds>(remaining).count() + 1;
+            }
+            Sleep(expected, timeoutUs);
+        }
+    }
+
+    // Callers have already published the state ready() checks. Every sleeper is woken, as the
+    // one claiming sleeping_ cannot know how many there are; they re-check and sleep again.
+    void Notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false)) {
+            sequence_.fetch_add(1);
+            Wake();
+        }
+    }
+
+  private:
+    static constexpr int kSpinCount = 64;
+
+    static void CpuRelax() {
+#if defined(_M_X64) || defined(__x86_64__)
+        _mm_pause();
+#endif
+    }
+
+    // Sleep while sequence_ == expected, at most timeoutUs (< 0 = no limit). May return early.
+    void Sleep(uint32_t expected, int64_t timeoutUs);
+    void Wake();
+
+    std::atomic<uint32_t> sequence_;
+    std::atomic<bool> sleeping_;
+};
+
+enum class QueueConcurrency {
+    Spsc, // One producer thread and one consumer thread
+    Mpmc, // Any number of producers and consumers
+};
+
+// Bounded lock-free ring queue of exactly `capacity` items. Each cell carries a sequence number
+// that tells producers and consumers whether it is free or filled, so the only shared writes are
+// the head/tail claims (a plain store for Spsc, a CAS for Mpmc). Blocking calls spin briefly and
+// then sleep on a QueueEvent. After close() pushes fail and pops drain what is left.
+// Method names follow the standard containers, like the queue it replaces.
+template <typename T, QueueConcurrency Concurrency = QueueConcurrency::Mpmc> class RingQueue {
+  public:
+    explicit RingQueue(size_t capacity)
+        : capacity_(capacity > 0 ? capacity : 1), cells_(new Cell[capacity_]), tail_(0),
+          head_(0), closed_(false) {
+        for (size_t i = 0; i < capacity_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~RingQueue() { close(); }
+
+    RingQueue(const RingQueue &) = delete;
+    RingQueue &operator=(const RingQueue &) = delete;
+
+    // Non-blocking. Returns false if the queue is full or closed; item is only moved from on
+    // success, so callers can apply their own drop policy.
+    bool try_push(T &&item) {
+        if (closed_.load(std::memory_order_acquire) || !TryPush(item)) {
+            return false;
+        }
+        notEmpty_.Notify();
+        return true;
+    }
+
+    // Blocks while the queue is full. Returns false (item not queued) once closed.
+    bool push(T &&item) {
+        while (!closed_.load(std::memory_order_acquire)) {
+            if (TryPush(item)) {
+                notEmpty_.Notify();
+                return true;
+            }
+            notFull_.WaitUntil([this] { return CanPush() || closed(); },
+                               QueueEvent::Clock::time_point::max());
+        }
+        return false;
+    }
+
+    bool try_pop(T &item) { return try_pop_n(&item, 1) == 1; }
+
+    // Blocks until an item arrives. Returns false once closed and drained.
+    bool pop(T &item) { return pop_n(&item, 1) == 1; }
+
+    template <typename Rep, typename Period>
+    bool pop_for(T &item, std::chrono::duration<Rep, Period> timeout) {
+        return pop_n_for(&item, 1, timeout) == 1;
+    }
+
+    // Up to max items in queue order, without waiting
+    size_t try_pop_n(T *out, size_t max) {
+        size_t count = 0;
+        while (count < max && TryPop(out[count])) {
+            count++;
+        }
+        if (count > 0) {
+            notFull_.Notify();
+        }
+        return count;
+    }
+
+    // Waits for the first item, then takes up to max. Returns 0 once closed and drained.
+    size_t pop_n(T *out, size_t max) {
+        return PopUntil(out, max, QueueEvent::Clock::time_point::max());
+    }
+
+    // As pop_n, but returns 0 if nothing arrives within timeout
+    template <typename Rep, typename Period>
+    size_t pop_n_for(T *out, size_t max, std::chrono::duration<Rep, Period> timeout) {
+        auto deadline =
+            QueueEvent::Clock::now() +
+            std::chrono::duration_cast<QueueEvent::Clock::duration>(timeout);
+        return PopUntil(out, max, deadline);
+    }
+
+    void close() {
+        closed_.store(true);
+        notEmpty_.Notify();
+        notFull_.Notify();
+    }
+
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+    // Exact when called from a producer or consumer with the other side idle, approximate
+    // otherwise
+    size_t size() const {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        size_t used = tail > head ? tail - head : 0;
+        return used < capacity_ ? used : capacity_;
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return capacity_; }
+
+  private:
+    static constexpr bool kSingleThreaded = Concurrency == QueueConcurrency::Spsc;
+
+    struct Cell {
+        std::atomic<size_t> sequence; // pos while free for the push at pos, pos + 1 once filled
+        T value;
+    };
+
+    bool CanPush() const {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        return cells_[pos % capacity_].sequence.load(std::memory_order_acquire) == pos;
+    }
+
+    bool CanPop() const {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        return cells_[pos % capacity_].sequence.load(std::memory_order_acquire) == pos + 1;
+    }
+
+    bool TryPush(T &item) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true) {
+            cell = &cells_[pos % capacity_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::make_signed_t<size_t>>(sequence - pos);
+            if (diff == 0) {
+                if constexpr (kSingleThreaded) {
+                    tail_.store(pos + 1, std::memory_order_relaxed);
+                    break;
+                }
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // Full: the cell still holds the item from a lap ago
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T &item) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true) {
+            cell = &cells_[pos % capacity_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::make_signed_t<size_t>>(sequence - (pos + 1));
+            if (diff == 0) {
+                if constexpr (kSingleThreaded) {
+                    head_.store(pos + 1, std::memory_order_relaxed);
+                    break;
+                }
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // Empty
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+        item = std::move(cell->value);
+        cell->sequence.store(pos + capacity_, std::memory_order_release);
+        return true;
+    }
+
+    size_t PopUntil(T *out, size_t max, QueueEvent::Clock::time_point deadline) {
+        while (true) {
+            size_t count = try_pop_n(out, max);
+            if (count > 0 || max == 0) {
+                return count;
+            }
+            if (closed()) {
+                return try_pop_n(out, max); // A push may have landed just before close
+            }
+            if (!notEmpty_.WaitUntil([this] { return CanPop() || closed(); }, deadline)) {
+                return 0;
+            }
+        }
+    }
+
+    const size_t capacity_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<size_t> tail_; // Next position to push
+    alignas(64) std::atomic<size_t> head_; // Next position to pop
+    alignas(64) std::atomic<bool> closed_;
+    QueueEvent notEmpty_; // Consumers sleep here
+    QueueEvent notFull_;  // Producers sleep here
+};
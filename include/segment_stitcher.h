@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Joins recording segments into one video by copying packets (no re-encoding)
+class SegmentStitcher {
+  public:
+    struct Entry {
+        std::string file;        // As written in the playlist (relative to it unless absolute)
+        int64_t durationUs = -1; // Time until the next entry starts; -1 = the file's own length
+    };
+
+    // Remux the files of an ffconcat playlist (as written by SegmentedVideoEncoder) into
+    // outputPath. Each file is shifted to start where the previous entry's duration ends.
+    static bool Stitch(const std::string &playlistPath, const std::string &outputPath,
+                       std::string &error);
+
+    // Parse the "file" and "duration" directives of an ffconcat playlist
+    static bool ReadPlaylist(const std::string &playlistPath, std::vector<Entry> &entries,
+                             std::string &error);
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "video_encoder.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SegmentOptions {
+    double segmentSeconds = 0.0; // 0 = one video file for the whole session
+    size_t parallelSegments = 2; // Segments still encoding at once, the filling one included
+};
+
+// One segment file as listed in the manifest
+struct SegmentInfo {
+    int index = 0;
+    std::string file; // Relative to the session directory
+    int32_t firstFrame = 0;
+    int32_t lastFrame = 0;
+    int64_t startUs = 0; // Capture timestamp of the first frame
+    int64_t endUs = 0;   // Capture timestamp of the last frame
+    int frames = 0;      // Frames queued for this segment
+    int encoded = 0;
+    int dropped = 0;
+    bool complete = false; // File finalized (trailer written)
+};
+
+// Recording encoder that splits the session into fixed-duration segments, each an independent
+// file from its own VideoEncoder starting with a keyframe, so a crash loses at most the segments
+// still open. Frames only go to the newest segment and every encoder gets all cores: a closed
+// segment flushes its queue and the codec's delayed frames on a finisher thread while the next
+// one fills, which keeps segment boundaries from stalling capture but does not raise sustained
+// throughput above a single VideoEncoder. Completed segments are listed in segments.csv and in
+// segments.ffconcat, which SegmentStitcher (or ffmpeg's concat demuxer) remuxes into one file
+// without re-encoding.
+//
+// With segmentSeconds 0 it encodes a single file at videoPath, like a plain VideoEncoder.
+class SegmentedVideoEncoder {
+  public:
+    SegmentedVideoEncoder();
+    ~SegmentedVideoEncoder();
+
+    // videoPath is the single-file output; segments go to segments/ next to it. A
+    // queueOptions.maxQueueFrames of 0 selects the default: 8 frames, or half a second of frames
+    // per segment so the next segment can take the backlog while the previous one flushes.
+    bool Initialize(const std::string &videoPath, int width, int height, int fps,
+                    const VideoEncoderConfig &config, const EncoderQueueOptions &queueOptions,
+                    const SegmentOptions &segments = SegmentOptions());
+
+    // Called from one thread only (the recording loop)
+    void EncodeFrame(EncoderFrame frame);
+
+    // Finalize every segment and write the final manifest
+    void Finalize();
+
+    bool IsSegmented() const { return segmentDurationUs_ > 0; }
+    std::string GetPlaylistPath() const { return playlistPath_; }
+    std::vector<SegmentInfo> GetSegments();
+
+    // Totals across segments, as for VideoEncoder
+    size_t GetQueueSize();
+    size_t GetQueueCapacity() const;
+    int GetFramesEncoded();
+    int GetFramesDropped();
+    int GetDegradeLevel();
+    double GetLastEncodeMs();
+    double GetAverageEncodeMs();
+    int GetOpenSegments();
+
+  private:
+    struct Segment {
+        SegmentInfo info;
+        std::unique_ptr<VideoEncoder> encoder; // Released once the segment is complete
+        std::thread finisher;                  // Runs encoder->Finalize()
+        double encodeMs = 0.0;                 // Total encode time, kept after release
+    };
+
+    void OpenSegment();
+    void CloseSegment(Segment &segment);
+    void JoinFinishedSegments(bool all);
+    size_t CountOpenSegments() const;
+    void WriteManifest();
+
+    std::string videoPath_;
+    std::string directory_;
+    std::string playlistPath_;
+    std::string manifestPath_;
+    int width_;
+    int height_;
+    int fps_;
+    VideoEncoderConfig config_;
+    EncoderQueueOptions queueOptions_;
+    size_t parallelSegments_;
+    int64_t segmentDurationUs_;
+
+    std::mutex mutex_;
+    std::condition_variable segmentDoneCv_;
+    std::vector<std::unique_ptr<Segment>> segments_;
+    Segment *current_; // Segment receiving frames
+    std::atomic<double> lastEncodeMs_;
+    bool finalized_;
+};
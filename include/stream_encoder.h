@@ -0,0 +1,118 @@
+#pragma once
+
+#include "encoded_frame_cache.h"
+#include "frame_broadcaster.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Forward declarations for FFmpeg types
+struct AVCodecContext;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+struct StreamEncoderConfig {
+    std::string codec = "h264"; // "h264" or "hevc"
+    int gopSize = 60;           // Frames between periodic keyframes
+    int crf = 23;
+    std::string preset = "veryfast";
+    FrameOutputSpec spec; // Broadcaster conversion (size, region); pixel format is always BGRA
+    FrameRateLimit rateLimit;
+
+    // Identifies encoders that can be shared between viewers
+    std::string Key() const;
+};
+
+// One encoded access unit (Annex-B NAL units with in-band parameter sets on keyframes)
+struct EncodedPacket {
+    EncodedBuffer data;
+    bool keyframe = false;
+    int32_t frameNumber = 0;
+    int64_t timestampUs = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+};
+
+// Low-latency H.264/HEVC encoder shared by all viewers of the same configuration. Subscribes to
+// the broadcaster, encodes on its own thread (zerolatency, no B-frames) and fans the packets out
+// to per-viewer queues. New viewers, and viewers that fell behind, trigger an on-demand IDR (at
+// most one per GOP per viewer) and only receive packets from the next keyframe on.
+class StreamEncoder {
+  public:
+    StreamEncoder(FrameBroadcaster *broadcaster, const StreamEncoderConfig &config);
+    ~StreamEncoder();
+
+    StreamEncoder(const StreamEncoder &) = delete;
+    StreamEncoder &operator=(const StreamEncoder &) = delete;
+
+    bool Start();
+    void Stop();
+
+    // Viewers
+    uint64_t AddViewer();
+    void RemoveViewer(uint64_t viewerId);
+
+    // Drop the viewer's backlog and restart it from the next keyframe. A viewer forces an IDR
+    // at most once per GOP, so one slow viewer can't turn the shared stream into IDRs only.
+    void ResyncViewer(uint64_t viewerId);
+
+    // Wait up to timeout for the viewer's next packet
+    bool NextPacket(uint64_t viewerId, EncodedPacket &out, std::chrono::milliseconds timeout);
+
+    // Make the next encoded frame an IDR
+    void RequestKeyframe() { keyframeRequested_ = true; }
+
+    FrameBroadcaster *GetBroadcaster() const { return broadcaster_; }
+    const StreamEncoderConfig &GetConfig() const { return config_; }
+
+  private:
+    struct Viewer {
+        std::deque<EncodedPacket> packets;
+        bool waitingForKeyframe = true;
+        uint64_t forcedKeyframeAt = 0; // packetsPublished_ when it last requested an IDR
+    };
+
+    void OnFrame(const CapturedFrame &frame);
+    void EncoderThread();
+    bool OpenCodec(int width, int height);
+    void CloseCodec();
+    bool EncodeInternal(const CapturedFrame &frame);
+    void Publish(EncodedPacket packet);
+    bool MayForceKeyframe(Viewer &viewer);
+
+    FrameBroadcaster *broadcaster_;
+    StreamEncoderConfig config_;
+    uint64_t subscriptionId_;
+
+    // Latest frame from the broadcaster (older unencoded frames are replaced)
+    std::thread encoderThread_;
+    std::mutex frameMutex_;
+    std::condition_variable frameCv_;
+    CapturedFrame pendingFrame_;
+    bool hasPendingFrame_;
+    std::atomic<bool> shouldStop_;
+    std::atomic<bool> isRunning_;
+    std::atomic<bool> keyframeRequested_;
+
+    // FFmpeg context (encoder thread only)
+    AVCodecContext *codecContext_;
+    SwsContext *swsContext_;
+    AVFrame *yuvFrame_;
+    AVPacket *packet_;
+    int sourceWidth_;
+    int sourceHeight_;
+    int64_t firstFrameTimestamp_;
+
+    // Viewers
+    std::mutex viewersMutex_;
+    std::condition_variable packetCv_;
+    std::unordered_map<uint64_t, Viewer> viewers_;
+    uint64_t nextViewerId_;
+    uint64_t packetsPublished_;
+};
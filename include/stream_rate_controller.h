@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+struct RateControlOptions {
+    int64_t maxLatencyUs = 250000; // Budget from capture to the frame being written to the stream
+    int minQuality = 0;            // Lowest JPEG quality to adapt down to (0 = fixed quality)
+    float minScale = 1.0f;         // Smallest resolution scale to adapt down to (1 = fixed size)
+};
+
+// Per-stream backpressure controller. Tracks how long writes to the client take and the
+// throughput they achieve, and drops frames that could no longer arrive within the latency
+// budget. While the stream stays congested (drops, or writes eating half the budget) it steps
+// JPEG quality and then resolution down to the client's bounds, and back up once writes are
+// fast again. Thread-safe: encoder threads read quality/scale (and may drop frames) while
+// the writing thread reports writes.
+class StreamRateController {
+  public:
+    StreamRateController(const RateControlOptions &options, int quality);
+
+    // Whether a frame captured at timestampUs (system clock) can still be sent in budget.
+    // Counts a drop (and adapts) when it returns false. With the payload size known, its write
+    // time is predicted from the measured throughput, so a large keyframe or a high-quality JPEG
+    // is judged by its own size rather than by the average write.
+    bool ShouldSend(int64_t timestampUs, size_t bytes = 0);
+
+    // Record a completed write of bytes that took writeUs
+    void OnWrite(size_t bytes, int64_t writeUs);
+
+    int GetQuality() const { return quality_; }
+    float GetScale() const { return scale_; }
+    float GetEffectiveFps();
+    uint64_t GetDroppedFrames() const { return droppedFrames_; }
+
+    static int64_t NowUs();
+
+  private:
+    void Adapt(bool congested); // Called with mutex_ held
+
+    std::mutex mutex_;
+    RateControlOptions options_;
+    int maxQuality_;
+    std::atomic<int> quality_;
+    std::atomic<float> scale_;
+
+    double writeUsEwma_;
+    double bytesPerUsEwma_;
+    std::deque<int64_t> sendTimesUs_; // Sends within the last second
+    int framesSinceStep_;
+    int calmFrames_;
+    std::atomic<uint64_t> droppedFrames_;
+};
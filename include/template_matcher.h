@@ -0,0 +1,83 @@
+#pragma once
+
+#include "frame_converter.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class MatchMethod {
+    NCC, // Zero-mean normalized cross-correlation, robust to brightness changes
+    SAD, // Sum of absolute differences, cheaper; score = 1 - SAD / (255 * pixels)
+};
+
+// A template as uploaded by a client
+struct TemplateSpec {
+    std::string name;
+    std::vector<uint8_t> bgra;
+    int32_t width = 0;
+    int32_t height = 0;
+    FrameRegion searchRegion; // Where to look (full frame by default)
+    MatchMethod method = MatchMethod::NCC;
+    float threshold = 0.8f; // Minimum score for a match
+    int pyramidLevels = -1; // Coarse-to-fine levels above full resolution (-1 = auto)
+};
+
+// Best position of one template in one frame (frame coordinates)
+struct TemplateMatch {
+    int32_t templateId = 0;
+    std::string name;
+    bool matched = false;
+    float score = 0.0f;
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+};
+
+// 8-bit single-channel image (tightly packed)
+struct GrayImage {
+    int32_t width = 0;
+    int32_t height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// Template registry and matcher for HUD element detection. Matching runs on grayscale copies of
+// each template's search region with an image pyramid: an exhaustive search at the coarsest
+// level, then a small refinement window at each finer level. Score kernels use AVX2 when
+// FrameConverter's SIMD kernels are enabled. Thread-safe; no platform dependencies.
+class TemplateMatcher {
+  public:
+    TemplateMatcher() : nextTemplateId_(1) {}
+
+    // Returns the new template's id, or -1 with error set
+    int32_t AddTemplate(const TemplateSpec &spec, std::string &error);
+    bool RemoveTemplate(int32_t templateId);
+    bool HasTemplate(int32_t templateId);
+    size_t GetTemplateCount();
+
+    // Match templateIds (empty = all registered) against a BGRA frame
+    void Match(const uint8_t *bgra, int width, int height, const std::vector<int32_t> &templateIds,
+               std::vector<TemplateMatch> &results);
+
+    // Best position of templ in image over the full search. Levels are pyramid levels above full
+    // resolution (-1 = auto). Returns the score at (x, y); -1 if templ doesn't fit.
+    static float FindBest(const GrayImage &image, const GrayImage &templ, MatchMethod method,
+                          int levels, int32_t &x, int32_t &y);
+
+    static bool ParseMethod(const std::string &name, MatchMethod &method);
+    static std::string MethodName(MatchMethod method);
+
+  private:
+    struct Template {
+        TemplateSpec spec; // Without the BGRA data
+        std::vector<GrayImage> pyramid;
+        int levels;
+    };
+
+    std::mutex mutex_;
+    std::map<int32_t, std::shared_ptr<const Template>> templates_;
+    int32_t nextTemplateId_;
+};
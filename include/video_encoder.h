@@ -1,9 +1,13 @@
 #pragma once
 
+#include "ring_queue.h"
+#include "yuv_converter.h"
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <functional>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <string>
 #include <thread>
 #include <vector>
@@ -15,7 +19,6 @@ struct AVFormatContext;
 struct AVFrame;
 struct AVPacket;
 struct AVStream;
-struct SwsContext;
 
 // Frame data for encoding
 struct EncoderFrame {
@@ -23,18 +26,64 @@ struct EncoderFrame {
     int64_t timestampUs;         // Microseconds since epoch
     int width;
     int height;
+    int32_t frameNumber = 0; // Capture frame number, reported for dropped frames
 };
 
-// Video encoder using FFmpeg with lossless compression
+// What EncodeFrame does when the queue already holds maxQueueFrames frames
+enum class QueueFullPolicy {
+    Block,      // Wait for the encoder; the caller falls behind capture instead
+    DropNewest, // Discard the incoming frame
+    DropOldest, // Discard the oldest queued frame
+    Degrade,    // Raise CRF so the encoder catches up, dropping the oldest frame meanwhile
+};
+
+struct EncoderQueueOptions {
+    size_t maxQueueFrames = 8; // BGRA frames held in memory (33 MB each at 4K)
+    QueueFullPolicy policy = QueueFullPolicy::DropOldest;
+    // Called for every discarded frame with the dropped_frames.csv reason: on the EncodeFrame
+    // thread for "encoder_queue_full", on the encoder thread for "size_mismatch"
+    std::function<void(const EncoderFrame &frame, const char *reason)> onDrop;
+    // Called on the encoder thread after each frame with its encode time
+    std::function<void(const EncoderFrame &frame, double encodeMs)> onEncoded;
+};
+
+// Recording codec settings. crf < 0 and an empty preset select per-codec defaults:
+//   "h264" libx264 CRF 20 veryfast      "hevc" libx265 CRF 22 fast
+//   "ffv1" FFV1 level 3, lossless RGB   "av1"  SVT-AV1 CRF 30 preset 8
+// Thread counts of 0 leave the choice to the codec (all cores).
+struct VideoEncoderConfig {
+    std::string codec = "h264";
+    int crf = -1;
+    std::string preset;
+    int frameThreads = 0; // x264/x265 frame threads, FFV1 workers, SVT-AV1 parallelism (lp)
+    int sliceThreads = 0; // x264 sliced threads, x265 worker pool, FFV1 slice count
+    bool zeroLatency = false; // x264/x265 "zerolatency" tune (no lookahead or B-frames)
+    // BGRA -> YUV 4:2:0 conversion (not used by FFV1). The stream is tagged accordingly.
+    YuvMatrix colorMatrix = YuvMatrix::BT601;
+    bool fullRange = false;
+    int convertThreads = 0; // Row bands converted in parallel (0 = from the core count)
+    // Fragmented output stays playable up to the last fragment if the process dies before
+    // Finalize: MP4 gets an empty moov plus a moof per fragment, MKV short clusters.
+    bool fragmented = false;
+    int fragmentMs = 1000;     // Longest fragment; each one is flushed to the OS when cut
+    int syncIntervalMs = 2000; // fsync cadence on a background thread (0 = leave it to the OS)
+
+    static bool IsSupportedCodec(const std::string &codec);
+    static std::string FileExtension(const std::string &codec); // ".mkv" for FFV1, else ".mp4"
+};
+
+// Video recording encoder (FFmpeg) with a bounded input queue and its own encode thread
 class VideoEncoder {
   public:
     VideoEncoder();
     ~VideoEncoder();
 
-    // Initialize encoder with lossless FFV1 codec
-    bool Initialize(const std::string &outputPath, int width, int height, int fps = 60);
+    bool Initialize(const std::string &outputPath, int width, int height, int fps = 60,
+                    const VideoEncoderConfig &config = VideoEncoderConfig(),
+                    const EncoderQueueOptions &queueOptions = EncoderQueueOptions());
 
-    // Queue frame for encoding (non-blocking)
+    // Queue frame for encoding. Never holds more than maxQueueFrames; blocks only with
+    // QueueFullPolicy::Block.
     void EncodeFrame(EncoderFrame frame);
 
     // Stop encoding and finalize video file
@@ -43,39 +92,77 @@ class VideoEncoder {
     // Get current queue size
     size_t GetQueueSize() const;
 
+    size_t GetQueueCapacity() const { return queueOptions_.maxQueueFrames; }
+
     // Get total frames encoded
     int GetFramesEncoded() const { return framesEncoded_.load(); }
 
+    // Frames discarded because the queue was full
+    int GetFramesDropped() const { return framesDropped_.load(); }
+
+    // CRF steps added by QueueFullPolicy::Degrade (0 = configured quality)
+    int GetDegradeLevel() const { return degradeLevel_.load(); }
+
+    // Encode time of the last frame and the session average
+    double GetLastEncodeMs() const { return lastEncodeMs_.load(); }
+    double GetAverageEncodeMs() const;
+
+    // Parse policy names used on the wire ("block", "drop_newest", "drop_oldest", "degrade")
+    static bool ParseQueueFullPolicy(const std::string &name, QueueFullPolicy &policy);
+    static std::string QueueFullPolicyName(QueueFullPolicy policy);
+
   private:
     void EncoderThread();
     bool InitializeFFmpeg();
     void CleanupFFmpeg();
     bool EncodeFrameInternal(const EncoderFrame &frame);
+    void DropFrame(const EncoderFrame &frame, const char *reason);
+    void RaiseDegradeLevel();
+    void UpdateDegradeLevel(size_t queueSize);
+    void ApplyCodecOptions();
+    void SyncThread();
 
     // Configuration
     std::string outputPath_;
     int width_;
     int height_;
     int fps_;
+    VideoEncoderConfig config_;
+    EncoderQueueOptions queueOptions_;
 
     // FFmpeg context
     AVFormatContext *formatContext_;
     AVCodecContext *codecContext_;
     AVStream *videoStream_;
-    SwsContext *swsContext_;
+    std::unique_ptr<YuvConverter> yuvConverter_; // Null for FFV1, which takes BGRA rows as-is
     AVFrame *yuvFrame_;
     AVPacket *packet_;
 
     // Threading
     std::thread encoderThread_;
-    std::queue<EncoderFrame> frameQueue_;
-    std::mutex queueMutex_;
-    std::condition_variable queueCV_;
-    std::atomic<bool> shouldStop_;
+    // Multi-consumer: drop-oldest pops from the EncodeFrame side too
+    std::unique_ptr<RingQueue<EncoderFrame, QueueConcurrency::Mpmc>> frameQueue_;
     std::atomic<bool> finalized_;
 
+    // Fragmented output: the encoder thread flushes, the sync thread makes it durable
+    std::chrono::steady_clock::time_point lastFlush_;
+    std::thread syncThread_;
+    std::mutex syncMutex_;
+    std::condition_variable syncCV_;
+    bool stopSync_;
+
     // Statistics
     std::atomic<int> framesEncoded_;
+    std::atomic<int> framesDropped_;
+    std::atomic<double> lastEncodeMs_;
+    std::atomic<double> totalEncodeMs_;
+
+    // Degrade policy state (level is raised by EncodeFrame, applied on the encoder thread)
+    std::mutex degradeMutex_; // Guards level changes and the two counters below
+    std::atomic<int> degradeLevel_;
+    int appliedDegradeLevel_;
+    int degradeRaisedAt_; // framesEncoded_ when the level was last raised
+    int calmFrames_;      // Consecutive frames encoded with a short queue
     int64_t firstFrameTimestamp_;
     int64_t lastFrameTimestamp_;
 };
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class YuvMatrix {
+    BT601, // SD coefficients (swscale's default for RGB input)
+    BT709, // HD coefficients
+};
+
+enum class YuvLayout {
+    I420, // Separate Y, U and V planes (AV_PIX_FMT_YUV420P)
+    NV12, // Y plane plus one interleaved UV plane (AV_PIX_FMT_NV12)
+};
+
+enum class YuvKernel {
+    Auto, // Best the CPU supports
+    Scalar,
+    SSE41,
+    AVX2,
+};
+
+// Destination planes; data[2]/linesize[2] are unused for NV12
+struct YuvPlanes {
+    uint8_t *data[3] = {nullptr, nullptr, nullptr};
+    int linesize[3] = {0, 0, 0};
+};
+
+// BGRA -> 4:2:0 YUV conversion for the recording encoder. Fixed point with 15-bit coefficients;
+// each chroma sample is computed from the sum of its 2x2 block (edge pixels repeat for odd
+// sizes). The AVX2 and SSE4.1 kernels are bit-exact with the scalar one. Frames are split into
+// row bands converted in parallel by a small worker pool plus the calling thread.
+class YuvConverter {
+  public:
+    // threads 0 = pick from the core count; 1 = calling thread only
+    YuvConverter(YuvMatrix matrix, bool fullRange, YuvLayout layout, int threads = 0);
+    ~YuvConverter();
+
+    YuvConverter(const YuvConverter &) = delete;
+    YuvConverter &operator=(const YuvConverter &) = delete;
+
+    // Convert a width x height BGRA frame into dst. srcStride is the distance between source
+    // rows in bytes (0 = tightly packed). Not reentrant: one frame at a time per converter.
+    void Convert(const uint8_t *bgra, int width, int height, size_t srcStride,
+                 const YuvPlanes &dst);
+
+    // Restrict the kernel (used by the benchmark); falls back if the CPU lacks it
+    void SetKernel(YuvKernel kernel);
+    YuvKernel GetKernel() const { return kernel_; }
+    int GetThreadCount() const { return static_cast<int>(workers_.size()) + 1; }
+
+    // Parse/format names used on the wire ("bt601", "bt709")
+    static bool ParseMatrix(const std::string &name, YuvMatrix &matrix);
+    static std::string MatrixName(YuvMatrix matrix);
+    static std::string KernelName(YuvKernel kernel);
+
+    // Coefficients in B, G, R order scaled by 2^15, and the offset plus rounding term added
+    // before the shift (luma: one pixel, >> 15; chroma: sum of 4 pixels, >> 17)
+    struct Coefficients {
+        int16_t y[3];
+        int16_t u[3];
+        int16_t v[3];
+        int32_t yBias;
+        int32_t cBias;
+    };
+
+  private:
+    void ConvertBand(size_t band);
+    void WorkerLoop(size_t worker);
+
+    Coefficients coeffs_;
+    YuvLayout layout_;
+    YuvKernel kernel_;
+
+    // Current frame, set by Convert for the bands
+    const uint8_t *src_;
+    int width_;
+    int height_;
+    size_t srcStride_;
+    YuvPlanes dst_;
+    int bandRows_;
+
+    std::vector<std::thread> workers_; // Worker i converts band i + 1
+    std::mutex mutex_;
+    std::condition_variable workCv_;
+    std::condition_variable doneCv_;
+    uint64_t generation_;
+    size_t pendingBands_;
+    bool stopping_;
+};
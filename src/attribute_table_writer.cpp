@@ -0,0 +1,579 @@
+#include "attribute_table_writer.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+constexpr char kArrowMagic[] = "ARROW1";
+constexpr uint32_t kContinuation = 0xFFFFFFFF;
+constexpr int16_t kMetadataV5 = 4;
+
+// Message header and Type union members of the Arrow flatbuffer schema
+constexpr uint8_t kHeaderSchema = 1;
+constexpr uint8_t kHeaderRecordBatch = 3;
+constexpr uint8_t kTypeInt = 2;
+constexpr uint8_t kTypeFloatingPoint = 3;
+constexpr uint8_t kTypeBool = 6;
+constexpr uint8_t kTypeFixedSizeBinary = 15;
+constexpr int16_t kPrecisionSingle = 1;
+
+size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+size_t BitmapBytes(size_t rows) { return (rows + 7) / 8; }
+
+// Just enough of a FlatBuffers encoder for Arrow IPC metadata. Objects are laid out front to
+// back, each table followed by the children it references, because offsets point forward.
+class FlatBuilder {
+  public:
+    using Child = std::function<size_t(FlatBuilder &)>;
+
+    struct Field {
+        int slot;
+        size_t size;    // Inline bytes: the scalar width, or 4 for an offset
+        uint64_t value; // Scalar bits (little endian)
+        Child child;    // Set for offsets to strings, vectors and tables
+    };
+
+    template <typename T> static Field Scalar(int slot, T value) {
+        Field field{slot, sizeof(T), 0, nullptr};
+        std::memcpy(&field.value, &value, sizeof(T));
+        return field;
+    }
+
+    static Field Offset(int slot, Child child) { return {slot, 4, 0, std::move(child)}; }
+
+    // A finished buffer: root offset, then the root object
+    static std::vector<uint8_t> Finish(const Child &root) {
+        FlatBuilder builder;
+        builder.Put<uint32_t>(0);
+        builder.Patch(0, root(builder));
+        return std::move(builder.buffer_);
+    }
+
+    size_t Table(std::vector<Field> fields) {
+        int slots = 0;
+        for (const Field &field : fields) {
+            slots = std::max(slots, field.slot + 1);
+        }
+
+        // Widest fields first, so each one is naturally aligned inside the 8-aligned table
+        std::stable_sort(fields.begin(), fields.end(),
+                         [](const Field &a, const Field &b) { return a.size > b.size; });
+        std::vector<uint16_t> fieldOffsets(slots, 0);
+        size_t inlineSize = 4; // soffset to the vtable
+        for (const Field &field : fields) {
+            inlineSize = AlignUp(inlineSize, field.size);
+            fieldOffsets[field.slot] = static_cast<uint16_t>(inlineSize);
+            inlineSize += field.size;
+        }
+
+        Align(2);
+        const size_t vtable = buffer_.size();
+        Put<uint16_t>(static_cast<uint16_t>(4 + 2 * slots));
+        Put<uint16_t>(static_cast<uint16_t>(inlineSize));
+        for (uint16_t offset : fieldOffsets) {
+            Put<uint16_t>(offset);
+        }
+
+        Align(8);
+        const size_t table = buffer_.size();
+        Put<int32_t>(static_cast<int32_t>(table - vtable));
+        buffer_.resize(table + inlineSize, 0);
+        for (const Field &field : fields) {
+            if (!field.child) {
+                std::memcpy(&buffer_[table + fieldOffsets[field.slot]], &field.value, field.size);
+            }
+        }
+        for (const Field &field : fields) {
+            if (field.child) {
+                const size_t at = table + fieldOffsets[field.slot];
+                Patch(at, field.child(*this));
+            }
+        }
+        return table;
+    }
+
+    size_t String(const std::string &value) {
+        Align(4);
+        const size_t position = buffer_.size();
+        Put<uint32_t>(static_cast<uint32_t>(value.size()));
+        buffer_.insert(buffer_.end(), value.begin(), value.end());
+        buffer_.push_back(0);
+        return position;
+    }
+
+    size_t TableVector(const std::vector<Child> &tables) {
+        Align(4);
+        const size_t position = buffer_.size();
+        Put<uint32_t>(static_cast<uint32_t>(tables.size()));
+        const size_t slots = buffer_.size();
+        buffer_.resize(slots + 4 * tables.size(), 0);
+        for (size_t i = 0; i < tables.size(); ++i) {
+            Patch(slots + 4 * i, tables[i](*this));
+        }
+        return position;
+    }
+
+    // Vector of 8-aligned structs, given as their packed bytes
+    size_t StructVector(const std::vector<uint8_t> &structs, size_t count) {
+        while ((buffer_.size() + 4) % 8 != 0) {
+            buffer_.push_back(0);
+        }
+        const size_t position = buffer_.size();
+        Put<uint32_t>(static_cast<uint32_t>(count));
+        buffer_.insert(buffer_.end(), structs.begin(), structs.end());
+        return position;
+    }
+
+  private:
+    template <typename T> void Put(T value) {
+        const size_t at = buffer_.size();
+        buffer_.resize(at + sizeof(T));
+        std::memcpy(&buffer_[at], &value, sizeof(T));
+    }
+
+    void Patch(size_t at, size_t target) {
+        const uint32_t offset = static_cast<uint32_t>(target - at);
+        std::memcpy(&buffer_[at], &offset, sizeof(offset));
+    }
+
+    void Align(size_t alignment) { buffer_.resize(AlignUp(buffer_.size(), alignment), 0); }
+
+    std::vector<uint8_t> buffer_;
+};
+
+template <typename T> void AppendPod(std::vector<uint8_t> &bytes, T value) {
+    const size_t at = bytes.size();
+    bytes.resize(at + sizeof(T));
+    std::memcpy(&bytes[at], &value, sizeof(T));
+}
+
+size_t WriteType(FlatBuilder &builder, const AttributeColumn &column) {
+    switch (column.type) {
+    case AttributeColumnType::Int32:
+    case AttributeColumnType::Int64:
+        return builder.Table({
+            FlatBuilder::Scalar<int32_t>(0, column.type == AttributeColumnType::Int32 ? 32 : 64),
+            FlatBuilder::Scalar<uint8_t>(1, 1), // is_signed
+        });
+    case AttributeColumnType::Float32:
+        return builder.Table({FlatBuilder::Scalar<int16_t>(0, kPrecisionSingle)});
+    case AttributeColumnType::Bool:
+        return builder.Table({});
+    case AttributeColumnType::Bytes:
+        return builder.Table(
+            {FlatBuilder::Scalar<int32_t>(0, static_cast<int32_t>(column.byteWidth))});
+    }
+    return builder.Table({});
+}
+
+uint8_t TypeId(AttributeColumnType type) {
+    switch (type) {
+    case AttributeColumnType::Float32:
+        return kTypeFloatingPoint;
+    case AttributeColumnType::Bool:
+        return kTypeBool;
+    case AttributeColumnType::Bytes:
+        return kTypeFixedSizeBinary;
+    default:
+        return kTypeInt;
+    }
+}
+
+size_t WriteSchema(FlatBuilder &builder, const std::vector<AttributeColumn> &columns) {
+    std::vector<FlatBuilder::Child> fields;
+    for (const AttributeColumn &column : columns) {
+        fields.push_back([&column](FlatBuilder &b) {
+            return b.Table({
+                FlatBuilder::Offset(0, [&column](FlatBuilder &s) { return s.String(column.name); }),
+                FlatBuilder::Scalar<uint8_t>(1, column.nullable ? 1 : 0),
+                FlatBuilder::Scalar<uint8_t>(2, TypeId(column.type)),
+                FlatBuilder::Offset(3, [&column](FlatBuilder &t) { return WriteType(t, column); }),
+                // Readers expect the children vector even for flat types
+                FlatBuilder::Offset(5, [](FlatBuilder &c) { return c.TableVector({}); }),
+            });
+        });
+    }
+    return builder.Table({
+        FlatBuilder::Scalar<int16_t>(0, 0), // Little endian
+        FlatBuilder::Offset(1, [&fields](FlatBuilder &b) { return b.TableVector(fields); }),
+    });
+}
+
+} // namespace
+
+AttributeTableWriter::AttributeTableWriter()
+    : rowsPerBatch_(0), rowsInBatch_(0), rowsWritten_(0), fileOffset_(0), open_(false) {}
+
+AttributeTableWriter::~AttributeTableWriter() {
+    if (open_) {
+        Close();
+    }
+}
+
+bool AttributeTableWriter::ColumnTypeFor(const std::string &attributeType,
+                                         AttributeColumnType &type) {
+    if (attributeType == "int") {
+        type = AttributeColumnType::Int32;
+    } else if (attributeType == "float") {
+        type = AttributeColumnType::Float32;
+    } else if (attributeType == "bool") {
+        type = AttributeColumnType::Bool;
+    } else if (attributeType == "array") {
+        type = AttributeColumnType::Bytes;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool AttributeTableWriter::Open(const std::string &path,
+                                const std::vector<ProcessAttribute> &attributes,
+                                size_t rowsPerBatch) {
+    path_ = path;
+    rowsPerBatch_ = std::max<size_t>(rowsPerBatch, 1);
+    rowsInBatch_ = 0;
+    rowsWritten_ = 0;
+    blocks_.clear();
+
+    columns_ = {
+        {"frame_number", AttributeColumnType::Int32, 4, false},
+        {"timestamp_us", AttributeColumnType::Int64, 8, false},
+        {"read_timestamp_us", AttributeColumnType::Int64, 8, false},
+    };
+    for (const ProcessAttribute &attribute : attributes) {
+        AttributeColumn column{attribute.AttributeName, AttributeColumnType::Int32, 4, true};
+        if (!ColumnTypeFor(attribute.AttributeType, column.type)) {
+            spdlog::error("Attribute {} has unsupported type '{}'", attribute.AttributeName,
+                          attribute.AttributeType);
+            return false;
+        }
+        if (column.type == AttributeColumnType::Bool) {
+            column.byteWidth = 0;
+        } else if (column.type == AttributeColumnType::Bytes) {
+            column.byteWidth = std::max<size_t>(attribute.AttributeLength, 1);
+        }
+        columns_.push_back(column);
+    }
+
+    // Column blocks are sized once; Append never allocates
+    values_.assign(columns_.size(), {});
+    validity_.assign(columns_.size(), {});
+    nullCounts_.assign(columns_.size(), 0);
+    for (size_t c = 0; c < columns_.size(); ++c) {
+        const AttributeColumn &column = columns_[c];
+        values_[c].resize(column.type == AttributeColumnType::Bool
+                              ? BitmapBytes(rowsPerBatch_)
+                              : column.byteWidth * rowsPerBatch_);
+        if (column.nullable) {
+            validity_[c].resize(BitmapBytes(rowsPerBatch_));
+        }
+    }
+
+    file_.open(path_, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        spdlog::error("Failed to open attribute table: {}", path_);
+        return false;
+    }
+    file_.write(kArrowMagic, 6);
+    file_.write("\0\0", 2);
+    fileOffset_ = 8;
+
+    std::vector<uint8_t> schema = FlatBuilder::Finish([this](FlatBuilder &b) {
+        return b.Table({
+            FlatBuilder::Scalar<int16_t>(0, kMetadataV5),
+            FlatBuilder::Scalar<uint8_t>(1, kHeaderSchema),
+            FlatBuilder::Offset(2, [this](FlatBuilder &s) { return WriteSchema(s, columns_); }),
+            FlatBuilder::Scalar<int64_t>(3, 0),
+        });
+    });
+    int32_t metadataLength = 0;
+    open_ = WriteMessage(kHeaderSchema, schema, {}, metadataLength);
+    return open_;
+}
+
+void AttributeTableWriter::Append(const ObservationSample &sample, int32_t frameNumber,
+                                  int64_t timestampUs) {
+    if (!open_) {
+        return;
+    }
+
+    const size_t row = rowsInBatch_;
+    std::memcpy(&values_[0][row * 4], &frameNumber, 4);
+    std::memcpy(&values_[1][row * 8], &timestampUs, 8);
+    std::memcpy(&values_[2][row * 8], &sample.attributesTimestampUs, 8);
+
+    for (size_t c = kKeyColumns; c < columns_.size(); ++c) {
+        const size_t a = c - kKeyColumns;
+        const AttributeValue *value =
+            a < sample.attributes.size() ? &sample.attributes[a] : nullptr;
+        const bool valid = value && value->valid;
+        const uint8_t bit = static_cast<uint8_t>(1u << (row & 7));
+        uint8_t *data = values_[c].data();
+        if (valid) {
+            validity_[c][row >> 3] |= bit;
+        } else {
+            nullCounts_[c]++;
+        }
+
+        switch (columns_[c].type) {
+        case AttributeColumnType::Int32: {
+            const int32_t stored = valid ? value->intValue : 0;
+            std::memcpy(data + row * 4, &stored, 4);
+            break;
+        }
+        case AttributeColumnType::Float32: {
+            const float stored = valid ? value->floatValue : 0.0f;
+            std::memcpy(data + row * 4, &stored, 4);
+            break;
+        }
+        case AttributeColumnType::Bool:
+            if (valid && value->boolValue) {
+                data[row >> 3] |= bit;
+            }
+            break;
+        case AttributeColumnType::Bytes: {
+            const size_t width = columns_[c].byteWidth;
+            const size_t copied = valid ? std::min(width, value->arrayValue.size()) : 0;
+            if (copied > 0) {
+                std::memcpy(data + row * width, value->arrayValue.data(), copied);
+            }
+            std::memset(data + row * width + copied, 0, width - copied);
+            break;
+        }
+        case AttributeColumnType::Int64:
+            break;
+        }
+    }
+
+    if (++rowsInBatch_ == rowsPerBatch_) {
+        WriteBatch();
+    }
+}
+
+std::vector<AttributeTableWriter::BufferSpan>
+AttributeTableWriter::BatchLayout(size_t rows, int64_t &bodyLength) const {
+    // Two buffers per column, validity then values; validity is empty for non-nullable columns
+    std::vector<BufferSpan> buffers;
+    int64_t offset = 0;
+    for (const AttributeColumn &column : columns_) {
+        const int64_t validity = column.nullable ? static_cast<int64_t>(BitmapBytes(rows)) : 0;
+        buffers.push_back({offset, validity});
+        offset += AlignUp(validity, 8);
+        const int64_t values = column.type == AttributeColumnType::Bool
+                                   ? static_cast<int64_t>(BitmapBytes(rows))
+                                   : static_cast<int64_t>(column.byteWidth * rows);
+        buffers.push_back({offset, values});
+        offset += AlignUp(values, 8);
+    }
+    bodyLength = offset;
+    return buffers;
+}
+
+bool AttributeTableWriter::WriteBatch() {
+    if (rowsInBatch_ == 0) {
+        return true;
+    }
+    const size_t rows = rowsInBatch_;
+
+    int64_t bodyLength = 0;
+    std::vector<BufferSpan> buffers = BatchLayout(rows, bodyLength);
+    std::vector<uint8_t> body(bodyLength, 0);
+    for (size_t c = 0; c < columns_.size(); ++c) {
+        const BufferSpan &validity = buffers[2 * c];
+        const BufferSpan &values = buffers[2 * c + 1];
+        if (validity.length > 0) {
+            std::memcpy(&body[validity.offset], validity_[c].data(), validity.length);
+        }
+        std::memcpy(&body[values.offset], values_[c].data(), values.length);
+    }
+
+    std::vector<uint8_t> nodes;
+    for (size_t c = 0; c < columns_.size(); ++c) {
+        AppendPod<int64_t>(nodes, static_cast<int64_t>(rows));
+        AppendPod<int64_t>(nodes, nullCounts_[c]);
+    }
+    std::vector<uint8_t> bufferStructs;
+    for (const BufferSpan &buffer : buffers) {
+        AppendPod<int64_t>(bufferStructs, buffer.offset);
+        AppendPod<int64_t>(bufferStructs, buffer.length);
+    }
+
+    auto recordBatch = [&](FlatBuilder &b) {
+        return b.Table({
+            FlatBuilder::Scalar<int64_t>(0, static_cast<int64_t>(rows)),
+            FlatBuilder::Offset(
+                1, [&](FlatBuilder &v) { return v.StructVector(nodes, columns_.size()); }),
+            FlatBuilder::Offset(
+                2, [&](FlatBuilder &v) { return v.StructVector(bufferStructs, buffers.size()); }),
+        });
+    };
+    std::vector<uint8_t> metadata = FlatBuilder::Finish([&](FlatBuilder &b) {
+        return b.Table({
+            FlatBuilder::Scalar<int16_t>(0, kMetadataV5),
+            FlatBuilder::Scalar<uint8_t>(1, kHeaderRecordBatch),
+            FlatBuilder::Offset(2, recordBatch),
+            FlatBuilder::Scalar<int64_t>(3, bodyLength),
+        });
+    });
+
+    Block block{fileOffset_, 0, bodyLength, rows};
+    if (!WriteMessage(kHeaderRecordBatch, metadata, body, block.metadataLength)) {
+        return false;
+    }
+    blocks_.push_back(block);
+
+    // A killed process loses at most the open batch
+    file_.flush();
+
+    rowsWritten_ += rows;
+    rowsInBatch_ = 0;
+    for (size_t c = 0; c < columns_.size(); ++c) {
+        std::fill(validity_[c].begin(), validity_[c].end(), 0);
+        if (columns_[c].type == AttributeColumnType::Bool) {
+            std::fill(values_[c].begin(), values_[c].end(), 0);
+        }
+        nullCounts_[c] = 0;
+    }
+    return true;
+}
+
+bool AttributeTableWriter::WriteMessage(uint8_t headerType, const std::vector<uint8_t> &metadata,
+                                        const std::vector<uint8_t> &body,
+                                        int32_t &metadataLength) {
+    // Encapsulated message: continuation marker, metadata size, flatbuffer padded to 8, body
+    const size_t padded = AlignUp(metadata.size(), 8);
+    const int32_t size = static_cast<int32_t>(padded);
+    static const char kPadding[8] = {};
+    file_.write(reinterpret_cast<const char *>(&kContinuation), 4);
+    file_.write(reinterpret_cast<const char *>(&size), 4);
+    file_.write(reinterpret_cast<const char *>(metadata.data()), metadata.size());
+    file_.write(kPadding, padded - metadata.size());
+    file_.write(reinterpret_cast<const char *>(body.data()), body.size());
+    if (!file_) {
+        spdlog::error("Failed to write {} to {}",
+                      headerType == kHeaderSchema ? "schema" : "record batch", path_);
+        return false;
+    }
+    metadataLength = static_cast<int32_t>(8 + padded);
+    fileOffset_ += 8 + padded + body.size();
+    return true;
+}
+
+bool AttributeTableWriter::Close() {
+    if (!open_) {
+        return false;
+    }
+    open_ = false;
+    bool ok = WriteBatch();
+
+    // End-of-stream marker, then the footer the file format adds for random access
+    const uint32_t endOfStream[2] = {kContinuation, 0};
+    file_.write(reinterpret_cast<const char *>(endOfStream), sizeof(endOfStream));
+
+    std::vector<uint8_t> blockStructs;
+    for (const Block &block : blocks_) {
+        AppendPod<int64_t>(blockStructs, block.offset);
+        AppendPod<int32_t>(blockStructs, block.metadataLength);
+        AppendPod<int32_t>(blockStructs, 0); // Struct padding
+        AppendPod<int64_t>(blockStructs, block.bodyLength);
+    }
+    std::vector<uint8_t> footer = FlatBuilder::Finish([&](FlatBuilder &b) {
+        return b.Table({
+            FlatBuilder::Scalar<int16_t>(0, kMetadataV5),
+            FlatBuilder::Offset(1, [this](FlatBuilder &s) { return WriteSchema(s, columns_); }),
+            FlatBuilder::Offset(2, [](FlatBuilder &v) { return v.StructVector({}, 0); }),
+            FlatBuilder::Offset(
+                3, [&](FlatBuilder &v) { return v.StructVector(blockStructs, blocks_.size()); }),
+        });
+    });
+    const int32_t footerSize = static_cast<int32_t>(footer.size());
+    file_.write(reinterpret_cast<const char *>(footer.data()), footer.size());
+    file_.write(reinterpret_cast<const char *>(&footerSize), 4);
+    file_.write(kArrowMagic, 6);
+    file_.close();
+
+    if (!file_) {
+        spdlog::error("Failed to finish attribute table: {}", path_);
+        return false;
+    }
+    spdlog::info("Attribute table closed: {} rows in {} batches", rowsWritten_, blocks_.size());
+    return ok;
+}
+
+bool AttributeTableWriter::ExportCsv(const std::string &csvPath) const {
+    std::ifstream table(path_, std::ios::in | std::ios::binary);
+    std::ofstream csv(csvPath, std::ios::out | std::ios::trunc);
+    if (!table.is_open() || !csv.is_open()) {
+        spdlog::error("Failed to export {} to {}", path_, csvPath);
+        return false;
+    }
+
+    for (size_t c = 0; c < columns_.size(); ++c) {
+        csv << (c > 0 ? "," : "") << columns_[c].name;
+    }
+    csv << "\n";
+
+    static const char kHex[] = "0123456789abcdef";
+    std::vector<uint8_t> body;
+    for (const Block &block : blocks_) {
+        int64_t bodyLength = 0;
+        std::vector<BufferSpan> buffers = BatchLayout(block.rows, bodyLength);
+        body.resize(bodyLength);
+        table.seekg(block.offset + block.metadataLength);
+        table.read(reinterpret_cast<char *>(body.data()), bodyLength);
+        if (!table) {
+            spdlog::error("Attribute table {} is truncated", path_);
+            return false;
+        }
+
+        for (size_t row = 0; row < block.rows; ++row) {
+            for (size_t c = 0; c < columns_.size(); ++c) {
+                const AttributeColumn &column = columns_[c];
+                const uint8_t *validity = &body[buffers[2 * c].offset];
+                const uint8_t *values = &body[buffers[2 * c + 1].offset];
+                if (c > 0) {
+                    csv << ",";
+                }
+                if (column.nullable && !(validity[row >> 3] & (1u << (row & 7)))) {
+                    continue;
+                }
+                switch (column.type) {
+                case AttributeColumnType::Int32: {
+                    int32_t value;
+                    std::memcpy(&value, values + row * 4, 4);
+                    csv << value;
+                    break;
+                }
+                case AttributeColumnType::Int64: {
+                    int64_t value;
+                    std::memcpy(&value, values + row * 8, 8);
+                    csv << value;
+                    break;
+                }
+                case AttributeColumnType::Float32: {
+                    float value;
+                    std::memcpy(&value, values + row * 4, 4);
+                    csv << std::to_string(value);
+                    break;
+                }
+                case AttributeColumnType::Bool:
+                    csv << ((values[row >> 3] >> (row & 7)) & 1);
+                    break;
+                case AttributeColumnType::Bytes:
+                    for (size_t i = 0; i < column.byteWidth; ++i) {
+                        const uint8_t byte = values[row * column.byteWidth + i];
+                        csv << kHex[byte >> 4] << kHex[byte & 15];
+                    }
+                    break;
+                }
+            }
+            csv << "\n";
+        }
+    }
+    return static_cast<bool>(csv);
+}
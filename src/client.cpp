@@ -1,3 +1,4 @@
+#include <bitset>
 #include <cstdio>
 #include <filesystem>
 #include <fstream>
@@ -11,6 +12,7 @@
 #include <vector>
 #include <windows.h>
 
+#include "frame_ring.h"
 #include "siphon_service.grpc.pb.h"
 #include <grpcpp/grpcpp.h>
 #include <toml++/toml.h>
@@ -42,6 +44,8 @@ using siphon_service::InputKeyToggleRequest;
 using siphon_service::InputKeyToggleResponse;
 using siphon_service::MoveMouseRequest;
 using siphon_service::MoveMouseResponse;
+using siphon_service::OpenFrameRingRequest;
+using siphon_service::OpenFrameRingResponse;
 using siphon_service::ProcessAttributeProto;
 using siphon_service::RecordingChunk;
 using siphon_service::SetProcessConfigRequest;
@@ -54,6 +58,7 @@ using siphon_service::StartRecordingResponse;
 using siphon_service::StopRecordingRequest;
 using siphon_service::StopRecordingResponse;
 using siphon_service::StreamFramesRequest;
+using siphon_service::StreamObservationsRequest;
 
 // Helper function to parse TOML config and build protobuf request
 bool ParseConfigFile(const std::string &filepath, std::string &processName,
@@ -531,7 +536,8 @@ class SiphonClient {
     };
 
     RecordingResult StartRecording(const std::vector<std::string> &attributeNames,
-                                   const std::string &outputDirectory, int maxDurationSeconds = 0) {
+                                   const std::string &outputDirectory, int maxDurationSeconds = 0,
+                                   const std::string &codec = "", double segmentSeconds = 0.0) {
         StartRecordingRequest request;
         StartRecordingResponse response;
         ClientContext context;
@@ -541,6 +547,8 @@ class SiphonClient {
         }
         request.set_output_directory(outputDirectory);
         request.set_max_duration_seconds(maxDurationSeconds);
+        request.set_codec(codec);
+        request.set_segment_seconds(segmentSeconds);
 
         Status status = stub_->StartRecording(&context, request, &response);
 
@@ -567,6 +575,9 @@ class SiphonClient {
         int32_t dropped_frames;
         double actual_duration_seconds;
         double actual_fps;
+        int32_t encoder_dropped_frames;
+        int32_t missed_frames;
+        std::string stitch_error;
     };
 
     StopRecordingResult StopRecording(const std::string &sessionId) {
@@ -587,6 +598,9 @@ class SiphonClient {
             result.dropped_frames = response.dropped_frames();
             result.actual_duration_seconds = response.actual_duration_seconds();
             result.actual_fps = response.actual_fps();
+            result.encoder_dropped_frames = response.encoder_dropped_frames();
+            result.missed_frames = response.missed_frames();
+            result.stitch_error = response.stitch_error();
         } else {
             std::cout << "StopRecording RPC failed: " << status.error_message() << std::endl;
             result.success = false;
@@ -596,6 +610,8 @@ class SiphonClient {
             result.dropped_frames = 0;
             result.actual_duration_seconds = 0.0;
             result.actual_fps = 0.0;
+            result.encoder_dropped_frames = 0;
+            result.missed_frames = 0;
         }
 
         return result;
@@ -609,6 +625,13 @@ class SiphonClient {
         double elapsed_time_seconds;
         double current_latency_ms;
         int32_t dropped_frames;
+        int32_t encoder_queue_size;
+        int32_t encoder_queue_capacity;
+        int32_t encoder_dropped_frames;
+        int32_t missed_frames;
+        int32_t encoder_degrade_level;
+        int32_t segments;
+        int32_t open_segments;
     };
 
     RecordingStatusResult GetRecordingStatus(const std::string &sessionId) {
@@ -629,6 +652,13 @@ class SiphonClient {
             result.elapsed_time_seconds = response.elapsed_time_seconds();
             result.current_latency_ms = response.current_latency_ms();
             result.dropped_frames = response.dropped_frames();
+            result.encoder_queue_size = response.encoder_queue_size();
+            result.encoder_queue_capacity = response.encoder_queue_capacity();
+            result.encoder_dropped_frames = response.encoder_dropped_frames();
+            result.missed_frames = response.missed_frames();
+            result.encoder_degrade_level = response.encoder_degrade_level();
+            result.segments = response.segments();
+            result.open_segments = response.open_segments();
         } else {
             std::cout << "GetRecordingStatus RPC failed: " << status.error_message() << std::endl;
             result.success = false;
@@ -638,6 +668,13 @@ class SiphonClient {
             result.elapsed_time_seconds = 0.0;
             result.current_latency_ms = 0.0;
             result.dropped_frames = 0;
+            result.encoder_queue_size = 0;
+            result.encoder_queue_capacity = 0;
+            result.encoder_dropped_frames = 0;
+            result.missed_frames = 0;
+            result.encoder_degrade_level = 0;
+            result.segments = 0;
+            result.open_segments = 0;
         }
 
         return result;
@@ -845,6 +882,7 @@ class SiphonClient {
                 fileSize = chunk.total_size();
 
                 std::filesystem::path filePath = outputPath / currentFilename;
+                std::filesystem::create_directories(filePath.parent_path());
                 outFile.open(filePath, std::ios::binary);
                 if (!outFile.is_open()) {
                     std::cerr << "Failed to open output file: " << filePath.string() << std::endl;
@@ -895,6 +933,141 @@ class SiphonClient {
         }
     }
 
+    // Stream JPEG frames with the given attributes and key state sampled at each capture
+    bool StreamObservations(const std::vector<std::string> &attributes, int maxFrames = 0) {
+        StreamObservationsRequest request;
+        ClientContext context;
+
+        request.mutable_frame()->set_format("jpeg");
+        for (const auto &name : attributes) {
+            request.add_attributes(name);
+        }
+        request.set_include_key_state(true);
+
+        std::unique_ptr<grpc::ClientReader<siphon_service::Observation>> reader(
+            stub_->StreamObservations(&context, request));
+
+        siphon_service::Observation observation;
+        int framesReceived = 0;
+        auto lastPrintTime = std::chrono::high_resolution_clock::now();
+
+        while (reader->Read(&observation)) {
+            framesReceived++;
+
+            auto now = std::chrono::high_resolution_clock::now();
+            if (std::chrono::duration<double>(now - lastPrintTime).count() >= 1.0) {
+                const auto &frame = observation.frame();
+                std::cout << "\rFrame #" << frame.frame_number() << " | Skew: "
+                          << (observation.attributes_timestamp_us() - frame.timestamp_us())
+                          << " us";
+                for (const auto &attribute : observation.attributes()) {
+                    std::cout << " | " << attribute.name() << "=";
+                    if (!attribute.valid()) {
+                        std::cout << "?";
+                    } else if (attribute.has_int_value()) {
+                        std::cout << attribute.int_value();
+                    } else if (attribute.has_float_value()) {
+                        std::cout << attribute.float_value();
+                    } else if (attribute.has_bool_value()) {
+                        std::cout << attribute.bool_value();
+                    } else {
+                        std::cout << "[" << attribute.array_value().size() << " bytes]";
+                    }
+                }
+                int keysDown = 0;
+                for (unsigned char byte : observation.key_state()) {
+                    keysDown += std::bitset<8>(byte).count();
+                }
+                std::cout << " | Keys down: " << keysDown << std::flush;
+                lastPrintTime = now;
+            }
+
+            if (maxFrames > 0 && framesReceived >= maxFrames) {
+                context.TryCancel();
+                break;
+            }
+        }
+        std::cout << std::endl;
+
+        Status status = reader->Finish();
+        if (status.ok() || status.error_code() == grpc::StatusCode::CANCELLED) {
+            std::cout << "Observations received: " << framesReceived << std::endl;
+            return true;
+        }
+        std::cerr << "Observation stream failed: " << status.error_message() << std::endl;
+        return false;
+    }
+
+    // Read raw BGRA frames through the server's shared-memory ring (same host only)
+    bool ReadFrameRing(int maxFrames = 0) {
+        OpenFrameRingRequest request;
+        OpenFrameRingResponse response;
+        ClientContext context;
+
+        Status status = stub_->OpenFrameRing(&context, request, &response);
+        if (!status.ok()) {
+            std::cerr << "OpenFrameRing failed: " << status.error_message() << std::endl;
+            return false;
+        }
+        if (!response.success()) {
+            std::cerr << "OpenFrameRing failed: " << response.message() << std::endl;
+            return false;
+        }
+
+        FrameRingReader reader;
+        if (!reader.Open(response.segment_name())) {
+            std::cerr << "Failed to map frame ring " << response.segment_name() << std::endl;
+            return false;
+        }
+
+        std::cout << "Reading frame ring " << response.segment_name() << " ("
+                  << response.slot_count() << " slots x " << response.slot_capacity()
+                  << " bytes)" << std::endl;
+
+        int framesRead = 0;
+        int tornFrames = 0;
+        uint64_t bytesRead = 0;
+        auto startTime = std::chrono::high_resolution_clock::now();
+        auto lastPrintTime = startTime;
+
+        FrameRingView view;
+        while (reader.Next(view, 2000)) {
+            // Pixels are used in place; a real consumer would hand them to its model here
+            if (!reader.IsValid(view)) {
+                tornFrames++;
+                continue;
+            }
+            framesRead++;
+            bytesRead += view.size;
+
+            auto now = std::chrono::high_resolution_clock::now();
+            if (std::chrono::duration<double>(now - lastPrintTime).count() >= 1.0) {
+                double elapsed = std::chrono::duration<double>(now - startTime).count();
+                std::cout << "\rFrames: " << framesRead << " | FPS: " << std::fixed
+                          << std::setprecision(1) << framesRead / elapsed << " | Size: "
+                          << view.width << "x" << view.height << " | Frame #" << view.frameNumber
+                          << " | Skipped: " << reader.GetSkippedFrames()
+                          << " | Torn: " << tornFrames << std::flush;
+                lastPrintTime = now;
+            }
+
+            if (maxFrames > 0 && framesRead >= maxFrames) {
+                break;
+            }
+        }
+
+        double totalTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() -
+                                                         startTime)
+                               .count();
+        std::cout << "\n=== Frame Ring Read Complete ===" << std::endl;
+        std::cout << "Total frames read: " << framesRead << std::endl;
+        std::cout << "Average FPS: " << std::fixed << std::setprecision(2)
+                  << framesRead / totalTime << std::endl;
+        std::cout << "Throughput: " << std::fixed << std::setprecision(1)
+                  << bytesRead / totalTime / (1024.0 * 1024.0) << " MB/s" << std::endl;
+        return true;
+    }
+
   private:
     std::unique_ptr<SiphonService::Stub> stub_;
 };
@@ -960,8 +1133,13 @@ int main() {
     std::cout << "  move <deltaX> <deltaY> <steps> - Move mouse" << std::endl;
     std::cout << "  exec <command> [args...]  - Execute command on server" << std::endl;
     std::cout << "\n=== Recording Commands ===" << std::endl;
-    std::cout << "  rec-start <output_dir> <attr1,attr2,...> [max_duration_sec]" << std::endl;
-    std::cout << "                            - Start recording (0 = unlimited duration)"
+    std::cout << "  rec-start <output_dir> <attr1,attr2,...> [max_duration_sec] [codec] "
+                 "[segment_sec]"
+              << std::endl;
+    std::cout << "                            - Start recording (0 = unlimited duration; codec "
+                 "h264, hevc, ffv1 or av1)"
+              << std::endl;
+    std::cout << "                              segment_sec > 0 writes parallel segment files"
               << std::endl;
     std::cout << "  rec-stop <session_id>     - Stop recording session" << std::endl;
     std::cout << "  rec-status <session_id>   - Get recording status" << std::endl;
@@ -976,6 +1154,11 @@ int main() {
     std::cout << "  stream-loop [format] [quality] [duration_sec]" << std::endl;
     std::cout << "                            - Non-blocking stream with control loop example"
               << std::endl;
+    std::cout << "  ring [max_frames]         - Read raw frames via shared memory (same host)"
+              << std::endl;
+    std::cout << "  observe <attr,attr,...> [max_frames]" << std::endl;
+    std::cout << "                            - Stream frames with attributes and key state"
+              << std::endl;
     std::cout << "\n=== General ===" << std::endl;
     std::cout << "  quit                      - Exit client" << std::endl;
 
@@ -1325,14 +1508,21 @@ int main() {
                 std::cout << result.stderr_output << std::endl;
             }
         } else if (command == "rec-start") {
-            std::string outputDir, attributesStr;
+            std::string outputDir, attributesStr, codec;
             int maxDuration = 0;
+            double segmentSeconds = 0.0;
 
             if (std::cin >> outputDir >> attributesStr) {
-                // Optional max duration parameter
+                // Optional max duration and codec parameters
                 if (std::cin.peek() != '\n') {
                     std::cin >> maxDuration;
                 }
+                if (std::cin.peek() != '\n') {
+                    std::cin >> codec;
+                }
+                if (std::cin.peek() != '\n') {
+                    std::cin >> segmentSeconds;
+                }
 
                 // Parse comma-separated attributes
                 std::vector<std::string> attributes;
@@ -1364,7 +1554,8 @@ int main() {
                           << (maxDuration == 0 ? "unlimited" : std::to_string(maxDuration) + "s")
                           << std::endl;
 
-                auto result = client.StartRecording(attributes, outputDir, maxDuration);
+                auto result = client.StartRecording(attributes, outputDir, maxDuration, codec,
+                                                    segmentSeconds);
 
                 if (result.success) {
                     std::cout << "\n=== Recording Started! ===" << std::endl;
@@ -1379,7 +1570,7 @@ int main() {
                 }
             } else {
                 std::cout << "Invalid input. Use: rec-start <output_dir> <attr1,attr2,...> "
-                             "[max_duration_sec]"
+                             "[max_duration_sec] [codec] [segment_sec]"
                           << std::endl;
                 std::cin.clear();
                 std::cin.ignore(10000, '\n');
@@ -1395,9 +1586,16 @@ int main() {
                     std::cout << "\n=== Recording Stopped! ===" << std::endl;
                     std::cout << "Total Frames: " << result.total_frames << std::endl;
                     std::cout << "Dropped Frames: " << result.dropped_frames << std::endl;
+                    std::cout << "Encoder Queue Drops: " << result.encoder_dropped_frames
+                              << ", Missed: " << result.missed_frames << std::endl;
                     std::cout << "Average Latency: " << std::fixed << std::setprecision(2)
                               << result.average_latency_ms << "ms" << std::endl;
                     std::cout << "Message: " << result.message << std::endl;
+                    if (!result.stitch_error.empty()) {
+                        std::cout << "WARNING: segments were not stitched; the download "
+                                     "contains segments.ffconcat and segments/ instead"
+                                  << std::endl;
+                    }
 
                     // Display actual stats
                     if (result.total_frames > 0) {
@@ -1446,6 +1644,16 @@ int main() {
                         std::cout << "Current Latency: " << std::fixed << std::setprecision(2)
                                   << result.current_latency_ms << "ms" << std::endl;
                         std::cout << "Dropped Frames: " << result.dropped_frames << std::endl;
+                        std::cout << "Encoder Queue: " << result.encoder_queue_size << "/"
+                                  << result.encoder_queue_capacity
+                                  << " (drops: " << result.encoder_dropped_frames
+                                  << ", missed: " << result.missed_frames
+                                  << ", degrade level: " << result.encoder_degrade_level << ")"
+                                  << std::endl;
+                        if (result.segments > 0) {
+                            std::cout << "Segments: " << result.segments << " ("
+                                      << result.open_segments << " encoding)" << std::endl;
+                        }
 
                         // Performance indicator
                         if (result.current_latency_ms <= 16.67) {
@@ -1509,6 +1717,35 @@ int main() {
             if (!client.StreamFrames(format, quality, maxFrames)) {
                 std::cout << "Failed to stream frames" << std::endl;
             }
+        } else if (command == "ring") {
+            int maxFrames = 0;
+            if (std::cin.peek() != '\n') {
+                std::cin >> maxFrames;
+            }
+
+            if (!client.ReadFrameRing(maxFrames)) {
+                std::cout << "Failed to read frame ring" << std::endl;
+            }
+        } else if (command == "observe") {
+            std::string attributeList;
+            int maxFrames = 0;
+            std::cin >> attributeList;
+            if (std::cin.peek() != '\n') {
+                std::cin >> maxFrames;
+            }
+
+            std::vector<std::string> attributes;
+            std::stringstream ss(attributeList);
+            std::string name;
+            while (std::getline(ss, name, ',')) {
+                if (!name.empty()) {
+                    attributes.push_back(name);
+                }
+            }
+
+            if (!client.StreamObservations(attributes, maxFrames)) {
+                std::cout << "Failed to stream observations" << std::endl;
+            }
         } else if (command == "stream-loop") {
             std::string format = "jpeg";
             int quality = 85;
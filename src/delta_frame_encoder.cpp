@@ -0,0 +1,117 @@
+#include "delta_frame_encoder.h"
+#include <cstring>
+#include <lz4.h>
+#include <spdlog/spdlog.h>
+#include <zstd.h>
+
+namespace {
+
+// dst = a ^ b, a word at a time (auto-vectorized)
+void XorBuffers(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t size) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t wa, wb;
+        memcpy(&wa, a + i, 8);
+        memcpy(&wb, b + i, 8);
+        wa ^= wb;
+        memcpy(dst + i, &wa, 8);
+    }
+    for (; i < size; ++i) {
+        dst[i] = a[i] ^ b[i];
+    }
+}
+
+} // namespace
+
+DeltaFrameEncoder::DeltaFrameEncoder(const DeltaEncoderOptions &options)
+    : options_(options), zstdContext_(nullptr), width_(0), height_(0), framesSinceKeyframe_(0),
+      sequence_(0), forceKeyframe_(true) {}
+
+DeltaFrameEncoder::~DeltaFrameEncoder() {
+    if (zstdContext_) {
+        ZSTD_freeCCtx(zstdContext_);
+        zstdContext_ = nullptr;
+    }
+}
+
+bool DeltaFrameEncoder::ParseCompression(const std::string &name, DeltaCompression &compression) {
+    if (name.empty() || name == "zstd") {
+        compression = DeltaCompression::Zstd;
+    } else if (name == "lz4") {
+        compression = DeltaCompression::LZ4;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *DeltaFrameEncoder::CompressionName(DeltaCompression compression) {
+    return compression == DeltaCompression::LZ4 ? "lz4" : "zstd";
+}
+
+bool DeltaFrameEncoder::Encode(const uint8_t *pixels, size_t size, int width, int height,
+                               std::vector<uint8_t> &out, bool &keyframe, uint64_t &sequence) {
+    keyframe = forceKeyframe_ || width != width_ || height != height_ ||
+               size != previous_.size() || framesSinceKeyframe_ >= options_.keyframeInterval;
+
+    bool ok;
+    if (keyframe) {
+        ok = Compress(pixels, size, out);
+    } else {
+        delta_.resize(size);
+        XorBuffers(pixels, previous_.data(), delta_.data(), size);
+        ok = Compress(delta_.data(), size, out);
+    }
+
+    if (!ok) {
+        // The client never sees this frame, so the next one must not reference it
+        forceKeyframe_ = true;
+        return false;
+    }
+
+    previous_.assign(pixels, pixels + size);
+    width_ = width;
+    height_ = height;
+    framesSinceKeyframe_ = keyframe ? 1 : framesSinceKeyframe_ + 1;
+    forceKeyframe_ = false;
+    sequence = sequence_++;
+    return true;
+}
+
+bool DeltaFrameEncoder::Compress(const uint8_t *data, size_t size, std::vector<uint8_t> &out) {
+    if (options_.compression == DeltaCompression::LZ4) {
+        if (size > static_cast<size_t>(LZ4_MAX_INPUT_SIZE)) {
+            spdlog::error("Frame too large for LZ4: {} bytes", size);
+            return false;
+        }
+        out.resize(LZ4_compressBound(static_cast<int>(size)));
+        int written = LZ4_compress_fast(reinterpret_cast<const char *>(data),
+                                        reinterpret_cast<char *>(out.data()),
+                                        static_cast<int>(size), static_cast<int>(out.size()),
+                                        options_.level > 0 ? options_.level : 1);
+        if (written <= 0) {
+            spdlog::error("LZ4 compression failed");
+            return false;
+        }
+        out.resize(written);
+        return true;
+    }
+
+    if (!zstdContext_) {
+        zstdContext_ = ZSTD_createCCtx();
+        if (!zstdContext_) {
+            spdlog::error("Failed to create zstd context");
+            return false;
+        }
+    }
+
+    out.resize(ZSTD_compressBound(size));
+    size_t written =
+        ZSTD_compressCCtx(zstdContext_, out.data(), out.size(), data, size, options_.level);
+    if (ZSTD_isError(written)) {
+        spdlog::error("zstd compression failed: {}", ZSTD_getErrorName(written));
+        return false;
+    }
+    out.resize(written);
+    return true;
+}
@@ -0,0 +1,61 @@
+#include "encoded_frame_cache.h"
+
+EncodedBuffer EncodedFrameCache::GetOrEncode(const EncodedFrameKey &key, const EncodeFn &encode) {
+    std::promise<EncodedBuffer> promise;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        // A subscriber lagging behind the newest frame encodes privately rather than
+        // resurrecting expired entries
+        if (key.frameNumber < newestFrame_) {
+            misses_++;
+            lock.unlock();
+            auto data = std::make_shared<std::vector<uint8_t>>();
+            return encode(*data) ? data : nullptr;
+        }
+
+        // Newer frame: expire everything older
+        if (key.frameNumber > newestFrame_) {
+            newestFrame_ = key.frameNumber;
+            for (auto it = entries_.begin(); it != entries_.end();) {
+                if (it->first.frameNumber < newestFrame_) {
+                    it = entries_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            hits_++;
+            std::shared_future<EncodedBuffer> result = it->second;
+            lock.unlock();
+            return result.get(); // Waits if another subscriber is still encoding
+        }
+
+        misses_++;
+        entries_.emplace(key, promise.get_future().share());
+    }
+
+    // Encode outside the lock so other representations proceed in parallel
+    auto data = std::make_shared<std::vector<uint8_t>>();
+    EncodedBuffer result;
+    try {
+        if (encode(*data)) {
+            result = data;
+        }
+    } catch (...) {
+        promise.set_value(nullptr);
+        throw;
+    }
+    promise.set_value(result);
+    return result;
+}
+
+void EncodedFrameCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    newestFrame_ = -1;
+}
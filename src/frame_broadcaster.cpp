@@ -1,4 +1,5 @@
 #include "frame_broadcaster.h"
+#include <algorithm>
 #include <spdlog/spdlog.h>
 #include <thread>
 
@@ -45,18 +46,41 @@ void FrameBroadcaster::Stop() {
 
     CleanupDXGICapture();
     isRunning_ = false;
+    latestFrameCv_.notify_all();
 
     spdlog::info("FrameBroadcaster stopped");
 }
 
-uint64_t FrameBroadcaster::Subscribe(FrameCallback callback) {
+uint64_t FrameBroadcaster::Subscribe(FrameCallback callback, const FrameOutputSpec &spec,
+                                     const FrameRateLimit &rateLimit) {
     std::lock_guard<std::mutex> lock(subscribersMutex_);
     uint64_t id = nextSubscriberId_++;
-    subscribers_[id] = callback;
-    spdlog::info("Frame subscriber added: ID={}", id);
+    FrameSubscriber subscriber;
+    subscriber.callback = std::move(callback);
+    subscriber.spec = spec;
+    subscriber.rateLimit = rateLimit;
+    subscribers_[id] = std::move(subscriber);
+    if (spec.IsPassthrough()) {
+        spdlog::info("Frame subscriber added: ID={}", id);
+    } else {
+        spdlog::info("Frame subscriber added: ID={}, output={}x{} {}", id, spec.width, spec.height,
+                     FrameConverter::PixelFormatName(spec.pixelFormat));
+    }
     return id;
 }
 
+std::shared_ptr<const CapturedFrame>
+FrameBroadcaster::GetLatestFrame(int32_t minFrameNumber, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(latestFrameMutex_);
+    latestFrameCv_.wait_for(lock, timeout, [&] {
+        return (latestFrame_ && latestFrame_->frameNumber >= minFrameNumber) || !isRunning_;
+    });
+    if (!latestFrame_ || latestFrame_->frameNumber < minFrameNumber) {
+        return nullptr;
+    }
+    return latestFrame_;
+}
+
 void FrameBroadcaster::Unsubscribe(uint64_t subscriptionId) {
     std::lock_guard<std::mutex> lock(subscribersMutex_);
     subscribers_.erase(subscriptionId);
@@ -119,16 +143,22 @@ void FrameBroadcaster::CaptureLoop() {
 
         // Broadcast to subscribers if we have valid frame data
         if (!pixels.empty() && width > 0 && height > 0) {
-            CapturedFrame frame;
-            frame.pixels = std::move(pixels);
-            frame.timestampUs = timestampUs;
-            frame.width = width;
-            frame.height = height;
-            frame.frameNumber = currentFrame_++;
+            auto frame = std::make_shared<CapturedFrame>();
+            frame->pixels = std::move(pixels);
+            frame->timestampUs = timestampUs;
+            frame->width = width;
+            frame->height = height;
+            frame->frameNumber = currentFrame_++;
 
             lastFrameTimestampUs_ = timestampUs;
 
-            BroadcastFrame(frame);
+            BroadcastFrame(*frame);
+
+            {
+                std::lock_guard<std::mutex> lock(latestFrameMutex_);
+                latestFrame_ = std::move(frame);
+            }
+            latestFrameCv_.notify_all();
         }
 
         lastCaptureTime = std::chrono::high_resolution_clock::now();
@@ -138,16 +168,67 @@ void FrameBroadcaster::CaptureLoop() {
 void FrameBroadcaster::BroadcastFrame(const CapturedFrame &frame) {
     std::lock_guard<std::mutex> lock(subscribersMutex_);
 
+    // Conversions computed for this frame, one per distinct output spec
+    std::map<FrameOutputSpec, CapturedFrame> converted;
+
     // Send frame to all subscribers (non-blocking)
-    for (const auto &[id, callback] : subscribers_) {
+    for (auto &[id, subscriber] : subscribers_) {
         try {
-            callback(frame);
+            if (!ShouldDeliver(subscriber, frame)) {
+                continue;
+            }
+            if (subscriber.spec.IsPassthrough()) {
+                subscriber.callback(frame);
+                continue;
+            }
+
+            auto it = converted.find(subscriber.spec);
+            if (it == converted.end()) {
+                CapturedFrame output;
+                output.timestampUs = frame.timestampUs;
+                output.frameNumber = frame.frameNumber;
+                output.pixelFormat = subscriber.spec.pixelFormat;
+                if (!FrameConverter::Convert(frame.pixels.data(), frame.width, frame.height,
+                                             subscriber.spec, output.pixels, output.width,
+                                             output.height)) {
+                    spdlog::error("Frame conversion failed for subscriber {}", id);
+                    continue;
+                }
+                it = converted.emplace(subscriber.spec, std::move(output)).first;
+            }
+            subscriber.callback(it->second);
         } catch (const std::exception &e) {
             spdlog::error("Exception in frame subscriber {}: {}", id, e.what());
         }
     }
 }
 
+bool FrameBroadcaster::ShouldDeliver(FrameSubscriber &subscriber, const CapturedFrame &frame) {
+    const FrameRateLimit &limit = subscriber.rateLimit;
+    if (limit.IsUnlimited()) {
+        return true;
+    }
+
+    if (limit.everyNthFrame > 1 && subscriber.framesSeen++ % limit.everyNthFrame != 0) {
+        return false;
+    }
+
+    if (limit.maxFps > 0.0f) {
+        // Credit accrues at maxFps; the cap lets jittery capture catch up by at most one frame
+        if (subscriber.lastTimestampUs >= 0) {
+            int64_t elapsedUs = std::max<int64_t>(frame.timestampUs - subscriber.lastTimestampUs, 0);
+            subscriber.fpsCredit =
+                std::min(subscriber.fpsCredit + elapsedUs * 1e-6 * limit.maxFps, 2.0);
+        }
+        subscriber.lastTimestampUs = frame.timestampUs;
+        if (subscriber.fpsCredit < 1.0) {
+            return false;
+        }
+        subscriber.fpsCredit -= 1.0;
+    }
+    return true;
+}
+
 bool FrameBroadcaster::InitializeDXGICapture(HWND window) {
     // Get window rect to determine which monitor
     RECT windowRect;
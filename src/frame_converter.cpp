@@ -0,0 +1,485 @@
+#include "frame_converter.h"
+#include "cpu_features.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <immintrin.h>
+
+namespace {
+
+std::atomic<bool> g_simdEnabled{true};
+
+bool UseAVX2() { return g_simdEnabled.load(std::memory_order_relaxed) && CpuFeatures::HasAVX2(); }
+
+// BT.601 luma weights scaled to 7 bits (sum = 128) so they fit pmaddubsw's signed operand
+constexpr int kGrayB = 15;
+constexpr int kGrayG = 75;
+constexpr int kGrayR = 38;
+
+// ============================================================================
+// Scalar kernels (reference implementation)
+// ============================================================================
+
+void AccumulateRowScalar(const uint8_t *src, uint32_t *acc, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        acc[i] += src[i];
+    }
+}
+
+void LerpRowsScalar(const uint8_t *row0, const uint8_t *row1, uint8_t *dst, size_t count,
+                    int weight) {
+    const int inv = 256 - weight;
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = static_cast<uint8_t>((row0[i] * inv + row1[i] * weight + 128) >> 8);
+    }
+}
+
+void BGRAToRGB24Scalar(const uint8_t *src, uint8_t *dst, size_t pixelCount) {
+    for (size_t i = 0; i < pixelCount; ++i) {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        src += 4;
+        dst += 3;
+    }
+}
+
+void BGRAToGray8Scalar(const uint8_t *src, uint8_t *dst, size_t pixelCount) {
+    for (size_t i = 0; i < pixelCount; ++i) {
+        dst[i] = static_cast<uint8_t>((src[0] * kGrayB + src[1] * kGrayG + src[2] * kGrayR + 64) >>
+                                      7);
+        src += 4;
+    }
+}
+
+void BGRAToPlanarF32Scalar(const uint8_t *src, float *r, float *g, float *b, size_t pixelCount) {
+    const float scale = 1.0f / 255.0f;
+    for (size_t i = 0; i < pixelCount; ++i) {
+        r[i] = static_cast<float>(src[2]) * scale;
+        g[i] = static_cast<float>(src[1]) * scale;
+        b[i] = static_cast<float>(src[0]) * scale;
+        src += 4;
+    }
+}
+
+// ============================================================================
+// AVX2 kernels
+// ============================================================================
+
+SIPHON_TARGET_AVX2 void AccumulateRowAVX2(const uint8_t *src, uint32_t *acc, size_t count) {
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        for (int part = 0; part < 4; ++part) {
+            __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i + part * 8));
+            __m256i wide = _mm256_cvtepu8_epi32(bytes);
+            __m256i *accPtr = reinterpret_cast<__m256i *>(acc + i + part * 8);
+            _mm256_storeu_si256(accPtr, _mm256_add_epi32(_mm256_loadu_si256(accPtr), wide));
+        }
+    }
+    AccumulateRowScalar(src + i, acc + i, count - i);
+}
+
+SIPHON_TARGET_AVX2 void LerpRowsAVX2(const uint8_t *row0, const uint8_t *row1, uint8_t *dst,
+                                     size_t count, int weight) {
+    const __m256i w1 = _mm256_set1_epi16(static_cast<short>(weight));
+    const __m256i w0 = _mm256_set1_epi16(static_cast<short>(256 - weight));
+    const __m256i round = _mm256_set1_epi16(128);
+
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0 + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1 + i));
+
+        // Products fit in 16 bits unsigned because the weights sum to 256
+        __m256i aLo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(a));
+        __m256i aHi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(a, 1));
+        __m256i bLo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(b));
+        __m256i bHi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(b, 1));
+
+        __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(aLo, w0), _mm256_mullo_epi16(bLo, w1));
+        __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(aHi, w0), _mm256_mullo_epi16(bHi, w1));
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 8);
+
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+    }
+    LerpRowsScalar(row0 + i, row1 + i, dst + i, count - i, weight);
+}
+
+SIPHON_TARGET_AVX2 void BGRAToRGB24AVX2(const uint8_t *src, uint8_t *dst, size_t pixelCount) {
+    // Per 128-bit lane: 4 BGRA pixels -> 12 RGB bytes at the front of the lane
+    const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1,
+                                             -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1,
+                                             -1, -1);
+    size_t i = 0;
+    // Each iteration stores 16 bytes at dst+12, so keep 10 pixels of headroom
+    for (; i + 10 <= pixelCount; i += 8) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+        __m256i rgb = _mm256_shuffle_epi8(px, shuffle);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 3), _mm256_castsi256_si128(rgb));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 3 + 12),
+                         _mm256_extracti128_si256(rgb, 1));
+    }
+    BGRAToRGB24Scalar(src + i * 4, dst + i * 3, pixelCount - i);
+}
+
+SIPHON_TARGET_AVX2 __m256i GrayFromBGRA8(__m256i px, __m256i weights, __m256i ones,
+                                         __m256i round) {
+    __m256i pairs = _mm256_maddubs_epi16(px, weights); // B*wb + G*wg, R*wr + A*0
+    __m256i sums = _mm256_madd_epi16(pairs, ones);     // one int32 per pixel
+    return _mm256_srli_epi32(_mm256_add_epi32(sums, round), 7);
+}
+
+SIPHON_TARGET_AVX2 void BGRAToGray8AVX2(const uint8_t *src, uint8_t *dst, size_t pixelCount) {
+    const __m256i weights = _mm256_set1_epi32(kGrayB | (kGrayG << 8) | (kGrayR << 16));
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i round = _mm256_set1_epi32(64);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    size_t i = 0;
+    for (; i + 32 <= pixelCount; i += 32) {
+        const __m256i *in = reinterpret_cast<const __m256i *>(src + i * 4);
+        __m256i a = GrayFromBGRA8(_mm256_loadu_si256(in + 0), weights, ones, round);
+        __m256i b = GrayFromBGRA8(_mm256_loadu_si256(in + 1), weights, ones, round);
+        __m256i c = GrayFromBGRA8(_mm256_loadu_si256(in + 2), weights, ones, round);
+        __m256i d = GrayFromBGRA8(_mm256_loadu_si256(in + 3), weights, ones, round);
+
+        __m256i ab = _mm256_packs_epi32(a, b);
+        __m256i cd = _mm256_packs_epi32(c, d);
+        __m256i packed = _mm256_packus_epi16(ab, cd);
+        packed = _mm256_permutevar8x32_epi32(packed, order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+    }
+    BGRAToGray8Scalar(src + i * 4, dst + i, pixelCount - i);
+}
+
+SIPHON_TARGET_AVX2 void BGRAToPlanarF32AVX2(const uint8_t *src, float *r, float *g, float *b,
+                                            size_t pixelCount) {
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+    const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= pixelCount; i += 8) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+        __m256i bi = _mm256_and_si256(px, mask);
+        __m256i gi = _mm256_and_si256(_mm256_srli_epi32(px, 8), mask);
+        __m256i ri = _mm256_and_si256(_mm256_srli_epi32(px, 16), mask);
+        _mm256_storeu_ps(r + i, _mm256_mul_ps(_mm256_cvtepi32_ps(ri), scale));
+        _mm256_storeu_ps(g + i, _mm256_mul_ps(_mm256_cvtepi32_ps(gi), scale));
+        _mm256_storeu_ps(b + i, _mm256_mul_ps(_mm256_cvtepi32_ps(bi), scale));
+    }
+    BGRAToPlanarF32Scalar(src + i * 4, r + i, g + i, b + i, pixelCount - i);
+}
+
+// ============================================================================
+// Resize
+// ============================================================================
+
+void ResizeBox(const uint8_t *src, int srcWidth, int srcHeight, size_t srcStride, uint8_t *dst,
+               int dstWidth, int dstHeight) {
+    const bool avx2 = UseAVX2();
+    const size_t rowBytes = static_cast<size_t>(srcWidth) * 4;
+
+    thread_local std::vector<uint32_t> rowSum;
+    thread_local std::vector<int> xStart;
+    rowSum.resize(rowBytes);
+    xStart.resize(dstWidth + 1);
+
+    for (int dx = 0; dx <= dstWidth; ++dx) {
+        xStart[dx] = static_cast<int>(static_cast<int64_t>(dx) * srcWidth / dstWidth);
+    }
+
+    for (int dy = 0; dy < dstHeight; ++dy) {
+        int y0 = static_cast<int>(static_cast<int64_t>(dy) * srcHeight / dstHeight);
+        int y1 = static_cast<int>(static_cast<int64_t>(dy + 1) * srcHeight / dstHeight);
+        y1 = std::max(y1, y0 + 1);
+
+        // Vertical pass: sum the source rows covered by this output row
+        std::fill(rowSum.begin(), rowSum.end(), 0u);
+        for (int y = y0; y < y1; ++y) {
+            const uint8_t *row = src + static_cast<size_t>(y) * srcStride;
+            if (avx2) {
+                AccumulateRowAVX2(row, rowSum.data(), rowBytes);
+            } else {
+                AccumulateRowScalar(row, rowSum.data(), rowBytes);
+            }
+        }
+
+        // Horizontal pass: average each column span
+        uint8_t *out = dst + static_cast<size_t>(dy) * dstWidth * 4;
+        for (int dx = 0; dx < dstWidth; ++dx) {
+            int x0 = xStart[dx];
+            int x1 = std::max(xStart[dx + 1], x0 + 1);
+            uint32_t sums[4] = {0, 0, 0, 0};
+            for (int x = x0; x < x1; ++x) {
+                const uint32_t *p = rowSum.data() + static_cast<size_t>(x) * 4;
+                sums[0] += p[0];
+                sums[1] += p[1];
+                sums[2] += p[2];
+                sums[3] += p[3];
+            }
+            uint32_t area = static_cast<uint32_t>((x1 - x0) * (y1 - y0));
+            for (int c = 0; c < 4; ++c) {
+                out[dx * 4 + c] = static_cast<uint8_t>((sums[c] + area / 2) / area);
+            }
+        }
+    }
+}
+
+void ResizeBilinear(const uint8_t *src, int srcWidth, int srcHeight, size_t srcStride,
+                    uint8_t *dst, int dstWidth, int dstHeight) {
+    const bool avx2 = UseAVX2();
+    const size_t rowBytes = static_cast<size_t>(srcWidth) * 4;
+
+    thread_local std::vector<uint8_t> rowBuffer;
+    thread_local std::vector<int> xIndex;
+    thread_local std::vector<int> xWeight;
+    rowBuffer.resize(rowBytes);
+    xIndex.resize(dstWidth);
+    xWeight.resize(dstWidth);
+
+    // Pixel-center aligned source coordinates in 8-bit fixed point
+    auto mapCoord = [](int d, int srcSize, int dstSize, int &index, int &weight) {
+        double s = (d + 0.5) * srcSize / dstSize - 0.5;
+        s = std::max(0.0, std::min(s, static_cast<double>(srcSize - 1)));
+        index = static_cast<int>(s);
+        weight = static_cast<int>((s - index) * 256.0 + 0.5);
+        if (weight >= 256) {
+            index = std::min(index + 1, srcSize - 1);
+            weight = 0;
+        }
+    };
+
+    for (int dx = 0; dx < dstWidth; ++dx) {
+        mapCoord(dx, srcWidth, dstWidth, xIndex[dx], xWeight[dx]);
+    }
+
+    for (int dy = 0; dy < dstHeight; ++dy) {
+        int y0, fy;
+        mapCoord(dy, srcHeight, dstHeight, y0, fy);
+        int y1 = std::min(y0 + 1, srcHeight - 1);
+
+        // Vertical pass into the row buffer
+        const uint8_t *row0 = src + static_cast<size_t>(y0) * srcStride;
+        const uint8_t *row1 = src + static_cast<size_t>(y1) * srcStride;
+        if (avx2) {
+            LerpRowsAVX2(row0, row1, rowBuffer.data(), rowBytes, fy);
+        } else {
+            LerpRowsScalar(row0, row1, rowBuffer.data(), rowBytes, fy);
+        }
+
+        // Horizontal pass
+        uint8_t *out = dst + static_cast<size_t>(dy) * dstWidth * 4;
+        for (int dx = 0; dx < dstWidth; ++dx) {
+            int x0 = xIndex[dx];
+            int x1 = std::min(x0 + 1, srcWidth - 1);
+            int fx = xWeight[dx];
+            const uint8_t *p0 = rowBuffer.data() + static_cast<size_t>(x0) * 4;
+            const uint8_t *p1 = rowBuffer.data() + static_cast<size_t>(x1) * 4;
+            for (int c = 0; c < 4; ++c) {
+                out[dx * 4 + c] = static_cast<uint8_t>((p0[c] * (256 - fx) + p1[c] * fx + 128) >> 8);
+            }
+        }
+    }
+}
+
+} // namespace
+
+// ============================================================================
+// FrameConverter
+// ============================================================================
+
+void FrameConverter::ResizeBGRA(const uint8_t *src, int srcWidth, int srcHeight, uint8_t *dst,
+                                int dstWidth, int dstHeight, ResizeFilter filter,
+                                size_t srcStride) {
+    const size_t rowBytes = static_cast<size_t>(srcWidth) * 4;
+    if (srcStride == 0) {
+        srcStride = rowBytes;
+    }
+
+    if (srcWidth == dstWidth && srcHeight == dstHeight) {
+        if (srcStride == rowBytes) {
+            memcpy(dst, src, rowBytes * srcHeight);
+        } else {
+            for (int y = 0; y < srcHeight; ++y) {
+                memcpy(dst + y * rowBytes, src + y * srcStride, rowBytes);
+            }
+        }
+        return;
+    }
+
+    if (filter == ResizeFilter::Bilinear) {
+        ResizeBilinear(src, srcWidth, srcHeight, srcStride, dst, dstWidth, dstHeight);
+    } else {
+        ResizeBox(src, srcWidth, srcHeight, srcStride, dst, dstWidth, dstHeight);
+    }
+}
+
+bool FrameConverter::ResolveRegion(const FrameRegion &region, int width, int height,
+                                   FrameRegion &resolved) {
+    if (region.x < 0 || region.y < 0 || region.width < 0 || region.height < 0 ||
+        region.x >= width || region.y >= height) {
+        return false;
+    }
+    resolved.x = region.x;
+    resolved.y = region.y;
+    resolved.width = region.width > 0 ? std::min(region.width, width - region.x) : width - region.x;
+    resolved.height =
+        region.height > 0 ? std::min(region.height, height - region.y) : height - region.y;
+    return true;
+}
+
+void FrameConverter::BGRAToRGB24(const uint8_t *src, uint8_t *dst, size_t pixelCount) {
+    if (UseAVX2()) {
+        BGRAToRGB24AVX2(src, dst, pixelCount);
+    } else {
+        BGRAToRGB24Scalar(src, dst, pixelCount);
+    }
+}
+
+void FrameConverter::BGRAToGray8(const uint8_t *src, uint8_t *dst, size_t pixelCount) {
+    if (UseAVX2()) {
+        BGRAToGray8AVX2(src, dst, pixelCount);
+    } else {
+        BGRAToGray8Scalar(src, dst, pixelCount);
+    }
+}
+
+void FrameConverter::BGRAToPlanarF32(const uint8_t *src, float *dst, size_t pixelCount) {
+    float *r = dst;
+    float *g = dst + pixelCount;
+    float *b = dst + pixelCount * 2;
+    if (UseAVX2()) {
+        BGRAToPlanarF32AVX2(src, r, g, b, pixelCount);
+    } else {
+        BGRAToPlanarF32Scalar(src, r, g, b, pixelCount);
+    }
+}
+
+size_t FrameConverter::FrameSize(PixelFormat format, int width, int height) {
+    size_t pixels = static_cast<size_t>(width) * height;
+    switch (format) {
+    case PixelFormat::BGRA:
+        return pixels * 4;
+    case PixelFormat::RGB24:
+        return pixels * 3;
+    case PixelFormat::GRAY8:
+        return pixels;
+    case PixelFormat::RGBPlanarF32:
+        return pixels * 3 * sizeof(float);
+    }
+    return 0;
+}
+
+bool FrameConverter::Convert(const uint8_t *bgra, int width, int height,
+                             const FrameOutputSpec &spec, std::vector<uint8_t> &out,
+                             int32_t &outWidth, int32_t &outHeight) {
+    if (!bgra || width <= 0 || height <= 0 || spec.width < 0 || spec.height < 0) {
+        return false;
+    }
+
+    // Crop by pointing into the frame; rows keep the full frame's stride
+    size_t stride = static_cast<size_t>(width) * 4;
+    if (!spec.region.IsFull()) {
+        FrameRegion region;
+        if (!ResolveRegion(spec.region, width, height, region)) {
+            return false;
+        }
+        bgra += region.y * stride + static_cast<size_t>(region.x) * 4;
+        width = region.width;
+        height = region.height;
+    }
+    const bool packed = stride == static_cast<size_t>(width) * 4;
+
+    // Resolve output dimensions, preserving aspect ratio if only one side is given
+    outWidth = spec.width;
+    outHeight = spec.height;
+    if (outWidth == 0 && outHeight == 0) {
+        outWidth = width;
+        outHeight = height;
+    } else if (outWidth == 0) {
+        outWidth = std::max(1, static_cast<int>((static_cast<int64_t>(outHeight) * width +
+                                                 height / 2) / height));
+    } else if (outHeight == 0) {
+        outHeight = std::max(1, static_cast<int>((static_cast<int64_t>(outWidth) * height +
+                                                  width / 2) / width));
+    }
+
+    const bool resize = outWidth != width || outHeight != height;
+    const size_t pixelCount = static_cast<size_t>(outWidth) * outHeight;
+    out.resize(FrameSize(spec.pixelFormat, outWidth, outHeight));
+
+    if (spec.pixelFormat == PixelFormat::BGRA) {
+        ResizeBGRA(bgra, width, height, out.data(), outWidth, outHeight, spec.filter, stride);
+        return true;
+    }
+
+    // Resize (or gather cropped rows) into a scratch buffer first, then convert the result
+    thread_local std::vector<uint8_t> resized;
+    const uint8_t *source = bgra;
+    if (resize || !packed) {
+        resized.resize(pixelCount * 4);
+        ResizeBGRA(bgra, width, height, resized.data(), outWidth, outHeight, spec.filter, stride);
+        source = resized.data();
+    }
+
+    switch (spec.pixelFormat) {
+    case PixelFormat::RGB24:
+        BGRAToRGB24(source, out.data(), pixelCount);
+        break;
+    case PixelFormat::GRAY8:
+        BGRAToGray8(source, out.data(), pixelCount);
+        break;
+    case PixelFormat::RGBPlanarF32:
+        BGRAToPlanarF32(source, reinterpret_cast<float *>(out.data()), pixelCount);
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+bool FrameConverter::ParsePixelFormat(const std::string &name, PixelFormat &format) {
+    if (name.empty() || name == "bgra") {
+        format = PixelFormat::BGRA;
+    } else if (name == "rgb24" || name == "rgb") {
+        format = PixelFormat::RGB24;
+    } else if (name == "gray8" || name == "gray") {
+        format = PixelFormat::GRAY8;
+    } else if (name == "rgb_f32_planar") {
+        format = PixelFormat::RGBPlanarF32;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string FrameConverter::PixelFormatName(PixelFormat format) {
+    switch (format) {
+    case PixelFormat::BGRA:
+        return "bgra";
+    case PixelFormat::RGB24:
+        return "rgb24";
+    case PixelFormat::GRAY8:
+        return "gray8";
+    case PixelFormat::RGBPlanarF32:
+        return "rgb_f32_planar";
+    }
+    return "unknown";
+}
+
+bool FrameConverter::ParseResizeFilter(const std::string &name, ResizeFilter &filter) {
+    if (name.empty() || name == "box") {
+        filter = ResizeFilter::Box;
+    } else if (name == "bilinear") {
+        filter = ResizeFilter::Bilinear;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void FrameConverter::SetSimdEnabled(bool enabled) { g_simdEnabled = enabled; }
+
+bool FrameConverter::IsSimdEnabled() { return UseAVX2(); }
@@ -0,0 +1,99 @@
+#include "frame_encode_pipeline.h"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+FrameEncodePipeline::FrameEncodePipeline(size_t numThreads, size_t maxInFlight, EncodeFn encode)
+    : encode_(std::move(encode)), maxInFlight_(std::max<size_t>(maxInFlight, 1)),
+      nextSequence_(0), nextOutput_(0), droppedFrames_(0), stopping_(false) {
+    numThreads = std::max<size_t>(numThreads, 1);
+    for (size_t i = 0; i < numThreads; ++i) {
+        workers_.emplace_back(&FrameEncodePipeline::WorkerLoop, this, i);
+    }
+}
+
+FrameEncodePipeline::~FrameEncodePipeline() { Stop(); }
+
+bool FrameEncodePipeline::Submit(const CapturedFrame &frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+        return false;
+    }
+
+    // Everything between nextOutput_ and nextSequence_ is still owned by the pipeline
+    if (nextSequence_ - nextOutput_ >= maxInFlight_) {
+        droppedFrames_++;
+        return false;
+    }
+
+    pending_.emplace_back(nextSequence_++, frame);
+    workCv_.notify_one();
+    return true;
+}
+
+bool FrameEncodePipeline::Next(EncodedFrame &out, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!doneCv_.wait_for(lock, timeout, [&] {
+            return stopping_ || done_.find(nextOutput_) != done_.end();
+        })) {
+        return false;
+    }
+
+    auto it = done_.find(nextOutput_);
+    if (it == done_.end()) {
+        return false; // Stopping
+    }
+
+    out = std::move(it->second);
+    done_.erase(it);
+    nextOutput_++;
+    return true;
+}
+
+void FrameEncodePipeline::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    workCv_.notify_all();
+    doneCv_.notify_all();
+
+    for (auto &worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers_.clear();
+}
+
+void FrameEncodePipeline::WorkerLoop(size_t worker) {
+    while (true) {
+        uint64_t sequence;
+        EncodedFrame result;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            workCv_.wait(lock, [&] { return stopping_ || !pending_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            sequence = pending_.front().first;
+            result.frame = std::move(pending_.front().second);
+            pending_.pop_front();
+        }
+
+        try {
+            result.ok = encode_(result, worker);
+        } catch (const std::exception &e) {
+            spdlog::error("Frame encode failed: {}", e.what());
+            result.ok = false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_.emplace(sequence, std::move(result));
+        }
+        doneCv_.notify_all();
+    }
+}
@@ -0,0 +1,69 @@
+#include "frame_message_buffer.h"
+
+namespace {
+
+// Field 1, wire type 2 (length-delimited): FrameData.data and Observation.frame
+constexpr uint8_t kField1Bytes = 0x0A;
+
+void AppendVarint(std::string &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void ReleasePayload(void *userData) { delete static_cast<EncodedBuffer *>(userData); }
+
+// header followed by the payload bytes in place
+grpc::ByteBuffer MakeBuffer(const std::string &header, const EncodedBuffer &payload) {
+    grpc::Slice slices[2] = {
+        grpc::Slice(header),
+        grpc::Slice(const_cast<uint8_t *>(payload->data()), payload->size(), ReleasePayload,
+                    new EncodedBuffer(payload)),
+    };
+    return grpc::ByteBuffer(slices, 2);
+}
+
+// Serialized frame fields followed by the data field's tag and length
+std::string FrameHeader(const siphon_service::FrameData &frame, const EncodedBuffer &payload) {
+    std::string header;
+    frame.AppendToString(&header);
+    header.push_back(static_cast<char>(kField1Bytes));
+    AppendVarint(header, payload->size());
+    return header;
+}
+
+} // namespace
+
+grpc::ByteBuffer FrameMessageBuffer::BuildFrame(const siphon_service::FrameData &frame,
+                                                const EncodedBuffer &payload) {
+    if (!payload || payload->empty()) {
+        std::string serialized;
+        frame.SerializeToString(&serialized);
+        grpc::Slice slice(serialized);
+        return grpc::ByteBuffer(&slice, 1);
+    }
+    return MakeBuffer(FrameHeader(frame, payload), payload);
+}
+
+grpc::ByteBuffer FrameMessageBuffer::BuildObservation(
+    const siphon_service::Observation &observation, const siphon_service::FrameData &frame,
+    const EncodedBuffer &payload) {
+    if (!payload || payload->empty()) {
+        siphon_service::Observation complete = observation;
+        *complete.mutable_frame() = frame;
+        std::string serialized;
+        complete.SerializeToString(&serialized);
+        grpc::Slice slice(serialized);
+        return grpc::ByteBuffer(&slice, 1);
+    }
+
+    std::string frameHeader = FrameHeader(frame, payload);
+    std::string header;
+    observation.SerializeToString(&header);
+    header.push_back(static_cast<char>(kField1Bytes));
+    AppendVarint(header, frameHeader.size() + payload->size());
+    header += frameHeader;
+    return MakeBuffer(header, payload);
+}
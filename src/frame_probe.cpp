@@ -0,0 +1,132 @@
+#include "frame_probe.h"
+#include "cpu_features.h"
+#include <algorithm>
+#include <immintrin.h>
+
+namespace {
+
+// Running per-channel reduction; lane i of each array holds channel i % 4
+struct ChannelAccumulator {
+    uint64_t sum[4] = {0, 0, 0, 0};
+    uint8_t min[4] = {255, 255, 255, 255};
+    uint8_t max[4] = {0, 0, 0, 0};
+};
+
+void ReduceRowScalar(const uint8_t *row, size_t pixels, ChannelAccumulator &acc) {
+    for (size_t i = 0; i < pixels; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            uint8_t v = row[i * 4 + c];
+            acc.sum[c] += v;
+            acc.min[c] = std::min(acc.min[c], v);
+            acc.max[c] = std::max(acc.max[c], v);
+        }
+    }
+}
+
+SIPHON_TARGET_AVX2 void ReduceRowAVX2(const uint8_t *row, size_t pixels, ChannelAccumulator &acc) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i minv = _mm256_set1_epi8(static_cast<char>(0xFF));
+    __m256i maxv = zero;
+    __m256i sum32 = zero; // 8 x u32: two pixels' worth of channels
+
+    size_t i = 0;
+    while (i + 8 <= pixels) {
+        // 16-bit partial sums: each step adds at most 2 * 255 per lane, so flush every 128 steps
+        __m256i sum16 = zero;
+        size_t steps = std::min<size_t>((pixels - i) / 8, 128);
+        for (size_t s = 0; s < steps; ++s, i += 8) {
+            __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i * 4));
+            minv = _mm256_min_epu8(minv, px);
+            maxv = _mm256_max_epu8(maxv, px);
+            sum16 = _mm256_add_epi16(sum16, _mm256_add_epi16(_mm256_unpacklo_epi8(px, zero),
+                                                             _mm256_unpackhi_epi8(px, zero)));
+        }
+        sum32 = _mm256_add_epi32(sum32, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(sum16)));
+        sum32 = _mm256_add_epi32(sum32, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(sum16, 1)));
+    }
+
+    alignas(32) uint32_t sums[8];
+    alignas(32) uint8_t mins[32];
+    alignas(32) uint8_t maxs[32];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(sums), sum32);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(mins), minv);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(maxs), maxv);
+    for (int lane = 0; lane < 8; ++lane) {
+        acc.sum[lane % 4] += sums[lane];
+    }
+    if (i > 0) {
+        for (int lane = 0; lane < 32; ++lane) {
+            acc.min[lane % 4] = std::min(acc.min[lane % 4], mins[lane]);
+            acc.max[lane % 4] = std::max(acc.max[lane % 4], maxs[lane]);
+        }
+    }
+
+    ReduceRowScalar(row + i * 4, pixels - i, acc);
+}
+
+} // namespace
+
+bool FrameProbe::ReadPixel(const uint8_t *bgra, int width, int height, int x, int y,
+                           uint8_t out[4]) {
+    if (!bgra || x < 0 || y < 0 || x >= width || y >= height) {
+        std::fill(out, out + 4, 0);
+        return false;
+    }
+    const uint8_t *p = bgra + (static_cast<size_t>(y) * width + x) * 4;
+    std::copy(p, p + 4, out);
+    return true;
+}
+
+bool FrameProbe::ComputeRegionStats(const uint8_t *bgra, int width, int height,
+                                    const FrameRegion &region, int histogramBins,
+                                    RegionStats &stats) {
+    stats = RegionStats();
+    histogramBins = std::clamp(histogramBins, 0, 256);
+    if (!bgra || !FrameConverter::ResolveRegion(region, width, height, stats.region)) {
+        stats.region = region;
+        return false;
+    }
+
+    const bool avx2 = FrameConverter::IsSimdEnabled();
+    const size_t stride = static_cast<size_t>(width) * 4;
+    const size_t rowPixels = static_cast<size_t>(stats.region.width);
+    const uint8_t *origin =
+        bgra + stats.region.y * stride + static_cast<size_t>(stats.region.x) * 4;
+
+    ChannelAccumulator acc;
+    for (int y = 0; y < stats.region.height; ++y) {
+        const uint8_t *row = origin + y * stride;
+        if (avx2) {
+            ReduceRowAVX2(row, rowPixels, acc);
+        } else {
+            ReduceRowScalar(row, rowPixels, acc);
+        }
+    }
+
+    stats.pixelCount = rowPixels * stats.region.height;
+    for (int c = 0; c < 4; ++c) {
+        stats.sum[c] = acc.sum[c];
+        stats.min[c] = acc.min[c];
+        stats.max[c] = acc.max[c];
+    }
+
+    if (histogramBins > 0) {
+        // Value -> bin lookup, then a scattered increment per channel
+        uint16_t binOf[256];
+        for (int v = 0; v < 256; ++v) {
+            binOf[v] = static_cast<uint16_t>(v * histogramBins / 256);
+        }
+        stats.histogram.assign(static_cast<size_t>(histogramBins) * 4, 0);
+        uint32_t *hist = stats.histogram.data();
+        for (int y = 0; y < stats.region.height; ++y) {
+            const uint8_t *p = origin + y * stride;
+            for (size_t x = 0; x < rowPixels; ++x, p += 4) {
+                hist[binOf[p[0]]]++;
+                hist[histogramBins + binOf[p[1]]]++;
+                hist[2 * histogramBins + binOf[p[2]]]++;
+                hist[3 * histogramBins + binOf[p[3]]]++;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,440 @@
+#include "frame_ring.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr uint64_t kAlignment = 64;
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+constexpr uint64_t SlotHeaderSize() { return (sizeof(FrameRingSlot) + 63) / 64 * 64; }
+
+#ifdef _WIN32
+std::string MappingName(const std::string &name) { return "Local\\" + name; }
+std::string SemaphoreName(const std::string &name) { return "Local\\" + name + "_wake"; }
+#else
+std::string ShmName(const std::string &name) { return "/" + name; }
+#endif
+
+} // namespace
+
+// ============================================================================
+// SharedFrameSegment
+// ============================================================================
+
+SharedFrameSegment::SharedFrameSegment()
+    : base_(nullptr), size_(0), owner_(false), fd_(-1), handle_(nullptr), event_(nullptr) {}
+
+SharedFrameSegment::~SharedFrameSegment() { Close(); }
+
+#ifdef _WIN32
+
+bool SharedFrameSegment::Create(const std::string &name, size_t size) {
+    Close();
+
+    uint64_t size64 = size;
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>(size64 >> 32),
+                                        static_cast<DWORD>(size64 & 0xFFFFFFFF),
+                                        MappingName(name).c_str());
+    if (!mapping) {
+        return false;
+    }
+    handle_ = mapping;
+
+    base_ = static_cast<uint8_t *>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+    event_ = CreateSemaphoreA(nullptr, 0, LONG_MAX, SemaphoreName(name).c_str());
+    if (!base_ || !event_) {
+        Close();
+        return false;
+    }
+
+    name_ = name;
+    size_ = size;
+    owner_ = true;
+    return true;
+}
+
+bool SharedFrameSegment::Open(const std::string &name) {
+    Close();
+
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, MappingName(name).c_str());
+    if (!mapping) {
+        return false;
+    }
+    handle_ = mapping;
+
+    base_ = static_cast<uint8_t *>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+    event_ = OpenSemaphoreA(SYNCHRONIZE, FALSE, SemaphoreName(name).c_str());
+    if (!base_ || !event_) {
+        Close();
+        return false;
+    }
+
+    MEMORY_BASIC_INFORMATION info;
+    VirtualQuery(base_, &info, sizeof(info));
+    name_ = name;
+    size_ = info.RegionSize;
+    owner_ = false;
+    return true;
+}
+
+void SharedFrameSegment::Close() {
+    if (base_) {
+        UnmapViewOfFile(base_);
+        base_ = nullptr;
+    }
+    if (event_) {
+        CloseHandle(static_cast<HANDLE>(event_));
+        event_ = nullptr;
+    }
+    if (handle_) {
+        CloseHandle(static_cast<HANDLE>(handle_));
+        handle_ = nullptr;
+    }
+    size_ = 0;
+    owner_ = false;
+}
+
+void SharedFrameSegment::Notify(std::atomic<uint32_t> &wakeCounter,
+                                std::atomic<uint32_t> &waiters) {
+    // Paired with Wait: either the waiter sees the new counter or this sees the waiter
+    wakeCounter.fetch_add(1, std::memory_order_seq_cst);
+    uint32_t waiting = waiters.load(std::memory_order_seq_cst);
+    if (waiting > 0) {
+        // Permits persist, so a reader between its check and WaitForSingleObject still wakes.
+        // Surplus permits from readers that timed out only cause a spurious recheck.
+        ReleaseSemaphore(static_cast<HANDLE>(event_), static_cast<LONG>(waiting), nullptr);
+    }
+}
+
+void SharedFrameSegment::Wait(std::atomic<uint32_t> &wakeCounter, std::atomic<uint32_t> &waiters,
+                              uint32_t expected, int timeoutMs) {
+    waiters.fetch_add(1, std::memory_order_seq_cst);
+    if (wakeCounter.load(std::memory_order_seq_cst) == expected) {
+        WaitForSingleObject(static_cast<HANDLE>(event_), static_cast<DWORD>(timeoutMs));
+    }
+    waiters.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+#else
+
+bool SharedFrameSegment::Create(const std::string &name, size_t size) {
+    Close();
+
+    // Replace a segment left behind by a previous server
+    shm_unlink(ShmName(name).c_str());
+
+    fd_ = shm_open(ShmName(name).c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd_ < 0) {
+        return false;
+    }
+    if (ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+        close(fd_);
+        fd_ = -1;
+        shm_unlink(ShmName(name).c_str());
+        return false;
+    }
+
+    void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (base == MAP_FAILED) {
+        close(fd_);
+        fd_ = -1;
+        shm_unlink(ShmName(name).c_str());
+        return false;
+    }
+
+    base_ = static_cast<uint8_t *>(base);
+    name_ = name;
+    size_ = size;
+    owner_ = true;
+    return true;
+}
+
+bool SharedFrameSegment::Open(const std::string &name) {
+    Close();
+
+    fd_ = shm_open(ShmName(name).c_str(), O_RDWR, 0);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || st.st_size <= 0) {
+        Close();
+        return false;
+    }
+
+    void *base = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd_, 0);
+    if (base == MAP_FAILED) {
+        Close();
+        return false;
+    }
+
+    base_ = static_cast<uint8_t *>(base);
+    name_ = name;
+    size_ = static_cast<size_t>(st.st_size);
+    owner_ = false;
+    return true;
+}
+
+void SharedFrameSegment::Close() {
+    if (base_) {
+        munmap(base_, size_);
+        base_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    if (owner_) {
+        shm_unlink(ShmName(name_).c_str());
+    }
+    size_ = 0;
+    owner_ = false;
+}
+
+void SharedFrameSegment::Notify(std::atomic<uint32_t> &wakeCounter,
+                                std::atomic<uint32_t> &waiters) {
+    wakeCounter.fetch_add(1, std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_seq_cst) == 0) {
+        return; // No reader blocked, skip the syscall
+    }
+    // Shared (non-private) futex: waiters live in other processes
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&wakeCounter), FUTEX_WAKE, INT_MAX, nullptr,
+            nullptr, 0);
+}
+
+void SharedFrameSegment::Wait(std::atomic<uint32_t> &wakeCounter, std::atomic<uint32_t> &waiters,
+                              uint32_t expected, int timeoutMs) {
+    struct timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = static_cast<long>(timeoutMs % 1000) * 1000000;
+    waiters.fetch_add(1, std::memory_order_seq_cst);
+    // Returns immediately if the counter already moved past expected
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&wakeCounter), FUTEX_WAIT, expected, &timeout,
+            nullptr, 0);
+    waiters.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+#endif
+
+// ============================================================================
+// FrameRingWriter
+// ============================================================================
+
+bool FrameRingWriter::Create(const std::string &name, uint32_t slotCount, uint64_t slotCapacity) {
+    Close();
+    if (slotCount == 0 || slotCapacity == 0) {
+        return false;
+    }
+
+    uint64_t headerSize = AlignUp(sizeof(FrameRingHeader), kAlignment);
+    uint64_t slotStride = AlignUp(SlotHeaderSize() + slotCapacity, kAlignment);
+    uint64_t totalSize = headerSize + slotStride * slotCount;
+
+    if (!segment_.Create(name, static_cast<size_t>(totalSize))) {
+        return false;
+    }
+
+    uint8_t *base = segment_.GetBase();
+    memset(base, 0, static_cast<size_t>(headerSize));
+    header_ = new (base) FrameRingHeader();
+    header_->version = FRAME_RING_VERSION;
+    header_->slotCount = slotCount;
+    header_->headerSize = static_cast<uint32_t>(headerSize);
+    header_->slotStride = slotStride;
+    header_->slotCapacity = slotCapacity;
+    header_->published.store(0);
+    header_->wakeCounter.store(0);
+    header_->writerOpen.store(1);
+    header_->waiters.store(0);
+
+    for (uint32_t i = 0; i < slotCount; ++i) {
+        new (base + headerSize + slotStride * i) FrameRingSlot();
+    }
+
+    // Readers check the magic last, so it marks the header as complete
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = FRAME_RING_MAGIC;
+
+    name_ = name;
+    return true;
+}
+
+void FrameRingWriter::Close() {
+    if (header_) {
+        header_->writerOpen.store(0);
+        segment_.Notify(header_->wakeCounter, header_->waiters);
+        header_ = nullptr;
+    }
+    segment_.Close();
+}
+
+bool FrameRingWriter::Publish(const uint8_t *pixels, uint64_t size, int32_t width, int32_t height,
+                              int32_t frameNumber, int64_t timestampUs, uint32_t pixelFormat) {
+    if (!header_ || size > header_->slotCapacity) {
+        return false;
+    }
+
+    uint64_t frameIndex = header_->published.load(std::memory_order_relaxed);
+    uint8_t *slotBase = segment_.GetBase() + header_->headerSize +
+                        header_->slotStride * (frameIndex % header_->slotCount);
+    FrameRingSlot *slot = reinterpret_cast<FrameRingSlot *>(slotBase);
+
+    // Seqlock: odd while writing
+    uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->frameIndex = frameIndex;
+    slot->timestampUs = timestampUs;
+    slot->width = width;
+    slot->height = height;
+    slot->frameNumber = frameNumber;
+    slot->pixelFormat = pixelFormat;
+    slot->size = size;
+    memcpy(slotBase + SlotHeaderSize(), pixels, static_cast<size_t>(size));
+
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+    header_->published.store(frameIndex + 1, std::memory_order_release);
+    segment_.Notify(header_->wakeCounter, header_->waiters);
+    return true;
+}
+
+// ============================================================================
+// FrameRingReader
+// ============================================================================
+
+bool FrameRingReader::Open(const std::string &name) {
+    Close();
+
+    if (!segment_.Open(name)) {
+        return false;
+    }
+
+    auto *header = reinterpret_cast<FrameRingHeader *>(segment_.GetBase());
+    if (segment_.GetSize() < sizeof(FrameRingHeader) || header->magic != FRAME_RING_MAGIC ||
+        header->version != FRAME_RING_VERSION) {
+        segment_.Close();
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    header_ = header;
+    nextIndex_ = 0;
+    skippedFrames_ = 0;
+    return true;
+}
+
+void FrameRingReader::Close() {
+    header_ = nullptr;
+    segment_.Close();
+}
+
+bool FrameRingReader::MapSlot(uint64_t frameIndex, FrameRingView &view) const {
+    uint32_t slotIndex = static_cast<uint32_t>(frameIndex % header_->slotCount);
+    const uint8_t *slotBase =
+        segment_.GetBase() + header_->headerSize + header_->slotStride * slotIndex;
+    const FrameRingSlot *slot = reinterpret_cast<const FrameRingSlot *>(slotBase);
+
+    uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    if (sequence & 1) {
+        return false; // Being rewritten
+    }
+
+    view.frameIndex = slot->frameIndex;
+    view.timestampUs = slot->timestampUs;
+    view.width = slot->width;
+    view.height = slot->height;
+    view.frameNumber = slot->frameNumber;
+    view.pixelFormat = slot->pixelFormat;
+    view.size = std::min<uint64_t>(slot->size, header_->slotCapacity);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->sequence.load(std::memory_order_relaxed) != sequence ||
+        view.frameIndex != frameIndex) {
+        return false; // Lapped while reading the metadata
+    }
+
+    view.pixels = slotBase + SlotHeaderSize();
+    view.slot = slotIndex;
+    view.sequence = sequence;
+    return true;
+}
+
+bool FrameRingReader::Next(FrameRingView &view, int timeoutMs) {
+    if (!header_) {
+        return false;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (true) {
+        uint32_t wake = header_->wakeCounter.load(std::memory_order_acquire);
+        uint64_t published = header_->published.load(std::memory_order_acquire);
+
+        if (published > nextIndex_) {
+            // Always hand out the newest frame; anything older is already stale
+            uint64_t newest = published - 1;
+            if (MapSlot(newest, view)) {
+                skippedFrames_ += newest - nextIndex_;
+                nextIndex_ = newest + 1;
+                return true;
+            }
+            continue; // Raced with the writer, retry with the new newest frame
+        }
+
+        if (!header_->writerOpen.load()) {
+            return false;
+        }
+
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             deadline - std::chrono::steady_clock::now())
+                             .count();
+        if (remaining <= 0) {
+            return false;
+        }
+        segment_.Wait(header_->wakeCounter, header_->waiters, wake, static_cast<int>(remaining));
+    }
+}
+
+bool FrameRingReader::IsValid(const FrameRingView &view) const {
+    if (!header_) {
+        return false;
+    }
+    const FrameRingSlot *slot = reinterpret_cast<const FrameRingSlot *>(
+        segment_.GetBase() + header_->headerSize + header_->slotStride * view.slot);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot->sequence.load(std::memory_order_relaxed) == view.sequence;
+}
+
+bool FrameRingReader::ReadNext(std::vector<uint8_t> &pixels, FrameRingView &meta, int timeoutMs) {
+    while (Next(meta, timeoutMs)) {
+        pixels.assign(meta.pixels, meta.pixels + meta.size);
+        if (IsValid(meta)) {
+            meta.pixels = pixels.data();
+            return true;
+        }
+        // Overwritten mid-copy; fetch the newer frame instead
+    }
+    return false;
+}
@@ -0,0 +1,67 @@
+#include "frame_ring_publisher.h"
+#include <spdlog/spdlog.h>
+
+FrameRingPublisher::FrameRingPublisher(FrameBroadcaster *broadcaster, const FrameOutputSpec &spec,
+                                       const std::string &name, uint32_t slotCount)
+    : broadcaster_(broadcaster), spec_(spec), name_(name), slotCount_(slotCount),
+      subscriptionId_(0), subscribed_(false), failed_(false), oversizeWarned_(false) {}
+
+FrameRingPublisher::~FrameRingPublisher() { Stop(); }
+
+bool FrameRingPublisher::Start(std::chrono::milliseconds timeout) {
+    subscriptionId_ =
+        broadcaster_->Subscribe([this](const CapturedFrame &frame) { OnFrame(frame); }, spec_);
+    subscribed_ = true;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!readyCv_.wait_for(lock, timeout, [this] { return writer_.IsOpen() || failed_; })) {
+        spdlog::error("Frame ring {}: no frame received within {} ms", name_, timeout.count());
+        return false;
+    }
+    if (failed_) {
+        return false;
+    }
+
+    spdlog::info("Frame ring {} ready: {} slots x {} bytes", name_, slotCount_,
+                 writer_.GetSlotCapacity());
+    return true;
+}
+
+void FrameRingPublisher::Stop() {
+    if (subscribed_) {
+        broadcaster_->Unsubscribe(subscriptionId_);
+        subscribed_ = false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    writer_.Close();
+}
+
+void FrameRingPublisher::OnFrame(const CapturedFrame &frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (failed_) {
+        return;
+    }
+
+    if (!writer_.IsOpen()) {
+        if (!writer_.Create(name_, slotCount_, frame.pixels.size())) {
+            spdlog::error("Failed to create frame ring {}", name_);
+            failed_ = true;
+        }
+        readyCv_.notify_all();
+        if (failed_) {
+            return;
+        }
+    }
+
+    // Slots are sized from the first frame; mapped readers can't follow a resize
+    if (!writer_.Publish(frame.pixels.data(), frame.pixels.size(), frame.width, frame.height,
+                         frame.frameNumber, frame.timestampUs,
+                         static_cast<uint32_t>(frame.pixelFormat))) {
+        if (!oversizeWarned_) {
+            spdlog::warn("Frame ring {}: {} byte frame exceeds slot size, skipping", name_,
+                         frame.pixels.size());
+            oversizeWarned_ = true;
+        }
+    }
+}
@@ -0,0 +1,195 @@
+#include "h5_compression_filters.h"
+#include <algorithm>
+#include <cstring>
+#include <lz4.h>
+#include <memory>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <zstd.h>
+
+namespace {
+
+// LZ4 chunks: 8-byte original size, 4-byte block size, then per block a 4-byte compressed size
+// and the block (stored raw when it does not shrink). All sizes big-endian.
+constexpr size_t kLz4HeaderBytes = 12;
+constexpr uint32_t kLz4DefaultBlockBytes = 1u << 30;
+
+void StoreBigEndian(uint8_t *out, uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) {
+        out[i] = static_cast<uint8_t>(value);
+        value >>= 8;
+    }
+}
+
+uint64_t LoadBigEndian(const uint8_t *in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+// HDF5 owns filter buffers, so they are swapped with its allocator
+size_t ReplaceBuffer(void *output, size_t outputCapacity, size_t outputBytes, size_t *bufSize,
+                     void **buf) {
+    H5free_memory(*buf);
+    *buf = output;
+    *bufSize = outputCapacity;
+    return outputBytes;
+}
+
+size_t Lz4Filter(unsigned int flags, size_t cdNelmts, const unsigned int cdValues[],
+                 size_t nbytes, size_t *bufSize, void **buf) {
+    const uint8_t *in = static_cast<const uint8_t *>(*buf);
+
+    if (flags & H5Z_FLAG_REVERSE) {
+        if (nbytes < kLz4HeaderBytes) {
+            return 0;
+        }
+        uint64_t origSize = LoadBigEndian(in, 8);
+        uint64_t blockSize = LoadBigEndian(in + 8, 4);
+        if (blockSize == 0 || blockSize > origSize) {
+            blockSize = origSize;
+        }
+        const uint8_t *read = in + kLz4HeaderBytes;
+        const uint8_t *end = in + nbytes;
+
+        uint8_t *out = static_cast<uint8_t *>(H5allocate_memory(origSize, false));
+        if (!out) {
+            return 0;
+        }
+        for (uint64_t done = 0; done < origSize; done += blockSize) {
+            uint64_t block = std::min(blockSize, origSize - done);
+            if (end - read < 4) {
+                H5free_memory(out);
+                return 0;
+            }
+            uint64_t compressed = LoadBigEndian(read, 4);
+            read += 4;
+            if (static_cast<uint64_t>(end - read) < compressed) {
+                H5free_memory(out);
+                return 0;
+            }
+            if (compressed == block) {
+                std::memcpy(out + done, read, block);
+            } else if (LZ4_decompress_safe(reinterpret_cast<const char *>(read),
+                                           reinterpret_cast<char *>(out + done),
+                                           static_cast<int>(compressed),
+                                           static_cast<int>(block)) != static_cast<int>(block)) {
+                H5free_memory(out);
+                return 0;
+            }
+            read += compressed;
+        }
+        return ReplaceBuffer(out, origSize, origSize, bufSize, buf);
+    }
+
+    if (nbytes == 0 || nbytes > static_cast<size_t>(LZ4_MAX_INPUT_SIZE)) {
+        return 0;
+    }
+    size_t blockSize = cdNelmts > 0 && cdValues[0] > 0 ? cdValues[0] : kLz4DefaultBlockBytes;
+    blockSize = std::min(blockSize, nbytes);
+    size_t blocks = (nbytes + blockSize - 1) / blockSize;
+    size_t capacity =
+        kLz4HeaderBytes + blocks * (4 + LZ4_compressBound(static_cast<int>(blockSize)));
+
+    uint8_t *out = static_cast<uint8_t *>(H5allocate_memory(capacity, false));
+    if (!out) {
+        return 0;
+    }
+    StoreBigEndian(out, nbytes, 8);
+    StoreBigEndian(out + 8, blockSize, 4);
+    size_t written = kLz4HeaderBytes;
+    for (size_t done = 0; done < nbytes; done += blockSize) {
+        int block = static_cast<int>(std::min(blockSize, nbytes - done));
+        char *dest = reinterpret_cast<char *>(out + written + 4);
+        int compressed = LZ4_compress_default(reinterpret_cast<const char *>(in + done), dest,
+                                              block, LZ4_compressBound(block));
+        if (compressed <= 0) {
+            H5free_memory(out);
+            return 0;
+        }
+        if (compressed >= block) {
+            std::memcpy(dest, in + done, block);
+            compressed = block;
+        }
+        StoreBigEndian(out + written, static_cast<uint64_t>(compressed), 4);
+        written += 4 + compressed;
+    }
+    return ReplaceBuffer(out, capacity, written, bufSize, buf);
+}
+
+// Whole chunk as one zstd frame; cd_values[0] is the level
+size_t ZstdFilter(unsigned int flags, size_t cdNelmts, const unsigned int cdValues[],
+                  size_t nbytes, size_t *bufSize, void **buf) {
+    if (flags & H5Z_FLAG_REVERSE) {
+        unsigned long long origSize = ZSTD_getFrameContentSize(*buf, nbytes);
+        if (origSize == ZSTD_CONTENTSIZE_ERROR || origSize == ZSTD_CONTENTSIZE_UNKNOWN) {
+            return 0;
+        }
+        void *out = H5allocate_memory(origSize, false);
+        if (!out) {
+            return 0;
+        }
+        size_t decompressed = ZSTD_decompress(out, origSize, *buf, nbytes);
+        if (ZSTD_isError(decompressed)) {
+            H5free_memory(out);
+            return 0;
+        }
+        return ReplaceBuffer(out, origSize, decompressed, bufSize, buf);
+    }
+
+    // One context per writer thread, reused across chunks
+    struct ContextDeleter {
+        void operator()(ZSTD_CCtx *context) const { ZSTD_freeCCtx(context); }
+    };
+    thread_local std::unique_ptr<ZSTD_CCtx, ContextDeleter> context(ZSTD_createCCtx());
+    if (!context) {
+        return 0;
+    }
+
+    int level = cdNelmts > 0 ? static_cast<int>(cdValues[0]) : ZSTD_CLEVEL_DEFAULT;
+    size_t capacity = ZSTD_compressBound(nbytes);
+    void *out = H5allocate_memory(capacity, false);
+    if (!out) {
+        return 0;
+    }
+    size_t compressed = ZSTD_compressCCtx(context.get(), out, capacity, *buf, nbytes, level);
+    if (ZSTD_isError(compressed)) {
+        spdlog::error("zstd filter failed: {}", ZSTD_getErrorName(compressed));
+        H5free_memory(out);
+        return 0;
+    }
+    return ReplaceBuffer(out, capacity, compressed, bufSize, buf);
+}
+
+const H5Z_class2_t kLz4Class = {
+    H5Z_CLASS_T_VERS, H5CompressionFilters::kLz4, 1, 1, "lz4", nullptr, nullptr, Lz4Filter,
+};
+
+const H5Z_class2_t kZstdClass = {
+    H5Z_CLASS_T_VERS, H5CompressionFilters::kZstd, 1, 1, "zstd", nullptr, nullptr, ZstdFilter,
+};
+
+} // namespace
+
+bool H5CompressionFilters::EnsureAvailable(H5Z_filter_t filter) {
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Also loads a matching plugin from HDF5_PLUGIN_PATH
+    if (H5Zfilter_avail(filter) > 0) {
+        return true;
+    }
+
+    const H5Z_class2_t *builtin = filter == kLz4 ? &kLz4Class : filter == kZstd ? &kZstdClass
+                                                                                : nullptr;
+    if (!builtin) {
+        return false;
+    }
+    if (H5Zregister(builtin) < 0) {
+        spdlog::error("Failed to register HDF5 filter {}", builtin->name);
+        return false;
+    }
+    return true;
+}
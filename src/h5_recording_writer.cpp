@@ -1,16 +1,89 @@
 #include "h5_recording_writer.h"
+#include "h5_compression_filters.h"
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <spdlog/spdlog.h>
 
+namespace {
+
+int64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// Rows per chunk of the per-frame metadata datasets
+constexpr hsize_t kMetadataChunkRows = 1024;
+
+// Keep the partially filled chunk of a small dataset in the cache between batches so it is
+// compressed and written once when it fills, not rewritten on every batch
+H5::DSetAccPropList MetadataAccess(size_t chunkBytes) {
+    H5::DSetAccPropList access;
+    access.setChunkCache(521, std::max<size_t>(chunkBytes * 2, 1 << 20), 1.0);
+    return access;
+}
+
+H5::DataSet CreateRowDataset(H5::H5File &file, const char *name, const H5::PredType &type,
+                             hsize_t columns, size_t elementSize) {
+    int rank = columns > 0 ? 2 : 1;
+    hsize_t dims[2] = {0, columns};
+    hsize_t maxDims[2] = {H5S_UNLIMITED, columns};
+    hsize_t chunk[2] = {kMetadataChunkRows, columns};
+
+    H5::DataSpace space(rank, dims, maxDims);
+    H5::DSetCreatPropList props;
+    props.setChunk(rank, chunk);
+    props.setDeflate(1);
+
+    size_t chunkBytes = kMetadataChunkRows * std::max<hsize_t>(columns, 1) * elementSize;
+    return file.createDataSet(name, type, space, props, MetadataAccess(chunkBytes));
+}
+
+void WriteStringArrayAttribute(H5::DataSet &dataset, const char *name,
+                               const std::vector<std::string> &values) {
+    H5::StrType strType(H5::PredType::C_S1, H5T_VARIABLE);
+    hsize_t dims[1] = {values.size()};
+    H5::DataSpace space(1, dims);
+    H5::Attribute attr = dataset.createAttribute(name, strType, space);
+
+    std::vector<const char *> pointers;
+    for (const auto &value : values) {
+        pointers.push_back(value.c_str());
+    }
+    attr.write(strType, pointers.data());
+}
+
+} // namespace
+
 H5RecordingWriter::H5RecordingWriter(const std::string &filepath, int width, int height,
                                      const std::vector<std::string> &attributeNames,
-                                     size_t queueSize)
-    : filepath_(filepath), width_(width), height_(height), attributeNames_(attributeNames),
-      queue_(queueSize), framesWritten_(0), finalized_(false) {
+                                     const H5WriterOptions &options)
+    : filepath_(filepath), width_(width), height_(height), channels_(options.dropAlpha ? 3 : 4),
+      attributeNames_(attributeNames),
+      options_(options), batchRows_(0), capacity_(0),
+      queue_(std::max<size_t>(1, options.queueSize)), framesWritten_(0), finalized_(false) {
+    options_.batchFrames = std::max<size_t>(1, options_.batchFrames);
+    options_.extentFrames = std::max(options_.extentFrames, options_.batchFrames);
+    keyColumns_.fill(-1);
+
+    const size_t frameBytes = static_cast<size_t>(width_) * height_ * channels_;
+    const size_t batch = options_.batchFrames;
+    batchPixels_.resize(batch * frameBytes);
+    batchFrameNumbers_.resize(batch);
+    batchTimestamps_.resize(batch);
+    batchMemory_.resize(batch * attributeNames_.size());
+    batchInputs_.resize(batch * kInputColumns);
+    batchLatencies_.resize(batch * kLatencyColumns);
 
     try {
+        // Newer file format: cheaper chunk indexes for datasets with one unlimited dimension
+        H5::FileAccPropList fileAccess;
+        fileAccess.setLibverBounds(H5F_LIBVER_V110, H5F_LIBVER_LATEST);
+
         // Create HDF5 file
-        file_ = H5::H5File(filepath_, H5F_ACC_TRUNC);
+        file_ = H5::H5File(filepath_, H5F_ACC_TRUNC, H5::FileCreatPropList::DEFAULT, fileAccess);
 
         // Initialize datasets
         InitializeDatasets();
@@ -20,7 +93,11 @@ H5RecordingWriter::H5RecordingWriter(const std::string &filepath, int width, int
 
         spdlog::info("H5RecordingWriter initialized: {}", filepath_);
         spdlog::info("Frame dimensions: {}x{}", width_, height_);
-        spdlog::info("Queue size: {}", queueSize);
+        spdlog::info("Queue size: {}, batch: {} frames, extent: {} frames", options_.queueSize,
+                     options_.batchFrames, options_.extentFrames);
+        spdlog::info("Frame compression: {} (level {}), tile: {}, channels: {}",
+                     CompressionName(options_.compression), options_.compressionLevel,
+                     options_.tileSize, channels_);
 
     } catch (const H5::Exception &e) {
         spdlog::error("Failed to create HDF5 file: {}", e.getCDetailMsg());
@@ -36,73 +113,76 @@ H5RecordingWriter::~H5RecordingWriter() {
 
 void H5RecordingWriter::InitializeDatasets() {
     try {
-        // 1. Frames dataset: [N, height, width, 4] uint8 with chunking and compression
-        hsize_t frameDims[4] = {0, static_cast<hsize_t>(height_), static_cast<hsize_t>(width_), 4};
-        hsize_t frameMaxDims[4] = {H5S_UNLIMITED, static_cast<hsize_t>(height_),
-                                   static_cast<hsize_t>(width_), 4};
-        hsize_t frameChunk[4] = {1, static_cast<hsize_t>(height_), static_cast<hsize_t>(width_), 4};
+        if (!CompressionAvailable(options_.compression)) {
+            throw H5::Exception("InitializeDatasets",
+                                std::string("HDF5 filter not available: ") +
+                                    CompressionName(options_.compression));
+        }
+
+        // 1. Frames dataset: [N, height, width, channels] uint8, one frame or tile per chunk
+        const hsize_t height = height_;
+        const hsize_t width = width_;
+        const hsize_t channels = channels_;
+        const hsize_t tile = options_.tileSize > 0 ? options_.tileSize : 0;
+        hsize_t frameDims[4] = {0, height, width, channels};
+        hsize_t frameMaxDims[4] = {H5S_UNLIMITED, height, width, channels};
+        hsize_t frameChunk[4] = {1, tile ? std::min(tile, height) : height,
+                                 tile ? std::min(tile, width) : width, channels};
 
         H5::DataSpace frameSpace(4, frameDims, frameMaxDims);
         H5::DSetCreatPropList frameProps;
         frameProps.setChunk(4, frameChunk);
-        frameProps.setDeflate(1); // LZ4-like compression, level 1 for speed
-
-        framesDataset_ =
-            file_.createDataSet("frames", H5::PredType::NATIVE_UINT8, frameSpace, frameProps);
+        const unsigned level = static_cast<unsigned>(std::max(options_.compressionLevel, 0));
+        switch (options_.compression) {
+        case H5FrameCompression::None:
+            break;
+        case H5FrameCompression::Deflate:
+            frameProps.setDeflate(std::min(level, 9u));
+            break;
+        case H5FrameCompression::Lz4:
+            frameProps.setFilter(H5CompressionFilters::kLz4, H5Z_FLAG_MANDATORY);
+            break;
+        case H5FrameCompression::Zstd: {
+            unsigned int zstdLevel = std::max(level, 1u);
+            frameProps.setFilter(H5CompressionFilters::kZstd, H5Z_FLAG_MANDATORY, 1, &zstdLevel);
+            break;
+        }
+        case H5FrameCompression::Blosc: {
+            // The plugin fills in the first four values; then level, shuffle, Blosc's LZ4 codec
+            unsigned int bloscValues[7] = {0, 0, 0, 0, std::min(level, 9u), 1, 1};
+            frameProps.setFilter(H5CompressionFilters::kBlosc, H5Z_FLAG_MANDATORY, 7,
+                                 bloscValues);
+            break;
+        }
+        }
 
-        // 2. Timestamps dataset: [N] int64
-        hsize_t timeDims[1] = {0};
-        hsize_t timeMaxDims[1] = {H5S_UNLIMITED};
-        hsize_t timeChunk[1] = {1024}; // Chunk 1024 timestamps together
+        // Writes cover whole frames and so whole chunks; caching them would only add a copy
+        H5::DSetAccPropList frameAccess;
+        frameAccess.setChunkCache(1, 0, 1.0);
 
-        H5::DataSpace timeSpace(1, timeDims, timeMaxDims);
-        H5::DSetCreatPropList timeProps;
-        timeProps.setChunk(1, timeChunk);
-        timeProps.setDeflate(1);
+        framesDataset_ = file_.createDataSet("frames", H5::PredType::NATIVE_UINT8, frameSpace,
+                                             frameProps, frameAccess);
 
-        timestampsDataset_ =
-            file_.createDataSet("timestamps", H5::PredType::NATIVE_INT64, timeSpace, timeProps);
+        // 2. Frame numbers and timestamps: [N]
+        frameNumbersDataset_ = CreateRowDataset(file_, "frame_numbers", H5::PredType::NATIVE_INT32,
+                                                0, sizeof(int32_t));
+        timestampsDataset_ = CreateRowDataset(file_, "timestamps", H5::PredType::NATIVE_INT64, 0,
+                                              sizeof(int64_t));
 
         // 3. Memory data dataset: [N, num_attributes] float32
         if (!attributeNames_.empty()) {
-            hsize_t memDims[2] = {0, attributeNames_.size()};
-            hsize_t memMaxDims[2] = {H5S_UNLIMITED, attributeNames_.size()};
-            hsize_t memChunk[2] = {1024, attributeNames_.size()};
-
-            H5::DataSpace memSpace(2, memDims, memMaxDims);
-            H5::DSetCreatPropList memProps;
-            memProps.setChunk(2, memChunk);
-            memProps.setDeflate(1);
-
-            memoryDataset_ =
-                file_.createDataSet("memory_data", H5::PredType::NATIVE_FLOAT, memSpace, memProps);
-
-            // Store attribute names as dataset attribute
-            H5::StrType strType(H5::PredType::C_S1, H5T_VARIABLE);
-            hsize_t attrDims[1] = {attributeNames_.size()};
-            H5::DataSpace attrSpace(1, attrDims);
-            H5::Attribute attr =
-                memoryDataset_.createAttribute("attribute_names", strType, attrSpace);
-
-            std::vector<const char *> attrNames;
-            for (const auto &name : attributeNames_) {
-                attrNames.push_back(name.c_str());
-            }
-            attr.write(strType, attrNames.data());
+            memoryDataset_ = CreateRowDataset(file_, "memory_data", H5::PredType::NATIVE_FLOAT,
+                                              attributeNames_.size(), sizeof(float));
+            WriteStringArrayAttribute(memoryDataset_, "attribute_names", attributeNames_);
         }
 
-        // 4. Latencies dataset: [N, 4] float32 (frame_capture, memory_read, disk_write, total)
-        hsize_t latDims[2] = {0, 4};
-        hsize_t latMaxDims[2] = {H5S_UNLIMITED, 4};
-        hsize_t latChunk[2] = {1024, 4};
+        // 4. Inputs dataset: [N, 300] uint8, columns assigned as keys are first pressed
+        inputsDataset_ = CreateRowDataset(file_, "inputs", H5::PredType::NATIVE_UINT8,
+                                          kInputColumns, sizeof(uint8_t));
 
-        H5::DataSpace latSpace(2, latDims, latMaxDims);
-        H5::DSetCreatPropList latProps;
-        latProps.setChunk(2, latChunk);
-        latProps.setDeflate(1);
-
-        latenciesDataset_ =
-            file_.createDataSet("latencies", H5::PredType::NATIVE_FLOAT, latSpace, latProps);
+        // 5. Latencies dataset: [N, 5] float32
+        latenciesDataset_ = CreateRowDataset(file_, "latencies", H5::PredType::NATIVE_FLOAT,
+                                             kLatencyColumns, sizeof(float));
 
         spdlog::info("HDF5 datasets initialized successfully");
 
@@ -112,120 +192,219 @@ void H5RecordingWriter::InitializeDatasets() {
     }
 }
 
+bool H5RecordingWriter::ParseCompression(const std::string &name,
+                                         H5FrameCompression &compression) {
+    if (name.empty() || name == "deflate") {
+        compression = H5FrameCompression::Deflate;
+    } else if (name == "none") {
+        compression = H5FrameCompression::None;
+    } else if (name == "lz4") {
+        compression = H5FrameCompression::Lz4;
+    } else if (name == "zstd") {
+        compression = H5FrameCompression::Zstd;
+    } else if (name == "blosc") {
+        compression = H5FrameCompression::Blosc;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *H5RecordingWriter::CompressionName(H5FrameCompression compression) {
+    switch (compression) {
+    case H5FrameCompression::None:
+        return "none";
+    case H5FrameCompression::Deflate:
+        return "deflate";
+    case H5FrameCompression::Lz4:
+        return "lz4";
+    case H5FrameCompression::Zstd:
+        return "zstd";
+    case H5FrameCompression::Blosc:
+        return "blosc";
+    }
+    return "unknown";
+}
+
+bool H5RecordingWriter::CompressionAvailable(H5FrameCompression compression) {
+    switch (compression) {
+    case H5FrameCompression::Lz4:
+        return H5CompressionFilters::EnsureAvailable(H5CompressionFilters::kLz4);
+    case H5FrameCompression::Zstd:
+        return H5CompressionFilters::EnsureAvailable(H5CompressionFilters::kZstd);
+    case H5FrameCompression::Blosc:
+        return H5CompressionFilters::EnsureAvailable(H5CompressionFilters::kBlosc);
+    default:
+        return true;
+    }
+}
+
 void H5RecordingWriter::QueueFrame(H5FrameData frameData) {
     if (finalized_) {
         spdlog::warn("Cannot queue frame - writer already finalized");
         return;
     }
+    frameData.queuedUs = NowUs();
     queue_.push(std::move(frameData));
 }
 
 void H5RecordingWriter::WriterThread() {
     spdlog::info("H5 writer thread started");
 
-    H5FrameData frameData;
-    while (queue_.pop(frameData)) {
-        try {
-            WriteFrame(frameData);
-            framesWritten_++;
-        } catch (const H5::Exception &e) {
-            spdlog::error("Failed to write frame {}: {}", frameData.frameNumber, e.getCDetailMsg());
+    // Take whatever is queued, up to the rest of the batch, in one wakeup
+    std::vector<H5FrameData> pending(options_.batchFrames);
+    size_t count;
+    while ((count = queue_.pop_n(pending.data(), options_.batchFrames - batchRows_)) > 0) {
+        for (size_t i = 0; i < count; ++i) {
+            AddToBatch(pending[i]);
+        }
+        if (batchRows_ == options_.batchFrames) {
+            WriteBatch();
         }
     }
+    WriteBatch();
 
     spdlog::info("H5 writer thread stopped - {} frames written", framesWritten_.load());
 }
 
-void H5RecordingWriter::WriteFrame(const H5FrameData &frameData) {
-    try {
-        int frameIdx = framesWritten_.load();
-
-        // 1. Write frame pixels
-        {
-            hsize_t newSize[4] = {static_cast<hsize_t>(frameIdx + 1), static_cast<hsize_t>(height_),
-                                  static_cast<hsize_t>(width_), 4};
-            framesDataset_.extend(newSize);
+void H5RecordingWriter::AddToBatch(const H5FrameData &frameData) {
+    const size_t row = batchRows_;
+    const size_t pixelCount = static_cast<size_t>(width_) * height_;
+    const size_t frameBytes = pixelCount * channels_;
 
-            hsize_t offset[4] = {static_cast<hsize_t>(frameIdx), 0, 0, 0};
-            hsize_t count[4] = {1, static_cast<hsize_t>(height_), static_cast<hsize_t>(width_), 4};
-
-            H5::DataSpace filespace = framesDataset_.getSpace();
-            filespace.selectHyperslab(H5S_SELECT_SET, count, offset);
-
-            H5::DataSpace memspace(4, count);
-            framesDataset_.write(frameData.pixels.data(), H5::PredType::NATIVE_UINT8, memspace,
-                                 filespace);
+    uint8_t *pixels = batchPixels_.data() + row * frameBytes;
+    size_t copied = std::min(pixelCount, frameData.pixels.size() / 4);
+    if (copied != pixelCount) {
+        spdlog::warn("Frame {} has {} bytes, expected {}", frameData.frameNumber,
+                     frameData.pixels.size(), pixelCount * 4);
+    }
+    if (channels_ == 4) {
+        std::memcpy(pixels, frameData.pixels.data(), copied * 4);
+    } else {
+        const uint8_t *src = frameData.pixels.data();
+        for (size_t i = 0; i < copied; ++i) {
+            pixels[i * 3 + 0] = src[i * 4 + 0];
+            pixels[i * 3 + 1] = src[i * 4 + 1];
+            pixels[i * 3 + 2] = src[i * 4 + 2];
         }
+    }
+    std::memset(pixels + copied * channels_, 0, frameBytes - copied * channels_);
 
-        // 2. Write timestamp (microseconds since epoch)
-        {
-            hsize_t newSize[1] = {static_cast<hsize_t>(frameIdx + 1)};
-            timestampsDataset_.extend(newSize);
-
-            hsize_t offset[1] = {static_cast<hsize_t>(frameIdx)};
-            hsize_t count[1] = {1};
+    batchFrameNumbers_[row] = frameData.frameNumber;
+    batchTimestamps_[row] = frameData.timestampUs;
 
-            H5::DataSpace filespace = timestampsDataset_.getSpace();
-            filespace.selectHyperslab(H5S_SELECT_SET, count, offset);
+    const size_t attributes = attributeNames_.size();
+    for (size_t i = 0; i < attributes; ++i) {
+        batchMemory_[row * attributes + i] = i < frameData.memoryValues.size()
+                                                 ? frameData.memoryValues[i]
+                                                 : std::nanf("");
+    }
 
-            H5::DataSpace memspace(1, count);
-            timestampsDataset_.write(&frameData.timestampUs, H5::PredType::NATIVE_INT64, memspace,
-                                     filespace);
+    uint8_t *inputs = batchInputs_.data() + row * kInputColumns;
+    std::memset(inputs, 0, kInputColumns);
+    for (int vk = 1; vk < 256; ++vk) {
+        if (!(frameData.keyState[vk / 8] & (1u << (vk % 8)))) {
+            continue;
         }
-
-        // 3. Write memory data
-        if (!attributeNames_.empty()) {
-            std::vector<float> memValues;
-            for (const auto &attrName : attributeNames_) {
-                float value = 0.0f;
-                auto it = frameData.memoryData.find(attrName);
-                if (it != frameData.memoryData.end()) {
-                    try {
-                        value = std::stof(it->second);
-                    } catch (...) {
-                        value = 0.0f;
-                    }
-                }
-                memValues.push_back(value);
+        if (keyColumns_[vk] < 0) {
+            // Shift/Ctrl/Alt are reported both generically and per side; keep the sided keys
+            if (vk >= 0x10 && vk <= 0x12) {
+                continue;
+            }
+            if (columnKeys_.size() == kInputColumns) {
+                continue;
             }
+            keyColumns_[vk] = static_cast<int>(columnKeys_.size());
+            columnKeys_.push_back(vk);
+        }
+        inputs[keyColumns_[vk]] = 1;
+    }
 
-            hsize_t newSize[2] = {static_cast<hsize_t>(frameIdx + 1), attributeNames_.size()};
-            memoryDataset_.extend(newSize);
+    int64_t nowUs = NowUs();
+    float *latencies = batchLatencies_.data() + row * kLatencyColumns;
+    latencies[0] = static_cast<float>(frameData.frameCaptureMs);
+    latencies[1] = static_cast<float>(frameData.memoryReadMs);
+    latencies[2] = static_cast<float>(frameData.keyStateMs);
+    latencies[3] = static_cast<float>(nowUs - frameData.queuedUs) / 1000.0f;
+    latencies[4] = static_cast<float>(nowUs - frameData.timestampUs) / 1000.0f;
 
-            hsize_t offset[2] = {static_cast<hsize_t>(frameIdx), 0};
-            hsize_t count[2] = {1, attributeNames_.size()};
+    batchRows_++;
+}
 
-            H5::DataSpace filespace = memoryDataset_.getSpace();
-            filespace.selectHyperslab(H5S_SELECT_SET, count, offset);
+void H5RecordingWriter::WriteBatch() {
+    if (batchRows_ == 0) {
+        return;
+    }
 
-            H5::DataSpace memspace(2, count);
-            memoryDataset_.write(memValues.data(), H5::PredType::NATIVE_FLOAT, memspace, filespace);
-        }
+    const hsize_t rows = batchRows_;
+    try {
+        EnsureCapacity(framesWritten_.load() + rows);
 
-        // 4. Write latencies (frame_capture, memory_read, disk_write, total)
-        {
-            float latencies[4] = {static_cast<float>(frameData.frameCaptureMs),
-                                  static_cast<float>(frameData.memoryReadMs),
-                                  static_cast<float>(frameData.diskWriteMs),
-                                  static_cast<float>(frameData.totalLatencyMs)};
+        WriteRows(framesDataset_, rows, batchPixels_.data(), H5::PredType::NATIVE_UINT8);
+        WriteRows(frameNumbersDataset_, rows, batchFrameNumbers_.data(),
+                  H5::PredType::NATIVE_INT32);
+        WriteRows(timestampsDataset_, rows, batchTimestamps_.data(), H5::PredType::NATIVE_INT64);
+        if (!attributeNames_.empty()) {
+            WriteRows(memoryDataset_, rows, batchMemory_.data(), H5::PredType::NATIVE_FLOAT);
+        }
+        WriteRows(inputsDataset_, rows, batchInputs_.data(), H5::PredType::NATIVE_UINT8);
+        WriteRows(latenciesDataset_, rows, batchLatencies_.data(), H5::PredType::NATIVE_FLOAT);
 
-            hsize_t newSize[2] = {static_cast<hsize_t>(frameIdx + 1), 4};
-            latenciesDataset_.extend(newSize);
+        framesWritten_ += static_cast<int>(rows);
+    } catch (const H5::Exception &e) {
+        spdlog::error("Failed to write frames {}-{}: {}", batchFrameNumbers_[0],
+                      batchFrameNumbers_[batchRows_ - 1], e.getCDetailMsg());
+    }
+    batchRows_ = 0;
+}
 
-            hsize_t offset[2] = {static_cast<hsize_t>(frameIdx), 0};
-            hsize_t count[2] = {1, 4};
+void H5RecordingWriter::EnsureCapacity(hsize_t rows) {
+    if (rows <= capacity_) {
+        return;
+    }
 
-            H5::DataSpace filespace = latenciesDataset_.getSpace();
-            filespace.selectHyperslab(H5S_SELECT_SET, count, offset);
+    hsize_t extent = options_.extentFrames;
+    hsize_t capacity = (rows + extent - 1) / extent * extent;
 
-            H5::DataSpace memspace(2, count);
-            latenciesDataset_.write(latencies, H5::PredType::NATIVE_FLOAT, memspace, filespace);
+    H5::DataSet *datasets[] = {&framesDataset_,  &frameNumbersDataset_, &timestampsDataset_,
+                               &memoryDataset_,  &inputsDataset_,       &latenciesDataset_};
+    for (H5::DataSet *dataset : datasets) {
+        if (dataset == &memoryDataset_ && attributeNames_.empty()) {
+            continue;
         }
+        H5::DataSpace space = dataset->getSpace();
+        hsize_t dims[4];
+        space.getSimpleExtentDims(dims);
+        dims[0] = capacity;
+        dataset->extend(dims);
+    }
+    capacity_ = capacity;
+}
 
-    } catch (const H5::Exception &e) {
-        spdlog::error("HDF5 write error: {}", e.getCDetailMsg());
-        throw;
+void H5RecordingWriter::WriteRows(H5::DataSet &dataset, hsize_t rows, const void *data,
+                                  const H5::PredType &type) {
+    H5::DataSpace filespace = dataset.getSpace();
+    int rank = filespace.getSimpleExtentNdims();
+    hsize_t count[4];
+    filespace.getSimpleExtentDims(count);
+    hsize_t offset[4] = {static_cast<hsize_t>(framesWritten_.load()), 0, 0, 0};
+    count[0] = rows;
+
+    filespace.selectHyperslab(H5S_SELECT_SET, count, offset);
+    H5::DataSpace memspace(rank, count);
+    dataset.write(data, type, memspace, filespace);
+}
+
+void H5RecordingWriter::WriteKeyMapping() {
+    if (columnKeys_.empty()) {
+        return;
     }
+    std::vector<std::string> names;
+    for (int vk : columnKeys_) {
+        names.push_back(options_.keyName ? options_.keyName(vk)
+                                         : "UNKNOWN_" + std::to_string(vk));
+    }
+    WriteStringArrayAttribute(inputsDataset_, "key_mapping", names);
 }
 
 void H5RecordingWriter::Finalize() {
@@ -235,20 +414,35 @@ void H5RecordingWriter::Finalize() {
 
     spdlog::info("Finalizing H5 writer - queue size: {}", queue_.size());
 
-    // Stop queue and wait for writer thread to drain
-    queue_.stop();
+    // Close queue and wait for writer thread to drain
+    queue_.close();
 
     if (writerThread_.joinable()) {
         writerThread_.join();
     }
 
-    // Close file
+    // Trim the preallocated extent to the frames written, then close the file
     try {
-        framesDataset_.close();
-        timestampsDataset_.close();
-        if (memoryDataset_.getId() > 0)
-            memoryDataset_.close();
-        latenciesDataset_.close();
+        capacity_ = 0;
+        H5::DataSet *datasets[] = {&framesDataset_, &frameNumbersDataset_, &timestampsDataset_,
+                                   &memoryDataset_, &inputsDataset_,       &latenciesDataset_};
+        for (H5::DataSet *dataset : datasets) {
+            if (dataset == &memoryDataset_ && attributeNames_.empty()) {
+                continue;
+            }
+            H5::DataSpace space = dataset->getSpace();
+            hsize_t dims[4];
+            space.getSimpleExtentDims(dims);
+            dims[0] = static_cast<hsize_t>(framesWritten_.load());
+            dataset->extend(dims);
+        }
+        WriteKeyMapping();
+
+        for (H5::DataSet *dataset : datasets) {
+            if (dataset->getId() > 0) {
+                dataset->close();
+            }
+        }
         file_.close();
     } catch (const H5::Exception &e) {
         spdlog::error("Error closing HDF5 file: {}", e.getCDetailMsg());
@@ -2,12 +2,16 @@
 #include <map>
 #include <spdlog/spdlog.h>
 
+namespace {
+constexpr size_t kWriteBatch = 256; // Events written per queue pop
+} // namespace
+
 // Static instance for hook callbacks
 InputEventLogger *InputEventLogger::instance_ = nullptr;
 
 InputEventLogger::InputEventLogger()
     : isLogging_(false), shouldStop_(false), hooksReady_(false), keyboardHook_(nullptr),
-      mouseHook_(nullptr), maxBufferSize_(10000) {
+      mouseHook_(nullptr), events_(kMaxBufferedEvents), droppedEvents_(0) {
     instance_ = this;
 }
 
@@ -46,10 +50,10 @@ bool InputEventLogger::StartLogging(const std::string &outputFilePath) {
     outputFile_.flush();
 
     // Clear event buffer
-    {
-        std::lock_guard<std::mutex> lock(bufferMutex_);
-        eventBuffer_.clear();
+    InputEvent stale;
+    while (events_.try_pop(stale)) {
     }
+    droppedEvents_ = 0;
 
     // Start hook thread
     hooksReady_ = false;
@@ -103,6 +107,9 @@ bool InputEventLogger::StopLogging() {
 
     // Final flush
     FlushBuffer();
+    if (droppedEvents_ > 0) {
+        spdlog::warn("Input event buffer overflow: {} events dropped", droppedEvents_.load());
+    }
 
     // Close file
     if (outputFile_.is_open()) {
@@ -160,25 +167,28 @@ void InputEventLogger::HookMessageLoop() {
 void InputEventLogger::WriterLoop() {
     spdlog::info("Input event writer thread started");
 
+    // Write events as they arrive, waking at least every 100ms to check for stop
+    std::vector<InputEvent> events(kWriteBatch);
     while (!shouldStop_) {
-        // Flush buffer every 100ms
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        FlushBuffer();
+        size_t count =
+            events_.pop_n_for(events.data(), events.size(), std::chrono::milliseconds(100));
+        WriteEvents(events.data(), count);
     }
 
     spdlog::info("Input event writer thread stopped");
 }
 
 void InputEventLogger::FlushBuffer() {
-    std::vector<InputEvent> eventsToWrite;
+    std::vector<InputEvent> events(kWriteBatch);
+    size_t count;
+    while ((count = events_.try_pop_n(events.data(), events.size())) > 0) {
+        WriteEvents(events.data(), count);
+    }
+}
 
-    // Swap out the buffer
-    {
-        std::lock_guard<std::mutex> lock(bufferMutex_);
-        if (eventBuffer_.empty()) {
-            return;
-        }
-        eventsToWrite.swap(eventBuffer_);
+void InputEventLogger::WriteEvents(const InputEvent *events, size_t count) {
+    if (count == 0) {
+        return;
     }
 
     // Write to file
@@ -188,21 +198,26 @@ void InputEventLogger::FlushBuffer() {
             return;
         }
 
-        for (const auto &event : eventsToWrite) {
+        for (size_t i = 0; i < count; ++i) {
+            const InputEvent &event = events[i];
             outputFile_ << event.timestampUs << "," << event.eventType << "," << event.keyOrButton
                         << "," << event.mouseX << "," << event.mouseY << "\n";
         }
         outputFile_.flush();
     }
 
-    spdlog::debug("Flushed {} input events to disk", eventsToWrite.size());
+    spdlog::debug("Flushed {} input events to disk", count);
 }
 
-size_t InputEventLogger::GetEventCount() const {
-    std::lock_guard<std::mutex> lock(const_cast<std::mutex &>(bufferMutex_));
-    return eventBuffer_.size();
+// Called on the hook thread only
+void InputEventLogger::PushEvent(InputEvent &&event) {
+    if (!events_.try_push(std::move(event))) {
+        droppedEvents_++;
+    }
 }
 
+size_t InputEventLogger::GetEventCount() const { return events_.size(); }
+
 // Keyboard hook callback
 LRESULT CALLBACK InputEventLogger::KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
     if (nCode >= 0 && instance_ && instance_->isLogging_) {
@@ -224,16 +239,7 @@ LRESULT CALLBACK InputEventLogger::KeyboardHookProc(int nCode, WPARAM wParam, LP
         }
 
         // Add to buffer
-        {
-            std::lock_guard<std::mutex> lock(instance_->bufferMutex_);
-            instance_->eventBuffer_.push_back(event);
-
-            // If buffer is getting large, warn (writer should flush more frequently)
-            if (instance_->eventBuffer_.size() > instance_->maxBufferSize_) {
-                spdlog::warn("Input event buffer overflow! Size: {}",
-                             instance_->eventBuffer_.size());
-            }
-        }
+        instance_->PushEvent(std::move(event));
     }
 
     return CallNextHookEx(NULL, nCode, wParam, lParam);
@@ -306,15 +312,7 @@ LRESULT CALLBACK InputEventLogger::MouseHookProc(int nCode, WPARAM wParam, LPARA
         }
 
         // Add to buffer
-        {
-            std::lock_guard<std::mutex> lock(instance_->bufferMutex_);
-            instance_->eventBuffer_.push_back(event);
-
-            if (instance_->eventBuffer_.size() > instance_->maxBufferSize_) {
-                spdlog::warn("Input event buffer overflow! Size: {}",
-                             instance_->eventBuffer_.size());
-            }
-        }
+        instance_->PushEvent(std::move(event));
     }
 
     return CallNextHookEx(NULL, nCode, wParam, lParam);
@@ -433,6 +431,13 @@ std::string InputEventLogger::VirtualKeyToString(DWORD vkCode) {
         {VK_END, "END"},
         {VK_PRIOR, "PAGE_UP"},
         {VK_NEXT, "PAGE_DOWN"},
+
+        // Mouse buttons (polled key state only; the mouse hook logs LEFT/RIGHT/MIDDLE)
+        {VK_LBUTTON, "MOUSE_LEFT"},
+        {VK_RBUTTON, "MOUSE_RIGHT"},
+        {VK_MBUTTON, "MOUSE_MIDDLE"},
+        {VK_XBUTTON1, "MOUSE_BUTTON4"},
+        {VK_XBUTTON2, "MOUSE_BUTTON5"},
     };
 
     auto it = vkMap.find(vkCode);
@@ -1,5 +1,7 @@
 #include "jpeg_encoder.h"
+#include <algorithm>
 #include <spdlog/spdlog.h>
+#include <turbojpeg.h>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -8,96 +10,274 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
-std::vector<uint8_t> JpegEncoder::EncodeBGRA(const uint8_t *pixels, int width, int height,
-                                              int quality) {
-    // Find MJPEG encoder
-    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
-    if (!codec) {
-        spdlog::error("MJPEG codec not found");
-        return {};
+namespace {
+
+int TurboSubsampling(ChromaSubsampling subsampling) {
+    switch (subsampling) {
+    case ChromaSubsampling::S422:
+        return TJSAMP_422;
+    case ChromaSubsampling::S444:
+        return TJSAMP_444;
+    default:
+        return TJSAMP_420;
     }
+}
+
+AVPixelFormat FFmpegPixelFormat(ChromaSubsampling subsampling) {
+    switch (subsampling) {
+    case ChromaSubsampling::S422:
+        return AV_PIX_FMT_YUV422P;
+    case ChromaSubsampling::S444:
+        return AV_PIX_FMT_YUV444P;
+    default:
+        return AV_PIX_FMT_YUV420P;
+    }
+}
+
+} // namespace
+
+std::string JpegOptions::Key() const {
+    std::string key = JpegEncoder::BackendName(backend);
+    key += "/";
+    key += JpegEncoder::SubsamplingName(subsampling);
+    if (fastDct) {
+        key += "/fastdct";
+    }
+    return key;
+}
 
-    AVCodecContext *codecCtx = avcodec_alloc_context3(codec);
-    if (!codecCtx) {
+JpegEncoder::JpegEncoder(const JpegOptions &options)
+    : options_(options), tjHandle_(nullptr), codec_(nullptr), codecCtx_(nullptr),
+      yuvFrame_(nullptr), swsCtx_(nullptr), packet_(nullptr), width_(0), height_(0) {}
+
+JpegEncoder::~JpegEncoder() {
+    Close();
+    if (tjHandle_) {
+        tjDestroy(tjHandle_);
+        tjHandle_ = nullptr;
+    }
+}
+
+bool JpegEncoder::ParseBackend(const std::string &name, JpegBackend &backend) {
+    if (name.empty() || name == "turbojpeg") {
+        backend = JpegBackend::TurboJpeg;
+    } else if (name == "ffmpeg") {
+        backend = JpegBackend::FFmpeg;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool JpegEncoder::ParseSubsampling(const std::string &name, ChromaSubsampling &subsampling) {
+    if (name.empty() || name == "420") {
+        subsampling = ChromaSubsampling::S420;
+    } else if (name == "422") {
+        subsampling = ChromaSubsampling::S422;
+    } else if (name == "444") {
+        subsampling = ChromaSubsampling::S444;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *JpegEncoder::BackendName(JpegBackend backend) {
+    return backend == JpegBackend::FFmpeg ? "ffmpeg" : "turbojpeg";
+}
+
+const char *JpegEncoder::SubsamplingName(ChromaSubsampling subsampling) {
+    switch (subsampling) {
+    case ChromaSubsampling::S422:
+        return "422";
+    case ChromaSubsampling::S444:
+        return "444";
+    default:
+        return "420";
+    }
+}
+
+bool JpegEncoder::Open(int width, int height) {
+    Close();
+
+    // Find MJPEG encoder (once per instance)
+    if (!codec_) {
+        codec_ = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+        if (!codec_) {
+            spdlog::error("MJPEG codec not found");
+            return false;
+        }
+    }
+
+    codecCtx_ = avcodec_alloc_context3(codec_);
+    if (!codecCtx_) {
         spdlog::error("Failed to allocate codec context");
-        return {};
+        return false;
     }
 
     // Configure JPEG encoder
-    codecCtx->width = width;
-    codecCtx->height = height;
-    codecCtx->pix_fmt = AV_PIX_FMT_YUV420P;
-    codecCtx->color_range = AVCOL_RANGE_JPEG; // Full range for JPEG
-    codecCtx->time_base = AVRational{1, 1};
+    codecCtx_->width = width;
+    codecCtx_->height = height;
+    codecCtx_->pix_fmt = FFmpegPixelFormat(options_.subsampling);
+    codecCtx_->color_range = AVCOL_RANGE_JPEG; // Full range for JPEG
+    codecCtx_->time_base = AVRational{1, 1};
 
-    // Quality: 2-31 (lower = better), convert from 1-100 scale
-    int qscale = 31 - ((quality * 29) / 100);
-    codecCtx->qmin = codecCtx->qmax = qscale;
-    codecCtx->flags |= AV_CODEC_FLAG_QSCALE;
+    // Quality is applied per frame through AVFrame::quality, so open with the full qscale range
+    codecCtx_->qmin = 2;
+    codecCtx_->qmax = 31;
+    codecCtx_->flags |= AV_CODEC_FLAG_QSCALE;
+    if (options_.fastDct) {
+        codecCtx_->dct_algo = FF_DCT_FASTINT;
+    }
 
-    if (avcodec_open2(codecCtx, codec, nullptr) < 0) {
+    if (avcodec_open2(codecCtx_, codec_, nullptr) < 0) {
         spdlog::error("Failed to open MJPEG codec");
-        avcodec_free_context(&codecCtx);
-        return {};
+        Close();
+        return false;
     }
 
     // Allocate frame for YUV data
-    AVFrame *yuvFrame = av_frame_alloc();
-    if (!yuvFrame) {
-        avcodec_free_context(&codecCtx);
-        return {};
+    yuvFrame_ = av_frame_alloc();
+    if (!yuvFrame_) {
+        Close();
+        return false;
     }
 
-    yuvFrame->format = codecCtx->pix_fmt;
-    yuvFrame->width = width;
-    yuvFrame->height = height;
+    yuvFrame_->format = codecCtx_->pix_fmt;
+    yuvFrame_->width = width;
+    yuvFrame_->height = height;
+    yuvFrame_->color_range = AVCOL_RANGE_JPEG; // Full range
 
-    if (av_frame_get_buffer(yuvFrame, 0) < 0) {
-        av_frame_free(&yuvFrame);
-        avcodec_free_context(&codecCtx);
-        return {};
+    if (av_frame_get_buffer(yuvFrame_, 0) < 0) {
+        Close();
+        return false;
     }
 
-    yuvFrame->color_range = AVCOL_RANGE_JPEG; // Full range
+    // BGRA -> YUV converter (same size, so only the colour conversion and chroma decimation run)
+    swsCtx_ = sws_getContext(width, height, AV_PIX_FMT_BGRA, width, height, codecCtx_->pix_fmt,
+                             SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!swsCtx_) {
+        Close();
+        return false;
+    }
 
-    // Convert BGRA to YUV420 (full range for JPEG)
-    SwsContext *swsCtx = sws_getContext(width, height, AV_PIX_FMT_BGRA, width, height,
-                                        AV_PIX_FMT_YUV420P, SWS_BILINEAR, nullptr, nullptr,
-                                        nullptr);
-    if (!swsCtx) {
-        av_frame_free(&yuvFrame);
-        avcodec_free_context(&codecCtx);
-        return {};
+    packet_ = av_packet_alloc();
+    if (!packet_) {
+        Close();
+        return false;
     }
 
-    const uint8_t *srcData[1] = {pixels};
-    int srcLinesize[1] = {width * 4};
-    sws_scale(swsCtx, srcData, srcLinesize, 0, height, yuvFrame->data, yuvFrame->linesize);
-    sws_freeContext(swsCtx);
+    width_ = width;
+    height_ = height;
+    spdlog::debug("JPEG encoder opened: {}x{}", width, height);
+    return true;
+}
+
+void JpegEncoder::Close() {
+    if (swsCtx_) {
+        sws_freeContext(swsCtx_);
+        swsCtx_ = nullptr;
+    }
+    if (packet_) {
+        av_packet_free(&packet_);
+    }
+    if (yuvFrame_) {
+        av_frame_free(&yuvFrame_);
+    }
+    if (codecCtx_) {
+        avcodec_free_context(&codecCtx_);
+    }
+    width_ = 0;
+    height_ = 0;
+}
 
-    // Encode frame
-    AVPacket *pkt = av_packet_alloc();
-    if (!pkt) {
-        av_frame_free(&yuvFrame);
-        avcodec_free_context(&codecCtx);
-        return {};
+bool JpegEncoder::Encode(const uint8_t *pixels, int width, int height, int quality,
+                         std::vector<uint8_t> &out) {
+    if (!pixels || width <= 0 || height <= 0) {
+        return false;
     }
+    quality = std::clamp(quality, 1, 100);
 
-    int ret = avcodec_send_frame(codecCtx, yuvFrame);
-    std::vector<uint8_t> jpegData;
+    if (options_.backend == JpegBackend::TurboJpeg) {
+        return EncodeTurbo(pixels, width, height, quality, out);
+    }
+    return EncodeFFmpeg(pixels, width, height, quality, out);
+}
 
-    if (ret >= 0) {
-        ret = avcodec_receive_packet(codecCtx, pkt);
-        if (ret >= 0) {
-            jpegData.assign(pkt->data, pkt->data + pkt->size);
+bool JpegEncoder::EncodeTurbo(const uint8_t *pixels, int width, int height, int quality,
+                              std::vector<uint8_t> &out) {
+    if (!tjHandle_) {
+        tjHandle_ = tjInitCompress();
+        if (!tjHandle_) {
+            spdlog::error("Failed to initialize TurboJPEG compressor: {}", tjGetErrorStr2(nullptr));
+            return false;
         }
     }
 
-    // Cleanup
-    av_packet_free(&pkt);
-    av_frame_free(&yuvFrame);
-    avcodec_free_context(&codecCtx);
+    int subsampling = TurboSubsampling(options_.subsampling);
+
+    // Compress into a worst-case scratch buffer kept across frames, then copy out only the
+    // encoded bytes so the caller's buffer is not sized (or zero-filled) for the worst case
+    size_t bufSize = tjBufSize(width, height, subsampling);
+    if (turboBuffer_.size() < bufSize) {
+        turboBuffer_.resize(bufSize);
+    }
+    unsigned char *jpegBuf = turboBuffer_.data();
+    unsigned long jpegSize = static_cast<unsigned long>(turboBuffer_.size());
+
+    int flags = TJFLAG_NOREALLOC;
+    if (options_.fastDct) {
+        flags |= TJFLAG_FASTDCT;
+    }
+
+    if (tjCompress2(tjHandle_, pixels, width, width * 4, height, TJPF_BGRA, &jpegBuf, &jpegSize,
+                    subsampling, quality, flags) != 0) {
+        spdlog::error("TurboJPEG compression failed: {}", tjGetErrorStr2(tjHandle_));
+        out.clear();
+        return false;
+    }
 
-    return jpegData;
+    out.assign(jpegBuf, jpegBuf + jpegSize);
+    return true;
 }
 
+bool JpegEncoder::EncodeFFmpeg(const uint8_t *pixels, int width, int height, int quality,
+                               std::vector<uint8_t> &out) {
+    // Rebuild encoder state only when the frame size changes
+    if (!codecCtx_ || width != width_ || height != height_) {
+        if (!Open(width, height)) {
+            return false;
+        }
+    }
+
+    // The encoder may still reference the previous frame's buffers
+    if (av_frame_make_writable(yuvFrame_) < 0) {
+        spdlog::error("Could not make JPEG frame writable");
+        return false;
+    }
+
+    const uint8_t *srcData[1] = {pixels};
+    int srcLinesize[1] = {width * 4};
+    sws_scale(swsCtx_, srcData, srcLinesize, 0, height, yuvFrame_->data, yuvFrame_->linesize);
+
+    // Quality: 2-31 (lower = better), convert from 1-100 scale
+    int qscale = 31 - ((quality * 29) / 100);
+    yuvFrame_->quality = FF_QP2LAMBDA * qscale;
+    yuvFrame_->pts++;
+
+    int ret = avcodec_send_frame(codecCtx_, yuvFrame_);
+    if (ret < 0) {
+        spdlog::error("Failed to send frame to MJPEG encoder");
+        return false;
+    }
+
+    ret = avcodec_receive_packet(codecCtx_, packet_);
+    if (ret < 0) {
+        spdlog::error("Failed to receive packet from MJPEG encoder");
+        return false;
+    }
+
+    out.assign(packet_->data, packet_->data + packet_->size);
+    av_packet_unref(packet_);
+    return true;
+}
@@ -0,0 +1,176 @@
+#include "observation_sampler.h"
+#include <spdlog/spdlog.h>
+
+namespace {
+
+// Samples kept for frames still in the encode pipeline
+constexpr size_t kMaxSamples = 64;
+
+} // namespace
+
+ObservationSampler::ObservationSampler(ProcessMemory *memory,
+                                       const std::vector<ProcessAttribute> &attributes,
+                                       bool keyState)
+    : memory_(memory), attributes_(attributes), keyState_(keyState), keepSamples_(true),
+      shouldStop_(false) {}
+
+ObservationSampler::~ObservationSampler() { Stop(); }
+
+void ObservationSampler::Start() {
+    if (attributes_.empty() || samplerThread_.joinable()) {
+        return; // Key-state-only samples are completed in OnCapture
+    }
+    shouldStop_ = false;
+    samplerThread_ = std::thread(&ObservationSampler::SamplerThread, this);
+}
+
+void ObservationSampler::Stop() {
+    shouldStop_ = true;
+    captureCv_.notify_all();
+    sampleCv_.notify_all();
+    if (samplerThread_.joinable()) {
+        samplerThread_.join();
+    }
+}
+
+int64_t ObservationSampler::NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+void ObservationSampler::ReadKeyState(KeyStateBitmap &keyState) {
+    keyState.fill(0);
+    for (int vk = 1; vk < 256; ++vk) {
+        if (GetAsyncKeyState(vk) & 0x8000) {
+            keyState[vk >> 3] |= static_cast<uint8_t>(1u << (vk & 7));
+        }
+    }
+}
+
+void ObservationSampler::SetSampleCallback(
+    std::function<void(const ObservationSample &)> callback, bool keepSamples) {
+    sampleCallback_ = std::move(callback);
+    keepSamples_ = keepSamples;
+}
+
+void ObservationSampler::OnCapture(const CapturedFrame &frame) {
+    PendingCapture capture;
+    capture.captureTimestampUs = frame.timestampUs;
+    if (keyState_) {
+        ReadKeyState(capture.keyState);
+        capture.keyStateTimestampUs = NowUs();
+    }
+
+    if (attributes_.empty()) {
+        ObservationSample sample;
+        sample.frameNumber = frame.frameNumber;
+        sample.captureTimestampUs = capture.captureTimestampUs;
+        sample.hasKeyState = keyState_;
+        sample.keyState = capture.keyState;
+        sample.keyStateTimestampUs = capture.keyStateTimestampUs;
+        CompleteSample(std::move(sample));
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_[frame.frameNumber] = capture;
+    captureCv_.notify_one();
+}
+
+void ObservationSampler::CompleteSample(ObservationSample &&sample) {
+    if (sampleCallback_) {
+        sampleCallback_(sample);
+    }
+    if (!keepSamples_) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int32_t frameNumber = sample.frameNumber;
+    samples_[frameNumber] = std::move(sample);
+    while (samples_.size() > kMaxSamples) {
+        samples_.erase(samples_.begin());
+    }
+    sampleCv_.notify_all();
+}
+
+void ObservationSampler::SamplerThread() {
+    while (true) {
+        std::map<int32_t, PendingCapture> captures;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            captureCv_.wait(lock, [this] { return !pending_.empty() || shouldStop_; });
+            if (pending_.empty()) {
+                break; // Stopping; captures already queued still get their sample
+            }
+            captures.swap(pending_);
+        }
+
+        // One read serves every frame captured since the last one
+        ObservationSample attributes;
+        ReadAttributes(attributes);
+
+        for (const auto &[frameNumber, capture] : captures) {
+            ObservationSample sample = attributes;
+            sample.frameNumber = frameNumber;
+            sample.captureTimestampUs = capture.captureTimestampUs;
+            sample.hasKeyState = keyState_;
+            sample.keyState = capture.keyState;
+            sample.keyStateTimestampUs = capture.keyStateTimestampUs;
+            CompleteSample(std::move(sample));
+        }
+    }
+}
+
+void ObservationSampler::ReadAttributes(ObservationSample &sample) {
+    sample.attributesTimestampUs = NowUs();
+    sample.attributes.clear();
+    sample.attributes.reserve(attributes_.size());
+
+    for (const ProcessAttribute &attribute : attributes_) {
+        AttributeValue value;
+        value.name = attribute.AttributeName;
+        value.type = attribute.AttributeType;
+
+        try {
+            if (attribute.AttributeType == "int") {
+                value.valid = memory_->ExtractAttributeInt(attribute.AttributeName, value.intValue);
+            } else if (attribute.AttributeType == "float") {
+                value.valid =
+                    memory_->ExtractAttributeFloat(attribute.AttributeName, value.floatValue);
+            } else if (attribute.AttributeType == "array") {
+                value.arrayValue.resize(attribute.AttributeLength);
+                value.valid =
+                    memory_->ExtractAttributeArray(attribute.AttributeName, value.arrayValue);
+            } else if (attribute.AttributeType == "bool") {
+                std::vector<uint8_t> byte(1);
+                value.valid = memory_->ExtractAttributeArray(attribute.AttributeName, byte);
+                value.boolValue = byte[0] != 0;
+            }
+        } catch (const std::exception &e) {
+            spdlog::error("Failed to sample {}: {}", attribute.AttributeName, e.what());
+            value.valid = false;
+        }
+
+        sample.attributes.push_back(std::move(value));
+    }
+}
+
+bool ObservationSampler::WaitForSample(int32_t frameNumber, ObservationSample &out,
+                                       std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!sampleCv_.wait_for(lock, timeout, [&] {
+            return samples_.count(frameNumber) != 0 || shouldStop_;
+        })) {
+        return false;
+    }
+
+    auto it = samples_.find(frameNumber);
+    if (it == samples_.end()) {
+        return false;
+    }
+    out = std::move(it->second);
+    samples_.erase(samples_.begin(), std::next(it));
+    return true;
+}
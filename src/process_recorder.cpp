@@ -1,5 +1,7 @@
 #include "process_recorder.h"
+#include "segment_stitcher.h"
 #include <chrono>
+#include <cmath>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
@@ -9,11 +11,39 @@
 
 namespace fs = std::filesystem;
 
+namespace {
+
+// Captures waiting for the recording loop. The newest ones are kept, so a loop that stalled
+// resumes at recent frames.
+constexpr size_t kFrameMailboxSize = 2;
+
+// memory_data holds float32: NaN for failed reads and array attributes
+float H5AttributeValue(const AttributeValue &value) {
+    if (!value.valid) {
+        return std::nanf("");
+    }
+    if (value.type == "int") {
+        return static_cast<float>(value.intValue);
+    }
+    if (value.type == "float") {
+        return value.floatValue;
+    }
+    if (value.type == "bool") {
+        return value.boolValue ? 1.0f : 0.0f;
+    }
+    return std::nanf("");
+}
+
+} // namespace
+
 ProcessRecorder::ProcessRecorder(ProcessCapture *capture, ProcessMemory *memory,
                                  ProcessInput *input, FrameBroadcaster *frameBroadcaster)
     : capture_(capture), memory_(memory), input_(input), frameBroadcaster_(frameBroadcaster),
       isRecording_(false), shouldStop_(false), currentFrame_(0), droppedFrames_(0),
-      currentLatencyMs_(0.0), maxDurationSeconds_(0), frameSubscriptionId_(0), hasNewFrame_(false) {
+      currentLatencyMs_(0.0), missedFrames_(0), lastFrameNumber_(-1), maxDurationSeconds_(0),
+      attributeSampling_(AttributeSampling::PerFrame), attributeSampleHz_(60.0),
+      skippedSamples_(0), sink_(RecordingSink::Video), exportMemoryCsv_(true),
+      frameSubscriptionId_(0), frameMailbox_(kFrameMailboxSize) {
 
     // Initialize stats
     stats_.totalFrames = 0;
@@ -25,12 +55,14 @@ ProcessRecorder::ProcessRecorder(ProcessCapture *capture, ProcessMemory *memory,
     stats_.endTimeMs = 0;
     stats_.actualDurationSeconds = 0.0;
     stats_.actualFps = 0.0;
+    stats_.encoderDroppedFrames = 0;
+    stats_.missedFrames = 0;
 
     // Create input event logger
     inputLogger_ = std::make_unique<InputEventLogger>();
 
     // Create video encoder
-    videoEncoder_ = std::make_unique<VideoEncoder>();
+    videoEncoder_ = std::make_unique<SegmentedVideoEncoder>();
 }
 
 ProcessRecorder::~ProcessRecorder() {
@@ -39,6 +71,9 @@ ProcessRecorder::~ProcessRecorder() {
         if (recordingThread_.joinable()) {
             recordingThread_.join();
         }
+        if (memoryThread_.joinable()) {
+            memoryThread_.join();
+        }
     }
 
     // Unsubscribe from frame broadcaster
@@ -46,6 +81,9 @@ ProcessRecorder::~ProcessRecorder() {
         frameBroadcaster_->Unsubscribe(frameSubscriptionId_);
     }
 
+    // The sampler writes memory rows from its own thread
+    attributeSampler_.reset();
+
     // Stop input logger if running
     if (inputLogger_ && inputLogger_->IsLogging()) {
         inputLogger_->StopLogging();
@@ -55,10 +93,13 @@ ProcessRecorder::~ProcessRecorder() {
     if (videoEncoder_) {
         videoEncoder_->Finalize();
     }
+    if (h5Writer_) {
+        h5Writer_->Finalize();
+    }
 
-    // Close memory file if open
-    if (memoryFile_.is_open()) {
-        memoryFile_.close();
+    // Close memory table if open
+    if (memoryTable_) {
+        memoryTable_->Close();
     }
 }
 
@@ -105,7 +146,8 @@ bool ProcessRecorder::CreateOutputDirectories() {
 }
 
 bool ProcessRecorder::StartRecording(const std::vector<std::string> &attributeNames,
-                                     const std::string &outputDirectory, int maxDurationSeconds) {
+                                     const std::string &outputDirectory, int maxDurationSeconds,
+                                     const RecordingOptions &options) {
     if (isRecording_) {
         spdlog::warn("Recording already in progress");
         return false;
@@ -116,6 +158,13 @@ bool ProcessRecorder::StartRecording(const std::vector<std::string> &attributeNa
         return false;
     }
 
+    // HDF5 rows pair each frame with the sample taken at its capture
+    if (options.sink == RecordingSink::Hdf5 &&
+        options.attributeSampling != AttributeSampling::PerFrame) {
+        spdlog::error("HDF5 recordings require per-frame attribute sampling");
+        return false;
+    }
+
     // Store configuration
     attributeNames_ = attributeNames;
     outputDirectory_ = outputDirectory;
@@ -131,12 +180,16 @@ bool ProcessRecorder::StartRecording(const std::vector<std::string> &attributeNa
     currentFrame_ = 0;
     droppedFrames_ = 0;
     currentLatencyMs_ = 0.0;
+    missedFrames_ = 0;
+    lastFrameNumber_ = -1;
+    skippedSamples_ = 0;
 
     stats_.totalFrames = 0;
     stats_.droppedFrames = 0;
     stats_.averageLatencyMs = 0.0;
     stats_.maxLatencyMs = 0.0;
     stats_.minLatencyMs = 999999.0;
+    stats_.stitchError.clear();
     stats_.startTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
                              std::chrono::system_clock::now().time_since_epoch())
                              .count();
@@ -145,35 +198,82 @@ bool ProcessRecorder::StartRecording(const std::vector<std::string> &attributeNa
     if (videoEncoder_) {
         videoEncoder_.reset();
     }
-    videoEncoder_ = std::make_unique<VideoEncoder>();
-
-    // Initialize video encoder using capture dimensions
-    try {
-        std::string videoPath = (fs::path(outputDirectory_) / sessionId_ / "video.mp4").string();
-        int width = capture_->processWindowWidth;
-        int height = capture_->processWindowHeight;
+    h5Writer_.reset();
+    sink_ = options.sink;
+    if (sink_ == RecordingSink::Video) {
+        videoEncoder_ = std::make_unique<SegmentedVideoEncoder>();
+    }
 
-        if (!videoEncoder_->Initialize(videoPath, width, height, 60)) {
-            spdlog::error("Failed to initialize video encoder");
+    // Dropped frame sidecar, opened before the encoder can report drops
+    std::string droppedPath =
+        (fs::path(outputDirectory_) / sessionId_ / "dropped_frames.csv").string();
+    droppedFile_.open(droppedPath, std::ios::out | std::ios::trunc);
+    if (!droppedFile_.is_open()) {
+        spdlog::error("Failed to open dropped frames file: {}", droppedPath);
+        return false;
+    }
+    WriteDroppedHeader();
+
+    if (sink_ == RecordingSink::Hdf5) {
+        std::string h5Path = (fs::path(outputDirectory_) / sessionId_ / "recording.h5").string();
+        H5WriterOptions h5Options = options.hdf5;
+        h5Options.keyName = [](int vk) {
+            return InputEventLogger::VirtualKeyToString(static_cast<DWORD>(vk));
+        };
+        try {
+            h5Writer_ = std::make_unique<H5RecordingWriter>(
+                h5Path, capture_->processWindowWidth, capture_->processWindowHeight,
+                attributeNames_, h5Options);
+        } catch (const H5::Exception &e) {
+            spdlog::error("Failed to initialize HDF5 writer: {}", e.getCDetailMsg());
+            AbortStart();
             return false;
         }
-        spdlog::info("Initialized video encoder (H.264 CRF-20): {}", videoPath);
-    } catch (const std::exception &e) {
-        spdlog::error("Failed to initialize video encoder: {}", e.what());
+        spdlog::info("Initialized HDF5 writer: {}", h5Path);
+    }
+
+    if (sink_ == RecordingSink::Video && !StartVideoEncoder(options)) {
+        AbortStart();
         return false;
     }
 
-    // Initialize memory data CSV file
-    if (!attributeNames_.empty()) {
-        std::string memoryPath =
-            (fs::path(outputDirectory_) / sessionId_ / "memory_data.csv").string();
-        memoryFile_.open(memoryPath, std::ios::out | std::ios::trunc);
-        if (!memoryFile_.is_open()) {
-            spdlog::error("Failed to open memory data file: {}", memoryPath);
-            return false;
+    // Attribute sampler: per-frame mode is fed by the recording subscription
+    attributeSampler_.reset();
+    memoryTable_.reset();
+    attributeSampling_ = options.attributeSampling;
+    attributeSampleHz_ = options.attributeSampleHz > 0.0 ? options.attributeSampleHz : 60.0;
+    exportMemoryCsv_ = options.exportMemoryCsv;
+    if (!attributeNames_.empty() || sink_ == RecordingSink::Hdf5) {
+        std::vector<ProcessAttribute> attributes;
+        for (const auto &attrName : attributeNames_) {
+            attributes.push_back(memory_->GetAttribute(attrName));
+            attributes.back().AttributeName = attrName;
+        }
+
+        // Typed memory data table; the CSV is exported from it when recording stops
+        if (!attributes.empty()) {
+            std::string memoryPath =
+                (fs::path(outputDirectory_) / sessionId_ / "memory_data.arrow").string();
+            memoryTable_ = std::make_unique<AttributeTableWriter>();
+            if (!memoryTable_->Open(memoryPath, attributes)) {
+                spdlog::error("Failed to open memory data table: {}", memoryPath);
+                AbortStart();
+                return false;
+            }
+            spdlog::info("Initialized memory data table: {}", memoryPath);
+        }
+
+        // HDF5 frames also take the key state and keep samples for the recording loop
+        const bool hdf5 = sink_ == RecordingSink::Hdf5;
+        attributeSampler_ = std::make_unique<ObservationSampler>(memory_, attributes, hdf5);
+        if (attributeSampling_ == AttributeSampling::PerFrame) {
+            attributeSampler_->SetSampleCallback(
+                [this](const ObservationSample &sample) {
+                    WriteMemorySample(sample, sample.frameNumber, sample.captureTimestampUs);
+                },
+                hdf5);
+            attributeSampler_->Start();
         }
-        WriteMemoryHeader();
-        spdlog::info("Initialized memory data CSV: {}", memoryPath);
     }
 
     // Initialize performance data CSV file
@@ -181,6 +281,7 @@ bool ProcessRecorder::StartRecording(const std::vector<std::string> &attributeNa
     perfFile_.open(perfPath, std::ios::out | std::ios::trunc);
     if (!perfFile_.is_open()) {
         spdlog::error("Failed to open perf data file: {}", perfPath);
+        AbortStart();
         return false;
     }
     WritePerfHeader();
@@ -199,6 +300,7 @@ bool ProcessRecorder::StartRecording(const std::vector<std::string> &attributeNa
     std::string inputLogPath = (fs::path(outputDirectory_) / sessionId_ / "inputs.csv").string();
     if (!inputLogger_->StartLogging(inputLogPath)) {
         spdlog::error("Failed to start input event logger");
+        AbortStart();
         return false;
     }
 
@@ -215,14 +317,89 @@ bool ProcessRecorder::StartRecording(const std::vector<std::string> &attributeNa
 
     recordingThread_ = std::thread(&ProcessRecorder::RecordingLoop, this);
 
-    // Start memory reading thread (runs independently)
-    if (!attributeNames_.empty()) {
+    // Interval sampling runs on its own thread, independent of capture
+    if (attributeSampler_ && attributeSampling_ == AttributeSampling::Interval) {
         memoryThread_ = std::thread(&ProcessRecorder::MemoryReadingLoop, this);
     }
 
     spdlog::info("Recording started - Session ID: {}", sessionId_);
     spdlog::info("Output directory: {}", outputDirectory_);
-    spdlog::info("Attributes to record: {}", attributeNames_.size());
+    if (attributeSampling_ == AttributeSampling::PerFrame) {
+        spdlog::info("Attributes to record: {} (sampled per frame)", attributeNames_.size());
+    } else {
+        spdlog::info("Attributes to record: {} (sampled at {:.1f} Hz)", attributeNames_.size(),
+                     attributeSampleHz_);
+    }
+
+    return true;
+}
+
+// Undo a partially started recording. Streams left open would make the next session's open()
+// fail while is_open() still reports true.
+void ProcessRecorder::AbortStart() {
+    if (inputLogger_ && inputLogger_->IsLogging()) {
+        inputLogger_->StopLogging();
+    }
+    if (attributeSampler_) {
+        attributeSampler_->Stop();
+        attributeSampler_.reset();
+    }
+    memoryTable_.reset();
+    h5Writer_.reset();
+
+    // The encoder reports encode times and drops until it is finalized
+    if (videoEncoder_) {
+        videoEncoder_->Finalize();
+    }
+    if (encodeFile_.is_open()) {
+        encodeFile_.close();
+    }
+    if (perfFile_.is_open()) {
+        perfFile_.close();
+    }
+    if (droppedFile_.is_open()) {
+        droppedFile_.close();
+    }
+}
+
+bool ProcessRecorder::StartVideoEncoder(const RecordingOptions &options) {
+    std::string encodePath =
+        (fs::path(outputDirectory_) / sessionId_ / "encode_times.csv").string();
+    encodeFile_.open(encodePath, std::ios::out | std::ios::trunc);
+    if (!encodeFile_.is_open()) {
+        spdlog::error("Failed to open encode times file: {}", encodePath);
+        return false;
+    }
+    encodeFile_ << "frame_number,timestamp_us,encode_ms\n";
+
+    // Initialize video encoder using capture dimensions
+    try {
+        videoPath_ = (fs::path(outputDirectory_) / sessionId_ /
+                      ("video" + VideoEncoderConfig::FileExtension(options.encoder.codec)))
+                         .string();
+        int width = capture_->processWindowWidth;
+        int height = capture_->processWindowHeight;
+
+        EncoderQueueOptions queueOptions;
+        queueOptions.maxQueueFrames = options.encoderQueueFrames;
+        queueOptions.policy = options.queueFullPolicy;
+        queueOptions.onDrop = [this](const EncoderFrame &frame, const char *reason) {
+            WriteDroppedFrame(frame.frameNumber, frame.timestampUs, reason);
+        };
+        queueOptions.onEncoded = [this](const EncoderFrame &frame, double encodeMs) {
+            WriteEncodeTime(frame, encodeMs);
+        };
+
+        if (!videoEncoder_->Initialize(videoPath_, width, height, 60, options.encoder,
+                                       queueOptions, options.segments)) {
+            spdlog::error("Failed to initialize video encoder");
+            return false;
+        }
+        spdlog::info("Initialized video encoder ({}): {}", options.encoder.codec, videoPath_);
+    } catch (const std::exception &e) {
+        spdlog::error("Failed to initialize video encoder: {}", e.what());
+        return false;
+    }
 
     return true;
 }
@@ -244,6 +421,16 @@ bool ProcessRecorder::StopRecording(RecordingStats &stats) {
         memoryThread_.join();
     }
 
+    // Writes the rows of frames captured before the unsubscribe
+    if (attributeSampler_) {
+        attributeSampler_->Stop();
+        attributeSampler_.reset();
+    }
+    if (skippedSamples_ > 0) {
+        spdlog::warn("{} attribute samples skipped because reads overran the {:.1f} Hz interval",
+                     skippedSamples_.load(), attributeSampleHz_);
+    }
+
     isRecording_ = false;
 
     // Stop input logger
@@ -256,11 +443,45 @@ bool ProcessRecorder::StopRecording(RecordingStats &stats) {
         spdlog::info("Finalizing video encoder - queue size: {}", videoEncoder_->GetQueueSize());
         videoEncoder_->Finalize();
         spdlog::info("Video finalized - frames encoded: {}", videoEncoder_->GetFramesEncoded());
+
+        // The segments are only removed once the stitched copy exists; otherwise they stay for
+        // DownloadRecording to send instead
+        if (videoEncoder_->IsSegmented()) {
+            const std::string playlistPath = videoEncoder_->GetPlaylistPath();
+            std::string error;
+            if (SegmentStitcher::Stitch(playlistPath, videoPath_, error)) {
+                std::error_code ec;
+                fs::remove_all(fs::path(playlistPath).parent_path() / "segments", ec);
+                if (!ec) {
+                    fs::remove(playlistPath, ec);
+                }
+                if (ec) {
+                    spdlog::warn("Failed to remove stitched segments: {}", ec.message());
+                }
+            } else {
+                spdlog::error("Failed to stitch segments: {} (segments are kept in {})", error,
+                              playlistPath);
+                stats_.stitchError = error;
+                std::error_code ec;
+                fs::remove(videoPath_, ec); // Partial output; the segments are the recording
+            }
+        }
+    }
+    if (h5Writer_) {
+        spdlog::info("Finalizing HDF5 writer - queue size: {}", h5Writer_->GetQueueSize());
+        h5Writer_->Finalize();
+        spdlog::info("HDF5 finalized - frames written: {}", h5Writer_->GetFramesWritten());
     }
 
-    // Close memory file
-    if (memoryFile_.is_open()) {
-        memoryFile_.close();
+    // Close memory table (the sampler has stopped writing to it)
+    if (memoryTable_) {
+        memoryTable_->Close();
+        if (exportMemoryCsv_) {
+            std::string csvPath =
+                (fs::path(outputDirectory_) / sessionId_ / "memory_data.csv").string();
+            memoryTable_->ExportCsv(csvPath);
+        }
+        memoryTable_.reset();
     }
 
     // Close perf file
@@ -268,12 +489,25 @@ bool ProcessRecorder::StopRecording(RecordingStats &stats) {
         perfFile_.close();
     }
 
+    // Close dropped frames file
+    if (droppedFile_.is_open()) {
+        std::lock_guard<std::mutex> lock(droppedMutex_);
+        droppedFile_.close();
+    }
+
+    // Encoder thread has stopped, so the encode times file is no longer written
+    if (encodeFile_.is_open()) {
+        encodeFile_.close();
+    }
+
     // Update final statistics
     stats_.endTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
                            std::chrono::system_clock::now().time_since_epoch())
                            .count();
     stats_.totalFrames = currentFrame_;
     stats_.droppedFrames = droppedFrames_;
+    stats_.encoderDroppedFrames = videoEncoder_ ? videoEncoder_->GetFramesDropped() : 0;
+    stats_.missedFrames = missedFrames_;
 
     // Calculate actual duration and FPS
     stats_.actualDurationSeconds = (stats_.endTimeMs - stats_.startTimeMs) / 1000.0;
@@ -283,6 +517,11 @@ bool ProcessRecorder::StopRecording(RecordingStats &stats) {
 
     spdlog::info("Recording stopped - Total frames: {}, Dropped: {}, Avg latency: {:.2f}ms",
                  stats.totalFrames, stats.droppedFrames, stats.averageLatencyMs);
+    if (stats.encoderDroppedFrames > 0 || stats.missedFrames > 0) {
+        spdlog::warn("Frames missing from video: {} dropped by the encoder queue, {} missed "
+                     "(see dropped_frames.csv)",
+                     stats.encoderDroppedFrames, stats.missedFrames);
+    }
 
     return true;
 }
@@ -306,38 +545,55 @@ bool ProcessRecorder::GetStatus(bool &isRecording, int &currentFrame, double &el
     return true;
 }
 
-void ProcessRecorder::WriteMemoryHeader() {
-    if (!memoryFile_.is_open())
-        return;
-
-    std::lock_guard<std::mutex> lock(memoryMutex_);
-    memoryFile_ << "timestamp_us";
-    for (const auto &attrName : attributeNames_) {
-        memoryFile_ << "," << attrName;
+bool ProcessRecorder::GetQueueStatus(RecordingQueueStatus &status) {
+    status = RecordingQueueStatus();
+    status.missedFrames = missedFrames_;
+    if (videoEncoder_) {
+        status.queueSize = videoEncoder_->GetQueueSize();
+        status.queueCapacity = videoEncoder_->GetQueueCapacity();
+        status.encoderDroppedFrames = videoEncoder_->GetFramesDropped();
+        status.degradeLevel = videoEncoder_->GetDegradeLevel();
+        status.lastEncodeMs = videoEncoder_->GetLastEncodeMs();
+        status.averageEncodeMs = videoEncoder_->GetAverageEncodeMs();
+        if (videoEncoder_->IsSegmented()) {
+            status.segments = static_cast<int>(videoEncoder_->GetSegments().size());
+            status.openSegments = videoEncoder_->GetOpenSegments();
+        }
+    } else if (h5Writer_) {
+        status.queueSize = h5Writer_->GetQueueSize();
+        status.queueCapacity = h5Writer_->GetQueueCapacity();
     }
-    memoryFile_ << "\n";
-    memoryFile_.flush();
+    return true;
 }
 
-void ProcessRecorder::WriteMemoryFrame(const MemoryFrameData &data) {
-    if (!memoryFile_.is_open())
-        return;
+bool ProcessRecorder::ParseAttributeSampling(const std::string &name,
+                                             AttributeSampling &sampling) {
+    if (name.empty() || name == "frame") {
+        sampling = AttributeSampling::PerFrame;
+    } else if (name == "interval") {
+        sampling = AttributeSampling::Interval;
+    } else {
+        return false;
+    }
+    return true;
+}
 
-    std::lock_guard<std::mutex> lock(memoryMutex_);
-    memoryFile_ << data.timestampUs;
-    for (const auto &attrName : attributeNames_) {
-        auto it = data.memoryData.find(attrName);
-        if (it != data.memoryData.end()) {
-            memoryFile_ << "," << it->second;
-        } else {
-            memoryFile_ << ",0";
-        }
+bool ProcessRecorder::ParseRecordingSink(const std::string &name, RecordingSink &sink) {
+    if (name.empty() || name == "video") {
+        sink = RecordingSink::Video;
+    } else if (name == "hdf5") {
+        sink = RecordingSink::Hdf5;
+    } else {
+        return false;
     }
-    memoryFile_ << "\n";
+    return true;
+}
 
-    // Flush every 60 frames
-    if (currentFrame_ % 60 == 0) {
-        memoryFile_.flush();
+void ProcessRecorder::WriteMemorySample(const ObservationSample &sample, int32_t frameNumber,
+                                        int64_t timestampUs) {
+    std::lock_guard<std::mutex> lock(memoryMutex_);
+    if (memoryTable_) {
+        memoryTable_->Append(sample, frameNumber, timestampUs);
     }
 }
 
@@ -365,6 +621,43 @@ void ProcessRecorder::WritePerfData(int frame, int64_t timestampUs, double total
     }
 }
 
+void ProcessRecorder::WriteDroppedHeader() {
+    if (!droppedFile_.is_open())
+        return;
+
+    std::lock_guard<std::mutex> lock(droppedMutex_);
+    droppedFile_ << "frame_number,timestamp_us,reason\n";
+    droppedFile_.flush();
+}
+
+// timestampUs < 0 = unknown (frames the recording loop never received)
+void ProcessRecorder::WriteDroppedFrame(int32_t frameNumber, int64_t timestampUs,
+                                        const char *reason) {
+    if (!droppedFile_.is_open())
+        return;
+
+    std::lock_guard<std::mutex> lock(droppedMutex_);
+    droppedFile_ << frameNumber << ",";
+    if (timestampUs >= 0) {
+        droppedFile_ << timestampUs;
+    }
+    droppedFile_ << "," << reason << "\n";
+    droppedFile_.flush();
+}
+
+// Encoder thread only
+void ProcessRecorder::WriteEncodeTime(const EncoderFrame &frame, double encodeMs) {
+    if (!encodeFile_.is_open())
+        return;
+
+    encodeFile_ << frame.frameNumber << "," << frame.timestampUs << "," << encodeMs << "\n";
+
+    // Flush every 60 frames
+    if (frame.frameNumber % 60 == 0) {
+        encodeFile_.flush();
+    }
+}
+
 void ProcessRecorder::RecordingLoop() {
     spdlog::info("Recording loop started - receiving frames from FrameBroadcaster (~15fps)");
 
@@ -375,11 +668,23 @@ void ProcessRecorder::RecordingLoop() {
     }
 
     auto frameCallback = [this](const CapturedFrame &frame) {
-        std::lock_guard<std::mutex> lock(frameMutex_);
-        latestFrame_ = frame;
-        hasNewFrame_ = true;
+        if (attributeSampler_ && attributeSampling_ == AttributeSampling::PerFrame) {
+            attributeSampler_->OnCapture(frame);
+        }
+        // Latest wins: evict the oldest capture when full (it becomes not_collected). The copy
+        // is only moved from once it is queued.
+        CapturedFrame copy(frame);
+        while (!frameMailbox_.try_push(std::move(copy))) {
+            CapturedFrame oldest;
+            frameMailbox_.try_pop(oldest);
+        }
     };
 
+    // Frames left over from the previous recording
+    CapturedFrame stale;
+    while (frameMailbox_.try_pop(stale)) {
+    }
+
     frameSubscriptionId_ = frameBroadcaster_->Subscribe(frameCallback);
     spdlog::info("Subscribed to FrameBroadcaster with ID: {}", frameSubscriptionId_);
 
@@ -406,26 +711,35 @@ void ProcessRecorder::RecordingLoop() {
         }
 
         // Wait for new frame from broadcaster
-        if (!hasNewFrame_) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        CapturedFrame frame;
+        if (!frameMailbox_.pop_for(frame, std::chrono::milliseconds(5))) {
             continue;
         }
 
-        // Get frame data
-        frameMutex_.lock();
-        CapturedFrame frame = latestFrame_;
-        hasNewFrame_ = false;
-        frameMutex_.unlock();
+        // Captures evicted from the mailbox before this loop picked them up
+        if (lastFrameNumber_ >= 0) {
+            for (int32_t missed = lastFrameNumber_ + 1; missed < frame.frameNumber; ++missed) {
+                WriteDroppedFrame(missed, -1, "not_collected");
+                missedFrames_++;
+            }
+        }
+        lastFrameNumber_ = frame.frameNumber;
 
         auto captureStart = std::chrono::high_resolution_clock::now();
 
-        // Queue frame for video encoding
-        EncoderFrame videoFrame;
-        videoFrame.pixels = std::move(frame.pixels);
-        videoFrame.timestampUs = frame.timestampUs;
-        videoFrame.width = frame.width;
-        videoFrame.height = frame.height;
-        videoEncoder_->EncodeFrame(std::move(videoFrame));
+        if (h5Writer_) {
+            // Bounded; blocks while the HDF5 writer is behind
+            QueueH5Frame(frame);
+        } else {
+            // Queue frame for video encoding (bounded; may drop or block per the queue policy)
+            EncoderFrame videoFrame;
+            videoFrame.pixels = std::move(frame.pixels);
+            videoFrame.timestampUs = frame.timestampUs;
+            videoFrame.width = frame.width;
+            videoFrame.height = frame.height;
+            videoFrame.frameNumber = frame.frameNumber;
+            videoEncoder_->EncodeFrame(std::move(videoFrame));
+        }
 
         auto captureEnd = std::chrono::high_resolution_clock::now();
         double frameCaptureMs =
@@ -463,10 +777,11 @@ void ProcessRecorder::RecordingLoop() {
                 .count() -
             stats_.startTimeMs;
         double actualFps = elapsed > 0 ? (currentFrame_ * 1000.0) / elapsed : 0.0;
-        size_t videoQueueSize = videoEncoder_->GetQueueSize();
+        size_t queueSize =
+            h5Writer_ ? h5Writer_->GetQueueSize() : videoEncoder_->GetQueueSize();
 
         WritePerfData(currentFrame_, frame.timestampUs, totalMs, frameCaptureMs, actualFps,
-                      videoQueueSize, droppedFrames_);
+                      queueSize, droppedFrames_);
     }
 
     // Unsubscribe from frame broadcaster
@@ -478,51 +793,66 @@ void ProcessRecorder::RecordingLoop() {
     spdlog::info("Recording loop stopped");
 }
 
-void ProcessRecorder::MemoryReadingLoop() {
-    spdlog::info("Memory reading thread started");
+// Pairs the frame with the sample taken at its capture and hands it to the HDF5 writer
+void ProcessRecorder::QueueH5Frame(CapturedFrame &frame) {
+    H5FrameData frameData;
+    frameData.frameNumber = frame.frameNumber;
+    frameData.timestampUs = frame.timestampUs;
+    frameData.width = frame.width;
+    frameData.height = frame.height;
+    frameData.pixels = std::move(frame.pixels);
+    frameData.frameCaptureMs = (ObservationSampler::NowUs() - frame.timestampUs) / 1000.0;
+    frameData.memoryReadMs = 0.0;
+    frameData.keyStateMs = 0.0;
+    frameData.keyState.fill(0);
+
+    ObservationSample sample;
+    const auto timeout = std::chrono::milliseconds(100);
+    if (attributeSampler_ && attributeSampler_->WaitForSample(frame.frameNumber, sample, timeout)) {
+        for (const AttributeValue &value : sample.attributes) {
+            frameData.memoryValues.push_back(H5AttributeValue(value));
+        }
+        if (!sample.attributes.empty()) {
+            frameData.memoryReadMs =
+                (sample.attributesTimestampUs - sample.captureTimestampUs) / 1000.0;
+        }
+        frameData.keyState = sample.keyState;
+        frameData.keyStateMs = (sample.keyStateTimestampUs - sample.captureTimestampUs) / 1000.0;
+    } else {
+        frameData.memoryValues.assign(attributeNames_.size(), std::nanf(""));
+    }
 
-    while (!shouldStop_) {
-        auto wallClockTime = std::chrono::high_resolution_clock::now();
-        int64_t timestampUs =
-            std::chrono::duration_cast<std::chrono::microseconds>(wallClockTime.time_since_epoch())
-                .count();
+    h5Writer_->QueueFrame(std::move(frameData));
+}
 
-        // Read memory attributes
-        MemoryFrameData memoryData;
-        memoryData.timestampUs = timestampUs;
+void ProcessRecorder::MemoryReadingLoop() {
+    spdlog::info("Memory reading thread started ({:.1f} Hz)", attributeSampleHz_);
 
-        for (const auto &attrName : attributeNames_) {
-            try {
-                ProcessAttribute attr = memory_->GetAttribute(attrName);
-                std::string value;
-
-                if (attr.AttributeType == "int") {
-                    int32_t intVal = 0;
-                    if (memory_->ExtractAttributeInt(attrName, intVal)) {
-                        value = std::to_string(intVal);
-                    }
-                } else if (attr.AttributeType == "float") {
-                    float floatVal = 0.0f;
-                    if (memory_->ExtractAttributeFloat(attrName, floatVal)) {
-                        value = std::to_string(floatVal);
-                    }
-                } else {
-                    value = "0";
-                }
+    // Absolute deadlines, so read time never pushes later samples back and the rate cannot drift.
+    // A tick missed because a read overran is skipped rather than fired in a burst.
+    const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / attributeSampleHz_));
+    auto nextDue = std::chrono::steady_clock::now();
 
-                memoryData.memoryData[attrName] = value;
-            } catch (const std::exception &e) {
-                memoryData.memoryData[attrName] = "0";
-            }
+    // 1 ms scheduler resolution while sampling; the default 15.6 ms tick cannot hold 60 Hz
+    timeBeginPeriod(1);
+    while (!shouldStop_) {
+        // Rows carry the latest captured frame so they can be matched to the video
+        int32_t latestFrame = frameBroadcaster_ ? frameBroadcaster_->GetCurrentFrame() - 1 : -1;
+        ObservationSample sample;
+        attributeSampler_->ReadAttributes(sample);
+        WriteMemorySample(sample, latestFrame, sample.attributesTimestampUs);
+
+        nextDue += interval;
+        auto behind = std::chrono::steady_clock::now() - nextDue;
+        if (behind >= interval) {
+            auto missed = behind / interval;
+            nextDue += missed * interval;
+            skippedSamples_ += static_cast<int>(missed);
         }
-
-        // Write memory data to CSV
-        WriteMemoryFrame(memoryData);
-
-        // Sleep for a bit to avoid hammering the process memory
-        // Aiming for ~30 Hz memory sampling (independent of video capture)
-        std::this_thread::sleep_for(std::chrono::milliseconds(33));
+        std::this_thread::sleep_until(nextDue);
     }
+    timeEndPeriod(1);
 
     spdlog::info("Memory reading thread stopped");
 }
@@ -0,0 +1,40 @@
+#include "ring_queue.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <algorithm>
+#include <thread>
+#endif
+
+void QueueEvent::Sleep(uint32_t expected, int64_t timeoutUs) {
+#if defined(_WIN32)
+    DWORD timeoutMs = timeoutUs < 0 ? INFINITE : static_cast<DWORD>((timeoutUs + 999) / 1000);
+    WaitOnAddress(&sequence_, &expected, sizeof(expected), timeoutMs);
+#elif defined(__linux__)
+    timespec timeout;
+    timeout.tv_sec = static_cast<time_t>(timeoutUs / 1000000);
+    timeout.tv_nsec = static_cast<long>(timeoutUs % 1000000) * 1000;
+    syscall(SYS_futex, &sequence_, FUTEX_WAIT_PRIVATE, expected,
+            timeoutUs < 0 ? nullptr : &timeout, nullptr, 0);
+#else
+    // No address wait on this platform: poll
+    (void)expected;
+    std::this_thread::sleep_for(std::chrono::microseconds(
+        timeoutUs < 0 ? 100 : std::min<int64_t>(timeoutUs, 100)));
+#endif
+}
+
+void QueueEvent::Wake() {
+#if defined(_WIN32)
+    WakeByAddressAll(&sequence_);
+#elif defined(__linux__)
+    syscall(SYS_futex, &sequence_, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
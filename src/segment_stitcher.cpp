@@ -0,0 +1,208 @@
+#include "segment_stitcher.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr AVRational kMicroseconds = {1, 1000000};
+
+std::string AvError(int code) {
+    char errbuf[AV_ERROR_MAX_STRING_SIZE];
+    av_strerror(code, errbuf, sizeof(errbuf));
+    return errbuf;
+}
+
+// Strip ffconcat quoting: 'file name' -> file name
+std::string Unquote(std::string value) {
+    if (value.size() >= 2 && value.front() == '\'' && value.back() == '\'') {
+        value = value.substr(1, value.size() - 2);
+    }
+    return value;
+}
+
+} // namespace
+
+bool SegmentStitcher::ReadPlaylist(const std::string &playlistPath, std::vector<Entry> &entries,
+                                   std::string &error) {
+    std::ifstream playlist(playlistPath);
+    if (!playlist.is_open()) {
+        error = "Cannot open playlist " + playlistPath;
+        return false;
+    }
+
+    entries.clear();
+    std::string line;
+    while (std::getline(playlist, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        const size_t space = line.find(' ');
+        const std::string directive = line.substr(0, space);
+        const std::string value = space == std::string::npos ? "" : line.substr(space + 1);
+        if (directive == "file") {
+            entries.push_back({Unquote(value), -1});
+        } else if (directive == "duration") {
+            if (entries.empty()) {
+                error = "duration before the first file in " + playlistPath;
+                return false;
+            }
+            entries.back().durationUs = static_cast<int64_t>(std::stod(value) * 1e6);
+        }
+    }
+    if (entries.empty()) {
+        error = "No segments listed in " + playlistPath;
+        return false;
+    }
+    return true;
+}
+
+bool SegmentStitcher::Stitch(const std::string &playlistPath, const std::string &outputPath,
+                             std::string &error) {
+    std::vector<Entry> entries;
+    if (!ReadPlaylist(playlistPath, entries, error)) {
+        return false;
+    }
+    const fs::path baseDirectory = fs::path(playlistPath).parent_path();
+
+    AVFormatContext *output = nullptr;
+    AVFormatContext *input = nullptr;
+    AVPacket *packet = av_packet_alloc();
+    AVStream *outStream = nullptr;
+    int64_t plannedOffset = 0;        // Output time base
+    int64_t lastDts = AV_NOPTS_VALUE; // Last written DTS, output time base
+    int packetsWritten = 0;
+    bool ok = false;
+
+    auto cleanup = [&] {
+        if (input) {
+            avformat_close_input(&input);
+        }
+        if (output) {
+            if (output->pb && !(output->oformat->flags & AVFMT_NOFILE)) {
+                avio_closep(&output->pb);
+            }
+            avformat_free_context(output);
+        }
+        av_packet_free(&packet);
+    };
+
+    int ret = avformat_alloc_output_context2(&output, nullptr, nullptr, outputPath.c_str());
+    if (ret < 0 || !output) {
+        error = "Cannot create output " + outputPath + ": " + AvError(ret);
+        cleanup();
+        return false;
+    }
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        fs::path file = entries[i].file;
+        if (file.is_relative()) {
+            file = baseDirectory / file;
+        }
+        ret = avformat_open_input(&input, file.string().c_str(), nullptr, nullptr);
+        if (ret < 0 || (ret = avformat_find_stream_info(input, nullptr)) < 0) {
+            error = "Cannot read " + file.string() + ": " + AvError(ret);
+            cleanup();
+            return false;
+        }
+        const int streamIndex = av_find_best_stream(input, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        if (streamIndex < 0) {
+            error = "No video stream in " + file.string();
+            cleanup();
+            return false;
+        }
+        AVStream *inStream = input->streams[streamIndex];
+
+        if (!outStream) {
+            outStream = avformat_new_stream(output, nullptr);
+            if (!outStream ||
+                avcodec_parameters_copy(outStream->codecpar, inStream->codecpar) < 0) {
+                error = "Cannot create output stream";
+                cleanup();
+                return false;
+            }
+            outStream->codecpar->codec_tag = 0;
+            outStream->time_base = inStream->time_base;
+            if (!(output->oformat->flags & AVFMT_NOFILE)) {
+                ret = avio_open(&output->pb, outputPath.c_str(), AVIO_FLAG_WRITE);
+                if (ret < 0) {
+                    error = "Cannot open " + outputPath + ": " + AvError(ret);
+                    cleanup();
+                    return false;
+                }
+            }
+            ret = avformat_write_header(output, nullptr);
+            if (ret < 0) {
+                error = "Cannot write header: " + AvError(ret);
+                cleanup();
+                return false;
+            }
+        } else if (inStream->codecpar->codec_id != outStream->codecpar->codec_id ||
+                   inStream->codecpar->width != outStream->codecpar->width ||
+                   inStream->codecpar->height != outStream->codecpar->height) {
+            error = file.string() + " does not match the first segment's codec or size";
+            cleanup();
+            return false;
+        }
+
+        // Segments restart their timestamps at zero; shift each one to its place in the session
+        int64_t offset = plannedOffset;
+        int64_t segmentEnd = plannedOffset;
+        bool firstPacket = true;
+        while (av_read_frame(input, packet) >= 0) {
+            if (packet->stream_index != streamIndex) {
+                av_packet_unref(packet);
+                continue;
+            }
+            av_packet_rescale_ts(packet, inStream->time_base, outStream->time_base);
+            if (firstPacket && lastDts != AV_NOPTS_VALUE && packet->dts != AV_NOPTS_VALUE) {
+                // B-frame reordering starts DTS below zero; the muxer needs it increasing
+                offset = std::max(offset, lastDts + 1 - packet->dts);
+            }
+            firstPacket = false;
+            if (packet->pts != AV_NOPTS_VALUE) {
+                packet->pts += offset;
+                segmentEnd = std::max(segmentEnd, packet->pts + packet->duration);
+            }
+            if (packet->dts != AV_NOPTS_VALUE) {
+                packet->dts += offset;
+                lastDts = packet->dts;
+            }
+            packet->stream_index = outStream->index;
+            packet->pos = -1;
+            ret = av_interleaved_write_frame(output, packet);
+            if (ret < 0) {
+                error = "Cannot write packet: " + AvError(ret);
+                cleanup();
+                return false;
+            }
+            packetsWritten++;
+        }
+        avformat_close_input(&input);
+
+        plannedOffset =
+            entries[i].durationUs >= 0
+                ? plannedOffset + av_rescale_q(entries[i].durationUs, kMicroseconds,
+                                               outStream->time_base)
+                : segmentEnd;
+    }
+
+    ret = av_write_trailer(output);
+    if (ret < 0) {
+        error = "Cannot write trailer: " + AvError(ret);
+    } else {
+        ok = true;
+        spdlog::info("Stitched {} segments ({} packets) into {}", entries.size(), packetsWritten,
+                     outputPath);
+    }
+    cleanup();
+    return ok;
+}
@@ -0,0 +1,325 @@
+#include "segmented_video_encoder.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <spdlog/spdlog.h>
+
+namespace fs = std::filesystem;
+
+SegmentedVideoEncoder::SegmentedVideoEncoder()
+    : width_(0), height_(0), fps_(60), parallelSegments_(1), segmentDurationUs_(0),
+      current_(nullptr), lastEncodeMs_(0.0), finalized_(true) {}
+
+SegmentedVideoEncoder::~SegmentedVideoEncoder() {
+    if (!finalized_) {
+        Finalize();
+    }
+}
+
+bool SegmentedVideoEncoder::Initialize(const std::string &videoPath, int width, int height,
+                                       int fps, const VideoEncoderConfig &config,
+                                       const EncoderQueueOptions &queueOptions,
+                                       const SegmentOptions &segments) {
+    videoPath_ = videoPath;
+    directory_ = fs::path(videoPath).parent_path().string();
+    width_ = width;
+    height_ = height;
+    fps_ = fps;
+    config_ = config;
+    queueOptions_ = queueOptions;
+    queueOptions_.onEncoded = [this, onEncoded = queueOptions.onEncoded](
+                                  const EncoderFrame &frame, double encodeMs) {
+        lastEncodeMs_ = encodeMs;
+        if (onEncoded) {
+            onEncoded(frame, encodeMs);
+        }
+    };
+
+    segmentDurationUs_ = static_cast<int64_t>(std::max(segments.segmentSeconds, 0.0) * 1e6);
+    parallelSegments_ = IsSegmented() ? std::max<size_t>(segments.parallelSegments, 1) : 1;
+    if (IsSegmented()) {
+        std::error_code ec;
+        fs::create_directories(fs::path(directory_) / "segments", ec);
+        if (ec) {
+            spdlog::error("Failed to create segments directory: {}", ec.message());
+            return false;
+        }
+        playlistPath_ = (fs::path(directory_) / "segments.ffconcat").string();
+        manifestPath_ = (fs::path(directory_) / "segments.csv").string();
+
+        spdlog::info("Segmented recording: {:.1f} s segments, up to {} encoding at once",
+                     segmentDurationUs_ / 1e6, parallelSegments_);
+    }
+    if (queueOptions_.maxQueueFrames == 0) {
+        const size_t defaultFrames = EncoderQueueOptions().maxQueueFrames;
+        queueOptions_.maxQueueFrames =
+            IsSegmented() ? std::max<size_t>(defaultFrames, fps / 2) : defaultFrames;
+    }
+
+    // The first segment is opened now so codec errors surface before recording starts
+    finalized_ = false;
+    OpenSegment();
+    if (!current_->encoder) {
+        Finalize();
+        return false;
+    }
+    return true;
+}
+
+void SegmentedVideoEncoder::OpenSegment() {
+    auto segment = std::make_unique<Segment>();
+    segment->info.index = static_cast<int>(segments_.size());
+    std::string path = videoPath_;
+    if (IsSegmented()) {
+        char name[32];
+        snprintf(name, sizeof(name), "segment_%05d", segment->info.index);
+        segment->info.file =
+            "segments/" + std::string(name) + VideoEncoderConfig::FileExtension(config_.codec);
+        path = (fs::path(directory_) / segment->info.file).string();
+    } else {
+        segment->info.file = fs::path(videoPath_).filename().string();
+    }
+
+    segment->encoder = std::make_unique<VideoEncoder>();
+    if (!segment->encoder->Initialize(path, width_, height_, fps_, config_, queueOptions_)) {
+        // Frames for this segment are reported as dropped until the next one starts
+        spdlog::error("Failed to open video segment {}", path);
+        segment->encoder.reset();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_ = segment.get();
+    segments_.push_back(std::move(segment));
+}
+
+void SegmentedVideoEncoder::EncodeFrame(EncoderFrame frame) {
+    if (finalized_ || !current_) {
+        return;
+    }
+
+    if (current_->info.frames > 0 && IsSegmented() &&
+        frame.timestampUs - current_->info.startUs >= segmentDurationUs_) {
+        CloseSegment(*current_);
+        JoinFinishedSegments(false);
+
+        // Backpressure: wait for the oldest segment to finish rather than exceed the pool
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (CountOpenSegments() >= parallelSegments_) {
+            spdlog::warn("All {} segment encoders busy - waiting before segment {}",
+                         parallelSegments_, segments_.size());
+            segmentDoneCv_.wait(lock, [&] { return CountOpenSegments() < parallelSegments_; });
+        }
+        lock.unlock();
+        OpenSegment();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        SegmentInfo &info = current_->info;
+        if (info.frames == 0) {
+            info.firstFrame = frame.frameNumber;
+            info.startUs = frame.timestampUs;
+        }
+        info.lastFrame = frame.frameNumber;
+        info.endUs = frame.timestampUs;
+        info.frames++;
+        if (!current_->encoder) {
+            info.dropped++;
+        }
+    }
+
+    if (current_->encoder) {
+        current_->encoder->EncodeFrame(std::move(frame));
+    } else if (queueOptions_.onDrop) {
+        queueOptions_.onDrop(frame, "encoder_unavailable");
+    }
+}
+
+void SegmentedVideoEncoder::CloseSegment(Segment &segment) {
+    // Finalize drains the segment's queue, so it keeps encoding while the next one fills
+    segment.finisher = std::thread([this, &segment] {
+        if (segment.encoder) {
+            segment.encoder->Finalize();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (segment.encoder) {
+                segment.info.encoded = segment.encoder->GetFramesEncoded();
+                segment.info.dropped += segment.encoder->GetFramesDropped();
+                segment.encodeMs = segment.encoder->GetAverageEncodeMs() * segment.info.encoded;
+                segment.encoder.reset();
+            }
+            segment.info.complete = true;
+        }
+        segmentDoneCv_.notify_all();
+        WriteManifest();
+    });
+}
+
+void SegmentedVideoEncoder::JoinFinishedSegments(bool all) {
+    std::vector<std::thread *> finished;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &segment : segments_) {
+            if (segment->finisher.joinable() && (all || segment->info.complete)) {
+                finished.push_back(&segment->finisher);
+            }
+        }
+    }
+    for (std::thread *finisher : finished) {
+        finisher->join();
+    }
+}
+
+size_t SegmentedVideoEncoder::CountOpenSegments() const {
+    size_t open = 0;
+    for (const auto &segment : segments_) {
+        if (segment->encoder && !segment->info.complete) {
+            open++;
+        }
+    }
+    return open;
+}
+
+void SegmentedVideoEncoder::Finalize() {
+    if (finalized_) {
+        return;
+    }
+    finalized_ = true;
+
+    if (current_ && !current_->finisher.joinable()) {
+        CloseSegment(*current_);
+    }
+    JoinFinishedSegments(true);
+    WriteManifest();
+
+    if (IsSegmented()) {
+        spdlog::info("Segmented recording finalized - {} segments, {} frames encoded",
+                     segments_.size(), GetFramesEncoded());
+    }
+}
+
+void SegmentedVideoEncoder::WriteManifest() {
+    if (!IsSegmented()) {
+        return;
+    }
+
+    // Rewritten whole after every segment; the rename keeps a complete copy on disk at all times
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::string manifestTemp = manifestPath_ + ".tmp";
+    std::ofstream manifest(manifestTemp, std::ios::out | std::ios::trunc);
+    manifest << "index,file,first_frame,last_frame,start_us,end_us,frames,encoded,dropped,"
+                "complete\n";
+    for (const auto &segment : segments_) {
+        const SegmentInfo &info = segment->info;
+        manifest << info.index << ',' << info.file << ',' << info.firstFrame << ','
+                 << info.lastFrame << ',' << info.startUs << ',' << info.endUs << ','
+                 << info.frames << ',' << info.encoded << ',' << info.dropped << ','
+                 << (info.complete ? 1 : 0) << '\n';
+    }
+    manifest.close();
+
+    // Only finished files are playable. Each entry lasts until the next listed segment starts,
+    // so a lost segment shows up as a freeze instead of shifting the rest of the timeline.
+    const std::string playlistTemp = playlistPath_ + ".tmp";
+    std::ofstream playlist(playlistTemp, std::ios::out | std::ios::trunc);
+    playlist << "ffconcat version 1.0\n" << std::fixed << std::setprecision(6);
+    const SegmentInfo *previous = nullptr;
+    for (const auto &segment : segments_) {
+        const SegmentInfo &info = segment->info;
+        if (!info.complete || info.encoded == 0) {
+            continue;
+        }
+        if (previous) {
+            playlist << "duration " << (info.startUs - previous->startUs) / 1e6 << '\n';
+        }
+        playlist << "file '" << info.file << "'\n";
+        previous = &info;
+    }
+    playlist.close();
+
+    std::error_code ec;
+    fs::rename(manifestTemp, manifestPath_, ec);
+    if (!ec) {
+        fs::rename(playlistTemp, playlistPath_, ec);
+    }
+    if (ec) {
+        spdlog::warn("Failed to update segment manifest: {}", ec.message());
+    }
+}
+
+std::vector<SegmentInfo> SegmentedVideoEncoder::GetSegments() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<SegmentInfo> infos;
+    for (const auto &segment : segments_) {
+        infos.push_back(segment->info);
+    }
+    return infos;
+}
+
+size_t SegmentedVideoEncoder::GetQueueSize() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t queued = 0;
+    for (const auto &segment : segments_) {
+        if (segment->encoder) {
+            queued += segment->encoder->GetQueueSize();
+        }
+    }
+    return queued;
+}
+
+size_t SegmentedVideoEncoder::GetQueueCapacity() const {
+    return queueOptions_.maxQueueFrames * parallelSegments_;
+}
+
+int SegmentedVideoEncoder::GetFramesEncoded() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int encoded = 0;
+    for (const auto &segment : segments_) {
+        encoded += segment->encoder ? segment->encoder->GetFramesEncoded() : segment->info.encoded;
+    }
+    return encoded;
+}
+
+int SegmentedVideoEncoder::GetFramesDropped() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int dropped = 0;
+    for (const auto &segment : segments_) {
+        dropped += segment->info.dropped;
+        if (segment->encoder) {
+            dropped += segment->encoder->GetFramesDropped();
+        }
+    }
+    return dropped;
+}
+
+int SegmentedVideoEncoder::GetDegradeLevel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return current_ && current_->encoder ? current_->encoder->GetDegradeLevel() : 0;
+}
+
+double SegmentedVideoEncoder::GetLastEncodeMs() { return lastEncodeMs_; }
+
+double SegmentedVideoEncoder::GetAverageEncodeMs() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    double totalMs = 0.0;
+    int encoded = 0;
+    for (const auto &segment : segments_) {
+        if (segment->encoder) {
+            const int frames = segment->encoder->GetFramesEncoded();
+            totalMs += segment->encoder->GetAverageEncodeMs() * frames;
+            encoded += frames;
+        } else {
+            totalMs += segment->encodeMs;
+            encoded += segment->info.encoded;
+        }
+    }
+    return encoded > 0 ? totalMs / encoded : 0.0;
+}
+
+int SegmentedVideoEncoder::GetOpenSegments() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(CountOpenSegments());
+}
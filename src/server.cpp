@@ -1,25 +1,40 @@
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <condition_variable>
 #include <cstdio>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <thread>
 
+#include "delta_frame_encoder.h"
 #include "frame_broadcaster.h"
+#include "frame_converter.h"
+#include "frame_encode_pipeline.h"
+#include "frame_message_buffer.h"
+#include "frame_probe.h"
+#include "frame_ring_publisher.h"
 #include "jpeg_encoder.h"
+#include "observation_sampler.h"
 #include "process_attribute.h"
 #include "process_capture.h"
 #include "process_input.h"
 #include "process_memory.h"
 #include "process_recorder.h"
 #include "siphon_service.grpc.pb.h"
+#include "stream_encoder.h"
+#include "stream_rate_controller.h"
+#include "template_matcher.h"
 #include "utils.h"
+#include "yuv_converter.h"
+#include <google/protobuf/descriptor.h>
 #include <grpcpp/grpcpp.h>
 #include <spdlog/spdlog.h>
 
@@ -29,6 +44,7 @@ using grpc::ServerContext;
 using grpc::ServerWriter;
 using grpc::Status;
 using grpc::StatusCode;
+using siphon_service::AttributeSample;
 using siphon_service::CaptureFrameRequest;
 using siphon_service::CaptureFrameResponse;
 using siphon_service::DownloadRecordingRequest;
@@ -53,8 +69,17 @@ using siphon_service::InputKeyToggleRequest;
 using siphon_service::InputKeyToggleResponse;
 using siphon_service::MoveMouseRequest;
 using siphon_service::MoveMouseResponse;
+using siphon_service::Observation;
+using siphon_service::OpenFrameRingRequest;
+using siphon_service::OpenFrameRingResponse;
+using siphon_service::ProbeFrameRequest;
+using siphon_service::ProbeFrameResponse;
 using siphon_service::ProcessAttributeProto;
 using siphon_service::RecordingChunk;
+using siphon_service::RegisterTemplateRequest;
+using siphon_service::RegisterTemplateResponse;
+using siphon_service::RemoveTemplateRequest;
+using siphon_service::RemoveTemplateResponse;
 using siphon_service::SetProcessConfigRequest;
 using siphon_service::SetProcessConfigResponse;
 using siphon_service::SetSiphonRequest;
@@ -65,6 +90,9 @@ using siphon_service::StartRecordingResponse;
 using siphon_service::StopRecordingRequest;
 using siphon_service::StopRecordingResponse;
 using siphon_service::StreamFramesRequest;
+using siphon_service::StreamObservationsRequest;
+using siphon_service::StreamTemplateMatchesRequest;
+using siphon_service::TemplateMatchEvent;
 
 class SiphonServiceImpl final : public SiphonService::Service {
   private:
@@ -83,10 +111,468 @@ class SiphonServiceImpl final : public SiphonService::Service {
     DWORD processId_ = 0;
     bool configSet_ = false;
 
+    // Shared-memory frame rings, one per output spec; live until capture is reinitialized
+    std::mutex frameRingsMutex_;
+    std::map<FrameOutputSpec, std::unique_ptr<FrameRingPublisher>> frameRings_;
+    uint32_t nextFrameRingId_ = 0;
+
+    // Live video encoders shared by StreamFrames viewers with the same settings
+    std::mutex streamEncodersMutex_;
+    std::map<std::string, std::weak_ptr<StreamEncoder>> streamEncoders_;
+
+    // Registered HUD templates; kept across capture reinitialization
+    TemplateMatcher templateMatcher_;
+
+    std::shared_ptr<StreamEncoder> AcquireStreamEncoder(FrameBroadcaster *broadcaster,
+                                                        const StreamEncoderConfig &config) {
+        std::lock_guard<std::mutex> lock(streamEncodersMutex_);
+        std::shared_ptr<StreamEncoder> encoder = streamEncoders_[config.Key()].lock();
+        if (encoder && encoder->GetBroadcaster() == broadcaster) {
+            return encoder;
+        }
+
+        encoder = std::make_shared<StreamEncoder>(broadcaster, config);
+        if (!encoder->Start()) {
+            return nullptr;
+        }
+        streamEncoders_[config.Key()] = encoder;
+        return encoder;
+    }
+
+    // Writes one frame message to the client with payload as its data; false once the client
+    // is gone
+    using FrameSender = std::function<bool(FrameData &, const EncodedBuffer &payload)>;
+
+    // Frame streams are served with ByteBuffer writers so payloads reach gRPC as slices over the
+    // refcounted buffers instead of being copied into the message
+    using FrameByteStream = grpc::ServerSplitStreamer<StreamFramesRequest, grpc::ByteBuffer>;
+    using ObservationByteStream =
+        grpc::ServerSplitStreamer<StreamObservationsRequest, grpc::ByteBuffer>;
+
+    // Position of an rpc in SiphonService, as MarkMethodStreamed expects. Looked up in the
+    // generated descriptor so reordering siphon_service.proto can't attach a handler to the
+    // wrong method.
+    static int MethodIndex(const std::string &name) {
+        const google::protobuf::ServiceDescriptor *service =
+            google::protobuf::DescriptorPool::generated_pool()->FindServiceByName(
+                SiphonService::service_full_name());
+        const google::protobuf::MethodDescriptor *method =
+            service ? service->FindMethodByName(name) : nullptr;
+        if (!method) {
+            spdlog::critical("rpc {} missing from {}", name, SiphonService::service_full_name());
+            throw std::runtime_error("rpc " + name + " missing from siphon_service.proto");
+        }
+        return method->index();
+    }
+
+    // Streams Annex-B access units from a shared low-latency encoder
+    Status StreamVideo(ServerContext *context, FrameBroadcaster *broadcaster,
+                       const StreamEncoderConfig &config, const RateControlOptions &rateOptions,
+                       const FrameCallback &onCapture, const FrameSender &send) {
+        std::shared_ptr<StreamEncoder> encoder = AcquireStreamEncoder(broadcaster, config);
+        if (!encoder) {
+            return Status(StatusCode::INTERNAL, "Failed to start " + config.codec + " encoder");
+        }
+
+        spdlog::info("Starting video stream: {}", config.Key());
+
+        // Joining requests an IDR; the first packet delivered is always a keyframe
+        uint64_t viewerId = encoder->AddViewer();
+        StreamRateController rateController(rateOptions, 0);
+
+        // The shared encoder owns the converting subscription; capture hooks only need the
+        // frame number and timestamp, so they ride on a passthrough one
+        uint64_t captureSubscriptionId = 0;
+        if (onCapture) {
+            captureSubscriptionId = broadcaster->Subscribe(onCapture);
+        }
+
+        int framesStreamed = 0;
+        while (!context->IsCancelled()) {
+            EncodedPacket packet;
+            if (!encoder->NextPacket(viewerId, packet, std::chrono::milliseconds(100))) {
+                continue; // Timeout, check if cancelled
+            }
+
+            // Inter frames can't be skipped individually; a stale backlog restarts from an IDR
+            if (!rateController.ShouldSend(packet.timestampUs, packet.data->size())) {
+                encoder->ResyncViewer(viewerId);
+                continue;
+            }
+
+            FrameData frameMsg;
+            frameMsg.set_timestamp_us(packet.timestampUs);
+            frameMsg.set_width(packet.width);
+            frameMsg.set_height(packet.height);
+            frameMsg.set_frame_number(packet.frameNumber);
+            frameMsg.set_format(config.codec);
+            frameMsg.set_keyframe(packet.keyframe);
+            frameMsg.set_effective_fps(rateController.GetEffectiveFps());
+
+            int64_t writeStartUs = StreamRateController::NowUs();
+            if (!send(frameMsg, packet.data)) {
+                spdlog::info("Client disconnected from video stream after {} frames",
+                             framesStreamed);
+                break;
+            }
+            rateController.OnWrite(packet.data->size(),
+                                   StreamRateController::NowUs() - writeStartUs);
+            framesStreamed++;
+        }
+
+        if (captureSubscriptionId != 0) {
+            broadcaster->Unsubscribe(captureSubscriptionId);
+        }
+        encoder->RemoveViewer(viewerId);
+        spdlog::info("Video stream ended: {} frames streamed, {} dropped for latency",
+                     framesStreamed, rateController.GetDroppedFrames());
+        return Status::OK;
+    }
+
+    // Output spec fields shared by the frame RPCs
+    static Status ParseOutputSpec(int32_t width, int32_t height, const std::string &pixelFormat,
+                                  const std::string &resizeFilter,
+                                  const siphon_service::Region *roi, FrameOutputSpec &spec) {
+        spec.width = width;
+        spec.height = height;
+        if (spec.width < 0 || spec.height < 0) {
+            return Status(StatusCode::INVALID_ARGUMENT, "Output width/height must be >= 0");
+        }
+        if (roi) {
+            if (roi->x() < 0 || roi->y() < 0 || roi->width() < 0 || roi->height() < 0) {
+                return Status(StatusCode::INVALID_ARGUMENT, "roi values must be >= 0");
+            }
+            spec.region.x = roi->x();
+            spec.region.y = roi->y();
+            spec.region.width = roi->width();
+            spec.region.height = roi->height();
+        }
+        if (!FrameConverter::ParsePixelFormat(pixelFormat, spec.pixelFormat)) {
+            return Status(StatusCode::INVALID_ARGUMENT, "Unknown pixel_format: " + pixelFormat);
+        }
+        if (!FrameConverter::ParseResizeFilter(resizeFilter, spec.filter)) {
+            return Status(StatusCode::INVALID_ARGUMENT, "Unknown resize_filter: " + resizeFilter);
+        }
+        return Status::OK;
+    }
+
+    static Status ParseJpegOptions(const std::string &backend, const std::string &subsampling,
+                                   bool fastDct, JpegOptions &options) {
+        if (!JpegEncoder::ParseBackend(backend, options.backend)) {
+            return Status(StatusCode::INVALID_ARGUMENT, "Unknown jpeg_backend: " + backend);
+        }
+        if (!JpegEncoder::ParseSubsampling(subsampling, options.subsampling)) {
+            return Status(StatusCode::INVALID_ARGUMENT,
+                          "Unknown chroma_subsampling: " + subsampling);
+        }
+        options.fastDct = fastDct;
+        return Status::OK;
+    }
+
+    // Pixel probes and region statistics of one frame
+    static void ProbeCapturedFrame(const CapturedFrame &frame, const ProbeFrameRequest &request,
+                                   ProbeFrameResponse *response) {
+        response->set_frame_number(frame.frameNumber);
+        response->set_timestamp_us(frame.timestampUs);
+        response->set_width(frame.width);
+        response->set_height(frame.height);
+
+        std::string *pixels = response->mutable_pixels();
+        pixels->resize(static_cast<size_t>(request.points_size()) * 4);
+        for (int i = 0; i < request.points_size(); ++i) {
+            FrameProbe::ReadPixel(frame.pixels.data(), frame.width, frame.height,
+                                  request.points(i).x(), request.points(i).y(),
+                                  reinterpret_cast<uint8_t *>(&(*pixels)[i * 4]));
+        }
+
+        RegionStats stats;
+        for (const auto &region : request.regions()) {
+            FrameRegion frameRegion{region.x(), region.y(), region.width(), region.height()};
+            FrameProbe::ComputeRegionStats(frame.pixels.data(), frame.width, frame.height,
+                                           frameRegion, request.histogram_bins(), stats);
+
+            siphon_service::RegionStatistics *out = response->add_regions();
+            out->mutable_region()->set_x(stats.region.x);
+            out->mutable_region()->set_y(stats.region.y);
+            out->mutable_region()->set_width(stats.region.width);
+            out->mutable_region()->set_height(stats.region.height);
+            out->set_pixel_count(static_cast<int64_t>(stats.pixelCount));
+            for (int c = 0; c < 4; ++c) {
+                out->add_mean(stats.Mean(c));
+                out->add_min(stats.min[c]);
+                out->add_max(stats.max[c]);
+            }
+            out->mutable_histogram()->Add(stats.histogram.begin(), stats.histogram.end());
+        }
+        response->set_success(true);
+    }
+
+    static Status ValidateProbeRequest(const ProbeFrameRequest &request) {
+        if (request.histogram_bins() < 0 || request.histogram_bins() > 256) {
+            return Status(StatusCode::INVALID_ARGUMENT, "histogram_bins must be 0-256");
+        }
+        for (const auto &region : request.regions()) {
+            if (region.x() < 0 || region.y() < 0 || region.width() < 0 || region.height() < 0) {
+                return Status(StatusCode::INVALID_ARGUMENT, "region values must be >= 0");
+            }
+        }
+        return Status::OK;
+    }
+
+    // Shared core of StreamFrames and StreamObservations. onCapture (optional) runs in the
+    // broadcaster callback for every captured frame; send writes one frame message.
+    Status RunFrameStream(ServerContext *context, const StreamFramesRequest *request,
+                          FrameBroadcaster *broadcaster, const FrameCallback &onCapture,
+                          const FrameSender &send) {
+        // Parse request parameters
+        std::string format = request->format().empty() ? "jpeg" : request->format();
+        int quality = request->quality() > 0 ? request->quality() : 85;
+
+        // Output size/layout is produced by the broadcaster's conversion stage
+        FrameOutputSpec spec;
+        Status parseStatus =
+            ParseOutputSpec(request->width(), request->height(), request->pixel_format(),
+                            request->resize_filter(), request->has_roi() ? &request->roi() : nullptr,
+                            spec);
+        if (!parseStatus.ok()) {
+            return parseStatus;
+        }
+        JpegOptions jpegOptions;
+        parseStatus = ParseJpegOptions(request->jpeg_backend(), request->chroma_subsampling(),
+                                       request->fast_dct(), jpegOptions);
+        if (!parseStatus.ok()) {
+            return parseStatus;
+        }
+
+        if (request->max_fps() < 0.0f || request->every_nth_frame() < 0) {
+            return Status(StatusCode::INVALID_ARGUMENT,
+                          "max_fps and every_nth_frame must be >= 0");
+        }
+
+        // Decimation happens in the broadcaster, before frames are converted or copied
+        FrameRateLimit rateLimit;
+        rateLimit.maxFps = request->max_fps();
+        rateLimit.everyNthFrame = std::max(request->every_nth_frame(), 1);
+
+        DeltaEncoderOptions deltaOptions;
+        if (!DeltaFrameEncoder::ParseCompression(request->compression(),
+                                                 deltaOptions.compression)) {
+            return Status(StatusCode::INVALID_ARGUMENT,
+                          "Unknown compression: " + request->compression());
+        }
+        if (request->compression_level() > 0) {
+            deltaOptions.level = request->compression_level();
+        }
+        if (request->gop_size() > 0) {
+            deltaOptions.keyframeInterval = request->gop_size();
+        }
+
+        RateControlOptions rateOptions;
+        if (request->max_latency_ms() != 0) {
+            rateOptions.maxLatencyUs = std::max<int64_t>(request->max_latency_ms(), 0) * 1000;
+        }
+        rateOptions.minQuality = request->min_quality();
+        if (request->min_scale() > 0.0f) {
+            rateOptions.minScale = request->min_scale();
+        }
+        if (format == "jpeg") {
+            spec.pixelFormat = PixelFormat::BGRA; // Encoder consumes BGRA
+        }
+
+        if (format == "h264" || format == "hevc") {
+            StreamEncoderConfig videoConfig;
+            videoConfig.codec = format;
+            videoConfig.gopSize = request->gop_size() > 0 ? request->gop_size() : 60;
+            if (request->has_crf()) {
+                if (request->crf() < 0) {
+                    return Status(StatusCode::INVALID_ARGUMENT, "crf must be >= 0");
+                }
+                videoConfig.crf = request->crf();
+            }
+            videoConfig.spec = spec;
+            videoConfig.rateLimit = rateLimit;
+            return StreamVideo(context, broadcaster, videoConfig, rateOptions, onCapture, send);
+        }
+
+        spdlog::info("Starting frame stream: format={}, quality={}, size={}x{}, pixel_format={}, "
+                     "jpeg={}, roi={},{} {}x{}, max_fps={}, every_nth_frame={}",
+                     format, quality, spec.width, spec.height,
+                     FrameConverter::PixelFormatName(spec.pixelFormat), jpegOptions.Key(),
+                     spec.region.x, spec.region.y, spec.region.width, spec.region.height,
+                     rateLimit.maxFps, rateLimit.everyNthFrame);
+
+        // Encode on a worker pool so the next frames encode while this one is written. Raw
+        // frames need no encoding, and raw-delta frames depend on their predecessor, so both go
+        // through a single worker.
+        size_t encodeThreads = 1;
+        if (format == "jpeg") {
+            encodeThreads = request->encode_threads() > 0
+                                ? std::min<size_t>(request->encode_threads(), 16)
+                                : std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, 4);
+        }
+
+        // Encoder state is reused for the lifetime of this stream, one encoder per worker
+        std::vector<std::unique_ptr<JpegEncoder>> jpegEncoders;
+        if (format == "jpeg") {
+            for (size_t i = 0; i < encodeThreads; ++i) {
+                jpegEncoders.push_back(std::make_unique<JpegEncoder>(jpegOptions));
+            }
+        }
+
+        // Per-stream chain state for raw-delta (each viewer has its own reference frame)
+        DeltaFrameEncoder deltaEncoder(deltaOptions);
+
+        // Drops late frames and adapts JPEG quality/resolution to how fast the client drains
+        StreamRateController rateController(rateOptions, quality);
+
+        EncodedFrameCache &encodedFrameCache = broadcaster->GetEncodedFrameCache();
+        FrameEncodePipeline pipeline(
+            encodeThreads, encodeThreads * 2,
+            [&](EncodedFrame &encoded, size_t worker) {
+                CapturedFrame &frame = encoded.frame;
+                if (format == "raw-delta") {
+                    // Drop before encoding so the next delta references what was actually sent
+                    if (!rateController.ShouldSend(frame.timestampUs)) {
+                        encoded.skipped = true;
+                        return true;
+                    }
+                    auto data = std::make_shared<std::vector<uint8_t>>();
+                    if (!deltaEncoder.Encode(frame.pixels.data(), frame.pixels.size(),
+                                             frame.width, frame.height, *data, encoded.keyframe,
+                                             encoded.sequence)) {
+                        return false;
+                    }
+                    encoded.data = data;
+                    return true;
+                }
+                if (format != "jpeg") {
+                    // Raw pixels are sent as-is; the worker's copy becomes the payload
+                    encoded.data = std::make_shared<std::vector<uint8_t>>(std::move(frame.pixels));
+                    return true;
+                }
+
+                // Rate control may have lowered quality and resolution
+                encoded.quality = rateController.GetQuality();
+                // The key keeps the subscription's region so ROIs stay apart in the cache
+                FrameOutputSpec encodedSpec = spec;
+                float scale = rateController.GetScale();
+                if (scale < 1.0f) {
+                    encodedSpec.width = std::max(1, static_cast<int>(frame.width * scale));
+                    encodedSpec.height = std::max(1, static_cast<int>(frame.height * scale));
+                    // The broadcaster already cropped the frame to the region
+                    FrameOutputSpec scaleSpec = encodedSpec;
+                    scaleSpec.region = FrameRegion();
+                    std::vector<uint8_t> scaled;
+                    if (!FrameConverter::Convert(frame.pixels.data(), frame.width, frame.height,
+                                                 scaleSpec, scaled, frame.width, frame.height)) {
+                        return false;
+                    }
+                    frame.pixels = std::move(scaled);
+                }
+
+                // Encoded once per frame and shared with every subscriber using the same settings
+                EncodedFrameKey key;
+                key.frameNumber = frame.frameNumber;
+                key.format = format;
+                key.quality = encoded.quality;
+                key.options = jpegOptions.Key();
+                key.spec = encodedSpec;
+
+                encoded.data = encodedFrameCache.GetOrEncode(key, [&](std::vector<uint8_t> &out) {
+                    return jpegEncoders[worker]->Encode(frame.pixels.data(), frame.width,
+                                                        frame.height, encoded.quality, out);
+                });
+                return encoded.data != nullptr;
+            });
+
+        // Subscribe to frames; frames arriving while the pipeline is full are dropped
+        // onCapture runs first so samples are taken at capture, before encoding
+        auto callback = [&](const CapturedFrame &frame) {
+            if (onCapture) {
+                onCapture(frame);
+            }
+            pipeline.Submit(frame);
+        };
+        uint64_t subscriptionId = broadcaster->Subscribe(callback, spec, rateLimit);
+
+        // Stream frames until client disconnects
+        int framesStreamed = 0;
+        while (!context->IsCancelled()) {
+            EncodedFrame encoded;
+            if (!pipeline.Next(encoded, std::chrono::milliseconds(100))) {
+                continue; // Timeout, check if cancelled
+            }
+            if (!encoded.ok) {
+                spdlog::error("Failed to encode frame to {}", format);
+                continue;
+            }
+            if (encoded.skipped) {
+                continue;
+            }
+            const CapturedFrame &frame = encoded.frame;
+
+            // Chained formats were already checked before encoding
+            if (format != "raw-delta" &&
+                !rateController.ShouldSend(frame.timestampUs, encoded.data->size())) {
+                continue;
+            }
+
+            // Prepare frame data message
+            FrameData frameMsg;
+            frameMsg.set_timestamp_us(frame.timestampUs);
+            frameMsg.set_width(frame.width);
+            frameMsg.set_height(frame.height);
+            frameMsg.set_frame_number(frame.frameNumber);
+            frameMsg.set_format(format);
+            frameMsg.set_pixel_format(FrameConverter::PixelFormatName(frame.pixelFormat));
+            if (format == "raw-delta") {
+                frameMsg.set_keyframe(encoded.keyframe);
+                frameMsg.set_sequence(encoded.sequence);
+            }
+            frameMsg.set_effective_fps(rateController.GetEffectiveFps());
+            frameMsg.set_quality(encoded.quality);
+
+            // Send frame to client; write time is the backpressure signal
+            int64_t writeStartUs = StreamRateController::NowUs();
+            if (!send(frameMsg, encoded.data)) {
+                spdlog::info("Client disconnected from stream after {} frames", framesStreamed);
+                break;
+            }
+            rateController.OnWrite(encoded.data->size(),
+                                   StreamRateController::NowUs() - writeStartUs);
+
+            framesStreamed++;
+        }
+
+        // Unsubscribe
+        broadcaster->Unsubscribe(subscriptionId);
+        pipeline.Stop();
+        spdlog::info("Frame stream ended: {} frames streamed, {} dropped while encoding, {} "
+                     "dropped for latency",
+                     framesStreamed, pipeline.GetDroppedFrames(),
+                     rateController.GetDroppedFrames());
+
+        return Status::OK;
+    }
+
+
   public:
     SiphonServiceImpl()
         : memory_(nullptr), input_(nullptr), capture_(nullptr), recorder_(nullptr),
-          frameBroadcaster_(nullptr) {}
+          frameBroadcaster_(nullptr) {
+        MarkMethodStreamed(
+            MethodIndex("StreamFrames"),
+            new grpc::internal::SplitServerStreamingHandler<StreamFramesRequest, grpc::ByteBuffer>(
+                [this](ServerContext *context, FrameByteStream *stream) {
+                    return StreamFramesZeroCopy(context, stream);
+                }));
+        MarkMethodStreamed(MethodIndex("StreamObservations"),
+                           new grpc::internal::SplitServerStreamingHandler<
+                               StreamObservationsRequest, grpc::ByteBuffer>(
+                               [this](ServerContext *context, ObservationByteStream *stream) {
+                                   return StreamObservationsZeroCopy(context, stream);
+                               }));
+    }
 
     Status GetAttribute(ServerContext *context, const GetSiphonRequest *request,
                         GetSiphonResponse *response) override {
@@ -239,16 +725,129 @@ class SiphonServiceImpl final : public SiphonService::Service {
 
     Status CaptureFrame(ServerContext *context, const CaptureFrameRequest *request,
                         CaptureFrameResponse *response) override {
-        // TODO: Add error handling
-        auto pixels = capture_->GetPixelData();
-        response->set_width(capture_->processWindowWidth);
-        response->set_height(capture_->processWindowHeight);
-        response->set_frame(reinterpret_cast<const char *>(pixels.data()), pixels.size());
-        // capture_->SaveBMP(pixels, "frame.bmp");
-        spdlog::info("Frame captured successfully - width: {}, height: {}",
-                     capture_->processWindowWidth, capture_->processWindowHeight);
+        std::string format = request->format().empty() ? "raw" : request->format();
+        if (format != "raw" && format != "jpeg") {
+            response->set_success(false);
+            response->set_message("Unknown format: " + format);
+            return Status::OK;
+        }
+        int quality = request->quality() > 0 ? request->quality() : 85;
+
+        FrameOutputSpec spec;
+        Status status = ParseOutputSpec(request->width(), request->height(),
+                                        request->pixel_format(), request->resize_filter(),
+                                        request->has_roi() ? &request->roi() : nullptr, spec);
+        JpegOptions jpegOptions;
+        if (status.ok()) {
+            status = ParseJpegOptions(request->jpeg_backend(), request->chroma_subsampling(),
+                                      request->fast_dct(), jpegOptions);
+        }
+        if (!status.ok()) {
+            response->set_success(false);
+            response->set_message(status.error_message());
+            return Status::OK;
+        }
+        if (format == "jpeg") {
+            spec.pixelFormat = PixelFormat::BGRA; // Encoder consumes BGRA
+        }
+
+        FrameBroadcaster *broadcaster = nullptr;
+        ProcessCapture *capture = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (frameBroadcaster_ && frameBroadcaster_->IsRunning()) {
+                broadcaster = frameBroadcaster_.get();
+            }
+            capture = capture_.get();
+        }
+
+        // Latest broadcast frame: no GPU round-trip or staging texture, and no pixel copy
+        // until conversion/encoding
+        std::shared_ptr<const CapturedFrame> source;
+        if (broadcaster) {
+            int timeoutMs = request->timeout_ms() > 0 ? request->timeout_ms() : 1000;
+            source = broadcaster->GetLatestFrame(request->min_frame_number(),
+                                                 std::chrono::milliseconds(timeoutMs));
+            if (!source) {
+                response->set_success(false);
+                response->set_message("No frame >= " + std::to_string(request->min_frame_number()) +
+                                      " captured within " + std::to_string(timeoutMs) + " ms");
+                return Status::OK;
+            }
+        } else if (capture) {
+            auto direct = std::make_shared<CapturedFrame>();
+            direct->pixels = capture->GetPixelData();
+            direct->width = capture->processWindowWidth;
+            direct->height = capture->processWindowHeight;
+            direct->timestampUs = StreamRateController::NowUs();
+            direct->frameNumber = -1;
+            source = direct;
+        } else {
+            response->set_success(false);
+            response->set_message("Capture not initialized");
+            return Status::OK;
+        }
+        if (source->pixels.empty() || source->width <= 0 || source->height <= 0) {
+            response->set_success(false);
+            response->set_message("Failed to capture frame");
+            return Status::OK;
+        }
+
+        // Convert only when something other than the capture layout was asked for
+        const std::vector<uint8_t> *pixels = &source->pixels;
+        int32_t width = source->width;
+        int32_t height = source->height;
+        std::vector<uint8_t> converted;
+        if (!spec.IsPassthrough()) {
+            if (!FrameConverter::Convert(source->pixels.data(), source->width, source->height,
+                                         spec, converted, width, height)) {
+                response->set_success(false);
+                response->set_message("Frame conversion failed (roi outside the frame?)");
+                return Status::OK;
+            }
+            pixels = &converted;
+        }
+
+        if (format == "jpeg") {
+            // Broadcast frames share the streams' encode-once cache
+            auto encode = [&](std::vector<uint8_t> &out) {
+                JpegEncoder encoder(jpegOptions);
+                return encoder.Encode(pixels->data(), width, height, quality, out);
+            };
+            EncodedBuffer jpeg;
+            if (broadcaster && source->frameNumber >= 0) {
+                EncodedFrameKey key;
+                key.frameNumber = source->frameNumber;
+                key.format = format;
+                key.quality = quality;
+                key.options = jpegOptions.Key();
+                key.spec = spec;
+                jpeg = broadcaster->GetEncodedFrameCache().GetOrEncode(key, encode);
+            } else {
+                auto data = std::make_shared<std::vector<uint8_t>>();
+                if (encode(*data)) {
+                    jpeg = data;
+                }
+            }
+            if (!jpeg) {
+                response->set_success(false);
+                response->set_message("JPEG encoding failed");
+                return Status::OK;
+            }
+            response->set_frame(jpeg->data(), jpeg->size());
+        } else {
+            response->set_frame(pixels->data(), pixels->size());
+            response->set_pixel_format(FrameConverter::PixelFormatName(spec.pixelFormat));
+        }
+
+        response->set_width(width);
+        response->set_height(height);
+        response->set_timestamp_us(source->timestampUs);
+        response->set_frame_number(source->frameNumber);
+        response->set_format(format);
         response->set_success(true);
         response->set_message("Frame captured successfully");
+        spdlog::debug("Frame captured: #{} {}x{} {}", source->frameNumber, width, height, format);
 
         return Status::OK;
     }
@@ -471,6 +1070,12 @@ class SiphonServiceImpl final : public SiphonService::Service {
             spdlog::info("Capture initialized successfully! Window size: {}x{}",
                          capture_->processWindowWidth, capture_->processWindowHeight);
 
+            // Frame rings are subscribed to the broadcaster being replaced
+            {
+                std::lock_guard<std::mutex> ringsLock(frameRingsMutex_);
+                frameRings_.clear();
+            }
+
             // Also start FrameBroadcaster for streaming
             frameBroadcaster_ = std::make_unique<FrameBroadcaster>(capture_.get());
             if (!frameBroadcaster_->Start(processWindow_)) {
@@ -487,6 +1092,10 @@ class SiphonServiceImpl final : public SiphonService::Service {
 
         } catch (const std::exception &e) {
             spdlog::error("Exception during capture initialization: {}", e.what());
+            {
+                std::lock_guard<std::mutex> ringsLock(frameRingsMutex_);
+                frameRings_.clear();
+            }
             capture_.reset();
             frameBroadcaster_.reset();
             response->set_success(false);
@@ -642,9 +1251,138 @@ class SiphonServiceImpl final : public SiphonService::Service {
         // Convert repeated field to vector
         std::vector<std::string> attributeNames(request->attribute_names().begin(),
                                                 request->attribute_names().end());
+        for (const std::string &name : attributeNames) {
+            if (processAttributes_.find(name) == processAttributes_.end()) {
+                response->set_success(false);
+                response->set_message("Unknown attribute: " + name);
+                return Status::OK;
+            }
+        }
+
+        RecordingOptions options;
+        if (request->encoder_queue_frames() < 0) {
+            response->set_success(false);
+            response->set_message("encoder_queue_frames must be >= 0");
+            return Status::OK;
+        }
+        if (request->encoder_queue_frames() > 0) {
+            options.encoderQueueFrames = request->encoder_queue_frames();
+        }
+        if (!VideoEncoder::ParseQueueFullPolicy(request->queue_full_policy(),
+                                                options.queueFullPolicy)) {
+            response->set_success(false);
+            response->set_message("Unknown queue_full_policy: " + request->queue_full_policy());
+            return Status::OK;
+        }
+
+        if (!request->codec().empty()) {
+            options.encoder.codec = request->codec();
+        }
+        if (!VideoEncoderConfig::IsSupportedCodec(options.encoder.codec)) {
+            response->set_success(false);
+            response->set_message("Unknown codec: " + options.encoder.codec);
+            return Status::OK;
+        }
+        if (request->crf() < 0 || request->frame_threads() < 0 || request->slice_threads() < 0) {
+            response->set_success(false);
+            response->set_message("crf, frame_threads and slice_threads must be >= 0");
+            return Status::OK;
+        }
+        if (request->has_crf()) {
+            options.encoder.crf = request->crf();
+        }
+        options.encoder.preset = request->preset();
+        options.encoder.frameThreads = request->frame_threads();
+        options.encoder.sliceThreads = request->slice_threads();
+        options.encoder.zeroLatency = request->zero_latency();
+        if (!request->color_matrix().empty() &&
+            !YuvConverter::ParseMatrix(request->color_matrix(), options.encoder.colorMatrix)) {
+            response->set_success(false);
+            response->set_message("Unknown color_matrix: " + request->color_matrix());
+            return Status::OK;
+        }
+        options.encoder.fullRange = request->full_range();
+        if (request->segment_seconds() < 0 || request->parallel_segments() < 0) {
+            response->set_success(false);
+            response->set_message("segment_seconds and parallel_segments must be >= 0");
+            return Status::OK;
+        }
+        options.segments.segmentSeconds = request->segment_seconds();
+        if (request->parallel_segments() > 0) {
+            options.segments.parallelSegments = request->parallel_segments();
+        }
+        if (request->fragment_ms() < 0) {
+            response->set_success(false);
+            response->set_message("fragment_ms must be >= 0");
+            return Status::OK;
+        }
+        options.encoder.fragmented = request->fragmented();
+        if (request->fragment_ms() > 0) {
+            options.encoder.fragmentMs = request->fragment_ms();
+        }
+        if (request->sync_interval_ms() != 0) {
+            options.encoder.syncIntervalMs = std::max(request->sync_interval_ms(), 0);
+        }
+        if (!ProcessRecorder::ParseAttributeSampling(request->attribute_sampling(),
+                                                     options.attributeSampling)) {
+            response->set_success(false);
+            response->set_message("Unknown attribute_sampling: " + request->attribute_sampling());
+            return Status::OK;
+        }
+        if (request->attribute_sample_hz() < 0) {
+            response->set_success(false);
+            response->set_message("attribute_sample_hz must be >= 0");
+            return Status::OK;
+        }
+        if (request->attribute_sample_hz() > 0) {
+            options.attributeSampleHz = request->attribute_sample_hz();
+        }
+        options.exportMemoryCsv = !request->skip_memory_csv();
+        if (!ProcessRecorder::ParseRecordingSink(request->sink(), options.sink)) {
+            response->set_success(false);
+            response->set_message("Unknown sink: " + request->sink());
+            return Status::OK;
+        }
+        if (options.sink == RecordingSink::Hdf5 &&
+            options.attributeSampling != AttributeSampling::PerFrame) {
+            response->set_success(false);
+            response->set_message("sink \"hdf5\" requires attribute_sampling \"frame\"");
+            return Status::OK;
+        }
+        if (request->hdf5_batch_frames() < 0) {
+            response->set_success(false);
+            response->set_message("hdf5_batch_frames must be >= 0");
+            return Status::OK;
+        }
+        if (request->hdf5_batch_frames() > 0) {
+            options.hdf5.batchFrames = static_cast<size_t>(request->hdf5_batch_frames());
+        }
+        if (!H5RecordingWriter::ParseCompression(request->hdf5_compression(),
+                                                 options.hdf5.compression)) {
+            response->set_success(false);
+            response->set_message("Unknown hdf5_compression: " + request->hdf5_compression());
+            return Status::OK;
+        }
+        if (options.sink == RecordingSink::Hdf5 &&
+            !H5RecordingWriter::CompressionAvailable(options.hdf5.compression)) {
+            response->set_success(false);
+            response->set_message("HDF5 filter plugin not found for hdf5_compression: " +
+                                  request->hdf5_compression());
+            return Status::OK;
+        }
+        if (request->hdf5_compression_level() < 0 || request->hdf5_tile_size() < 0) {
+            response->set_success(false);
+            response->set_message("hdf5_compression_level and hdf5_tile_size must be >= 0");
+            return Status::OK;
+        }
+        if (request->hdf5_compression_level() > 0) {
+            options.hdf5.compressionLevel = request->hdf5_compression_level();
+        }
+        options.hdf5.tileSize = request->hdf5_tile_size();
+        options.hdf5.dropAlpha = request->hdf5_drop_alpha();
 
         if (recorder_->StartRecording(attributeNames, request->output_directory(),
-                                      request->max_duration_seconds())) {
+                                      request->max_duration_seconds(), options)) {
             response->set_success(true);
             response->set_message("Recording started successfully");
             response->set_session_id(recorder_->GetSessionId());
@@ -671,12 +1409,20 @@ class SiphonServiceImpl final : public SiphonService::Service {
         RecordingStats stats;
         if (recorder_->StopRecording(stats)) {
             response->set_success(true);
-            response->set_message("Recording stopped successfully");
+            if (stats.stitchError.empty()) {
+                response->set_message("Recording stopped successfully");
+            } else {
+                response->set_message("Recording stopped, but segments could not be stitched: " +
+                                      stats.stitchError);
+                response->set_stitch_error(stats.stitchError);
+            }
             response->set_total_frames(stats.totalFrames);
             response->set_average_latency_ms(stats.averageLatencyMs);
             response->set_dropped_frames(stats.droppedFrames);
             response->set_actual_duration_seconds(stats.actualDurationSeconds);
             response->set_actual_fps(stats.actualFps);
+            response->set_encoder_dropped_frames(stats.encoderDroppedFrames);
+            response->set_missed_frames(stats.missedFrames);
             spdlog::info("Recording stopped - Frames: {}, Duration: {:.1f}s, FPS: {:.1f}, Avg "
                          "latency: {:.2f}ms, Dropped: {}",
                          stats.totalFrames, stats.actualDurationSeconds, stats.actualFps,
@@ -719,6 +1465,18 @@ class SiphonServiceImpl final : public SiphonService::Service {
             response->set_elapsed_time_seconds(elapsedTime);
             response->set_current_latency_ms(currentLatency);
             response->set_dropped_frames(droppedFrames);
+
+            RecordingQueueStatus queue;
+            recorder_->GetQueueStatus(queue);
+            response->set_encoder_queue_size(static_cast<int32_t>(queue.queueSize));
+            response->set_encoder_queue_capacity(static_cast<int32_t>(queue.queueCapacity));
+            response->set_encoder_dropped_frames(queue.encoderDroppedFrames);
+            response->set_missed_frames(queue.missedFrames);
+            response->set_encoder_degrade_level(queue.degradeLevel);
+            response->set_last_encode_ms(queue.lastEncodeMs);
+            response->set_average_encode_ms(queue.averageEncodeMs);
+            response->set_segments(queue.segments);
+            response->set_open_segments(queue.openSegments);
         } else {
             response->set_success(false);
             response->set_message("Failed to get recording status");
@@ -747,11 +1505,35 @@ class SiphonServiceImpl final : public SiphonService::Service {
         }
 
         // List of files to send (in order)
-        std::vector<std::string> filesToSend = {"video.mp4", "inputs.csv", "memory_data.csv",
-                                                "perf_data.csv"};
+        std::vector<std::string> filesToSend = {"video.mp4",          "video.mkv",
+                                                "recording.h5",       "inputs.csv",
+                                                "memory_data.csv",    "memory_data.arrow",
+                                                "dropped_frames.csv", "encode_times.csv",
+                                                "segments.csv",       "perf_data.csv"};
+
+        // Segments are only left on disk when stitching failed; send them in place of the video
+        std::filesystem::path segmentsDir = sessionDir / "segments";
+        if (std::filesystem::is_directory(segmentsDir)) {
+            std::vector<std::string> segmentFiles = {"segments.ffconcat"};
+            for (const auto &entry : std::filesystem::directory_iterator(segmentsDir)) {
+                if (entry.is_regular_file()) {
+                    segmentFiles.push_back("segments/" + entry.path().filename().string());
+                }
+            }
+            std::sort(segmentFiles.begin() + 1, segmentFiles.end());
+            filesToSend.insert(filesToSend.end() - 1, segmentFiles.begin(), segmentFiles.end());
+        }
 
         spdlog::info("Starting download of recording: {}", sessionId);
 
+        // One arena-allocated chunk message is reused for every chunk of every file, so its data
+        // buffer is allocated once and file reads go straight into it
+        const size_t chunkSize = 1024 * 1024; // 1MB chunks
+        google::protobuf::Arena arena;
+        RecordingChunk &chunk = *google::protobuf::Arena::CreateMessage<RecordingChunk>(&arena);
+        std::string &data = *chunk.mutable_data();
+        data.resize(chunkSize);
+
         // Stream each file
         for (size_t fileIndex = 0; fileIndex < filesToSend.size(); ++fileIndex) {
             std::filesystem::path filePath = sessionDir / filesToSend[fileIndex];
@@ -777,25 +1559,23 @@ class SiphonServiceImpl final : public SiphonService::Service {
             spdlog::info("Sending file: {} ({} bytes)", filesToSend[fileIndex], fileSize);
 
             // Stream file in chunks
-            const size_t chunkSize = 1024 * 1024; // 1MB chunks
-            std::vector<uint8_t> buffer(chunkSize);
+            chunk.set_total_size(fileSize);
+            chunk.set_filename(filesToSend[fileIndex]);
             uint64_t offset = 0;
             size_t chunksWritten = 0;
 
-            while (file.read(reinterpret_cast<char *>(buffer.data()), chunkSize) ||
-                   file.gcount() > 0) {
-                RecordingChunk chunk;
+            while (file.read(data.data(), chunkSize) || file.gcount() > 0) {
                 size_t bytesRead = file.gcount();
                 bool isLastFile = (fileIndex == filesToSend.size() - 1);
 
-                chunk.set_data(buffer.data(), bytesRead);
+                data.resize(bytesRead);
                 chunk.set_offset(offset);
-                chunk.set_total_size(fileSize);
                 chunk.set_is_final(file.eof() &&
                                    isLastFile); // Only mark final on last chunk of last file
-                chunk.set_filename(filesToSend[fileIndex]);
 
-                if (!writer->Write(chunk)) {
+                bool written = writer->Write(chunk);
+                data.resize(chunkSize);
+                if (!written) {
                     spdlog::error("Failed to write chunk at offset {} for {}", offset,
                                   filesToSend[fileIndex]);
                     return Status(StatusCode::INTERNAL, "Failed to stream chunk");
@@ -835,6 +1615,10 @@ class SiphonServiceImpl final : public SiphonService::Service {
                 std::filesystem::remove_all(framesDir);
                 spdlog::info("Deleted frames directory");
             }
+            if (std::filesystem::exists(segmentsDir)) {
+                std::filesystem::remove_all(segmentsDir);
+                spdlog::info("Deleted segments directory");
+            }
 
             // Try to remove the session directory if it's empty
             if (std::filesystem::is_empty(sessionDir)) {
@@ -850,8 +1634,12 @@ class SiphonServiceImpl final : public SiphonService::Service {
         return Status::OK;
     }
 
-    Status StreamFrames(ServerContext *context, const StreamFramesRequest *request,
-                        ServerWriter<FrameData> *writer) override {
+    Status StreamFramesZeroCopy(ServerContext *context, FrameByteStream *stream) {
+        StreamFramesRequest request;
+        if (!stream->Read(&request)) {
+            return Status(StatusCode::INVALID_ARGUMENT, "Missing StreamFramesRequest");
+        }
+
         // Validate and get broadcaster pointer (release lock quickly!)
         FrameBroadcaster* broadcaster = nullptr;
         {
@@ -864,77 +1652,374 @@ class SiphonServiceImpl final : public SiphonService::Service {
         }
         // Lock released here - other RPCs can now execute!
 
-        // Parse request parameters
-        std::string format = request->format().empty() ? "jpeg" : request->format();
-        int quality = request->quality() > 0 ? request->quality() : 85;
+        return RunFrameStream(context, &request, broadcaster, nullptr,
+                              [stream](FrameData &frameMsg, const EncodedBuffer &payload) {
+                                  return stream->Write(
+                                      FrameMessageBuffer::BuildFrame(frameMsg, payload));
+                              });
+    }
 
-        spdlog::info("Starting frame stream: format={}, quality={}", format, quality);
+    Status StreamObservationsZeroCopy(ServerContext *context, ObservationByteStream *stream) {
+        StreamObservationsRequest request;
+        if (!stream->Read(&request)) {
+            return Status(StatusCode::INVALID_ARGUMENT, "Missing StreamObservationsRequest");
+        }
 
-        // Subscribe to frames
-        std::atomic<bool> streamActive{true};
-        std::mutex frameMutex;
-        std::condition_variable frameCv;
-        CapturedFrame latestFrame;
-        bool hasFrame = false;
+        FrameBroadcaster *broadcaster = nullptr;
+        ProcessMemory *memory = nullptr;
+        std::vector<ProcessAttribute> attributes;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!frameBroadcaster_ || !frameBroadcaster_->IsRunning()) {
+                return Status(StatusCode::FAILED_PRECONDITION,
+                              "Capture not initialized or FrameBroadcaster not running");
+            }
+            if (request.attributes_size() > 0 && !memory_) {
+                return Status(StatusCode::FAILED_PRECONDITION, "Memory not initialized");
+            }
+            for (const std::string &name : request.attributes()) {
+                auto it = processAttributes_.find(name);
+                if (it == processAttributes_.end()) {
+                    return Status(StatusCode::INVALID_ARGUMENT, "Unknown attribute: " + name);
+                }
+                attributes.push_back(it->second);
+                attributes.back().AttributeName = name;
+            }
+            broadcaster = frameBroadcaster_.get();
+            memory = memory_.get();
+        }
 
-        auto callback = [&](const CapturedFrame &frame) {
-            std::lock_guard<std::mutex> lock(frameMutex);
-            latestFrame = frame;
-            hasFrame = true;
-            frameCv.notify_one();
-        };
+        spdlog::info("Starting observation stream: {} attributes, key_state={}",
+                     attributes.size(), request.include_key_state());
+
+        ObservationSampler sampler(memory, attributes, request.include_key_state());
+        sampler.Start();
+
+        int missedSamples = 0;
+        std::vector<char> arenaBlock(4096);
+        google::protobuf::ArenaOptions arenaOptions;
+        arenaOptions.initial_block = arenaBlock.data();
+        arenaOptions.initial_block_size = arenaBlock.size();
+        Status status = RunFrameStream(
+            context, &request.frame(), broadcaster,
+            [&sampler](const CapturedFrame &frame) { sampler.OnCapture(frame); },
+            [&](FrameData &frameMsg, const EncodedBuffer &payload) {
+                // Attribute samples are many small messages; keep them in one arena block
+                google::protobuf::Arena arena(arenaOptions);
+                Observation &observation =
+                    *google::protobuf::Arena::CreateMessage<Observation>(&arena);
+                ObservationSample sample;
+                if (sampler.WaitForSample(frameMsg.frame_number(), sample,
+                                          std::chrono::milliseconds(50))) {
+                    for (const AttributeValue &value : sample.attributes) {
+                        AttributeSample *attribute = observation.add_attributes();
+                        attribute->set_name(value.name);
+                        attribute->set_valid(value.valid);
+                        if (!value.valid) {
+                            continue;
+                        }
+                        if (value.type == "int") {
+                            attribute->set_int_value(value.intValue);
+                        } else if (value.type == "float") {
+                            attribute->set_float_value(value.floatValue);
+                        } else if (value.type == "array") {
+                            attribute->set_array_value(value.arrayValue.data(),
+                                                       value.arrayValue.size());
+                        } else if (value.type == "bool") {
+                            attribute->set_bool_value(value.boolValue);
+                        }
+                    }
+                    observation.set_attributes_timestamp_us(sample.attributesTimestampUs);
+                    if (sample.hasKeyState) {
+                        observation.set_key_state(sample.keyState.data(), sample.keyState.size());
+                        observation.set_key_state_timestamp_us(sample.keyStateTimestampUs);
+                    }
+                } else {
+                    missedSamples++;
+                }
+                return stream->Write(
+                    FrameMessageBuffer::BuildObservation(observation, frameMsg, payload));
+            });
+
+        sampler.Stop();
+        spdlog::info("Observation stream ended: {} frames without a sample in time",
+                     missedSamples);
+        return status;
+    }
 
-        uint64_t subscriptionId = broadcaster->Subscribe(callback);
+    Status ProbeFrame(ServerContext *context, const ProbeFrameRequest *request,
+                      ProbeFrameResponse *response) override {
+        Status status = ValidateProbeRequest(*request);
+        if (!status.ok()) {
+            return status;
+        }
 
-        // Stream frames until client disconnects
-        int framesStreamed = 0;
-        while (streamActive && !context->IsCancelled()) {
-            // Wait for next frame
-            std::unique_lock<std::mutex> lock(frameMutex);
-            if (!frameCv.wait_for(lock, std::chrono::milliseconds(100),
-                                  [&] { return hasFrame; })) {
+        FrameBroadcaster *broadcaster = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!frameBroadcaster_ || !frameBroadcaster_->IsRunning()) {
+                return Status(StatusCode::FAILED_PRECONDITION,
+                              "Capture not initialized or FrameBroadcaster not running");
+            }
+            broadcaster = frameBroadcaster_.get();
+        }
+
+        int timeoutMs = request->timeout_ms() > 0 ? request->timeout_ms() : 1000;
+        std::shared_ptr<const CapturedFrame> frame = broadcaster->GetLatestFrame(
+            request->min_frame_number(), std::chrono::milliseconds(timeoutMs));
+        if (!frame) {
+            response->set_success(false);
+            response->set_message("No frame >= " + std::to_string(request->min_frame_number()) +
+                                  " captured within " + std::to_string(timeoutMs) + " ms");
+            return Status::OK;
+        }
+
+        ProbeCapturedFrame(*frame, *request, response);
+        return Status::OK;
+    }
+
+    Status StreamProbes(ServerContext *context, const ProbeFrameRequest *request,
+                        ServerWriter<ProbeFrameResponse> *writer) override {
+        Status status = ValidateProbeRequest(*request);
+        if (!status.ok()) {
+            return status;
+        }
+        if (request->max_fps() < 0.0f) {
+            return Status(StatusCode::INVALID_ARGUMENT, "max_fps must be >= 0");
+        }
+
+        FrameBroadcaster *broadcaster = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!frameBroadcaster_ || !frameBroadcaster_->IsRunning()) {
+                return Status(StatusCode::FAILED_PRECONDITION,
+                              "Capture not initialized or FrameBroadcaster not running");
+            }
+            broadcaster = frameBroadcaster_.get();
+        }
+
+        spdlog::info("Starting probe stream: {} points, {} regions, max_fps={}",
+                     request->points_size(), request->regions_size(), request->max_fps());
+
+        // Reads the broadcaster's latest frame in place; no subscription or frame copy
+        const auto interval = std::chrono::microseconds(
+            request->max_fps() > 0.0f ? static_cast<int64_t>(1e6 / request->max_fps()) : 0);
+        auto nextDue = std::chrono::steady_clock::now();
+        int32_t nextFrame = 0;
+        int probesStreamed = 0;
+        while (!context->IsCancelled()) {
+            std::this_thread::sleep_until(nextDue);
+            std::shared_ptr<const CapturedFrame> frame =
+                broadcaster->GetLatestFrame(nextFrame, std::chrono::milliseconds(100));
+            if (!frame) {
                 continue; // Timeout, check if cancelled
             }
+            nextFrame = frame->frameNumber + 1;
+            nextDue = std::chrono::steady_clock::now() + interval;
 
-            CapturedFrame frame = latestFrame;
-            hasFrame = false;
-            lock.unlock();
+            ProbeFrameResponse response;
+            ProbeCapturedFrame(*frame, *request, &response);
+            frame.reset();
+            if (!writer->Write(response)) {
+                break;
+            }
+            probesStreamed++;
+        }
 
-            // Prepare frame data message
-            FrameData frameMsg;
-            frameMsg.set_timestamp_us(frame.timestampUs);
-            frameMsg.set_width(frame.width);
-            frameMsg.set_height(frame.height);
-            frameMsg.set_frame_number(frame.frameNumber);
-            frameMsg.set_format(format);
+        spdlog::info("Probe stream ended: {} results streamed", probesStreamed);
+        return Status::OK;
+    }
+
+    Status RegisterTemplate(ServerContext *context, const RegisterTemplateRequest *request,
+                            RegisterTemplateResponse *response) override {
+        TemplateSpec spec;
+        spec.name = request->name();
+        spec.bgra.assign(request->data().begin(), request->data().end());
+        spec.width = request->width();
+        spec.height = request->height();
+        if (request->has_search_roi()) {
+            const siphon_service::Region &roi = request->search_roi();
+            spec.searchRegion = {roi.x(), roi.y(), roi.width(), roi.height()};
+        }
+        if (!TemplateMatcher::ParseMethod(request->method(), spec.method)) {
+            response->set_success(false);
+            response->set_message("Unknown match method: " + request->method());
+            return Status::OK;
+        }
+        if (request->threshold() != 0.0f) {
+            spec.threshold = request->threshold();
+        }
+        // Wire: 0 = auto, -1 = full resolution only
+        if (request->pyramid_levels() != 0) {
+            spec.pyramidLevels = std::max(request->pyramid_levels(), 0);
+        }
+
+        std::string error;
+        int32_t templateId = templateMatcher_.AddTemplate(spec, error);
+        if (templateId < 0) {
+            response->set_success(false);
+            response->set_message(error);
+            return Status::OK;
+        }
 
-            // Encode frame based on format
-            if (format == "jpeg") {
-                auto jpegData =
-                    JpegEncoder::EncodeBGRA(frame.pixels.data(), frame.width, frame.height, quality);
-                if (jpegData.empty()) {
-                    spdlog::error("Failed to encode frame to JPEG");
+        spdlog::info("Registered template {} '{}' ({}x{}, {}, threshold {})", templateId,
+                     spec.name, spec.width, spec.height,
+                     TemplateMatcher::MethodName(spec.method), spec.threshold);
+        response->set_success(true);
+        response->set_message("Template registered");
+        response->set_template_id(templateId);
+        return Status::OK;
+    }
+
+    Status RemoveTemplate(ServerContext *context, const RemoveTemplateRequest *request,
+                          RemoveTemplateResponse *response) override {
+        if (!templateMatcher_.RemoveTemplate(request->template_id())) {
+            response->set_success(false);
+            response->set_message("Unknown template id: " +
+                                  std::to_string(request->template_id()));
+            return Status::OK;
+        }
+        spdlog::info("Removed template {}", request->template_id());
+        response->set_success(true);
+        response->set_message("Template removed");
+        return Status::OK;
+    }
+
+    Status StreamTemplateMatches(ServerContext *context,
+                                 const StreamTemplateMatchesRequest *request,
+                                 ServerWriter<TemplateMatchEvent> *writer) override {
+        if (request->max_fps() < 0.0f) {
+            return Status(StatusCode::INVALID_ARGUMENT, "max_fps must be >= 0");
+        }
+        std::vector<int32_t> templateIds(request->template_ids().begin(),
+                                         request->template_ids().end());
+        for (int32_t templateId : templateIds) {
+            if (!templateMatcher_.HasTemplate(templateId)) {
+                return Status(StatusCode::INVALID_ARGUMENT,
+                              "Unknown template id: " + std::to_string(templateId));
+            }
+        }
+
+        FrameBroadcaster *broadcaster = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!frameBroadcaster_ || !frameBroadcaster_->IsRunning()) {
+                return Status(StatusCode::FAILED_PRECONDITION,
+                              "Capture not initialized or FrameBroadcaster not running");
+            }
+            broadcaster = frameBroadcaster_.get();
+        }
+
+        spdlog::info("Starting template match stream: {} templates, report_all={}, max_fps={}",
+                     templateIds.empty() ? "all" : std::to_string(templateIds.size()),
+                     request->report_all(), request->max_fps());
+
+        // Matches against the broadcaster's latest frame in place, like StreamProbes
+        const auto interval = std::chrono::microseconds(
+            request->max_fps() > 0.0f ? static_cast<int64_t>(1e6 / request->max_fps()) : 0);
+        auto nextDue = std::chrono::steady_clock::now();
+        int32_t nextFrame = 0;
+        std::map<int32_t, TemplateMatch> previous;
+        std::vector<TemplateMatch> results;
+        int eventsStreamed = 0;
+        bool writing = true;
+        while (writing && !context->IsCancelled()) {
+            std::this_thread::sleep_until(nextDue);
+            std::shared_ptr<const CapturedFrame> frame =
+                broadcaster->GetLatestFrame(nextFrame, std::chrono::milliseconds(100));
+            if (!frame) {
+                continue; // Timeout, check if cancelled
+            }
+            nextFrame = frame->frameNumber + 1;
+            nextDue = std::chrono::steady_clock::now() + interval;
+
+            templateMatcher_.Match(frame->pixels.data(), frame->width, frame->height, templateIds,
+                                   results);
+            const int32_t frameNumber = frame->frameNumber;
+            const int64_t timestampUs = frame->timestampUs;
+            frame.reset();
+
+            for (const TemplateMatch &match : results) {
+                // Appeared, moved or disappeared since the last matched frame
+                TemplateMatch &last = previous[match.templateId];
+                bool changed = match.matched != last.matched ||
+                               (match.matched && (match.x != last.x || match.y != last.y));
+                last = match;
+                if (!changed && !request->report_all()) {
                     continue;
                 }
-                frameMsg.set_data(jpegData.data(), jpegData.size());
-            } else {
-                // Raw BGRA format
-                frameMsg.set_data(frame.pixels.data(), frame.pixels.size());
-            }
 
-            // Send frame to client
-            if (!writer->Write(frameMsg)) {
-                spdlog::info("Client disconnected from stream after {} frames", framesStreamed);
-                break;
+                TemplateMatchEvent event;
+                event.set_template_id(match.templateId);
+                event.set_name(match.name);
+                event.set_matched(match.matched);
+                event.set_score(match.score);
+                event.set_x(match.x);
+                event.set_y(match.y);
+                event.set_width(match.width);
+                event.set_height(match.height);
+                event.set_frame_number(frameNumber);
+                event.set_timestamp_us(timestampUs);
+                if (!writer->Write(event)) {
+                    writing = false;
+                    break;
+                }
+                eventsStreamed++;
             }
+        }
 
-            framesStreamed++;
+        spdlog::info("Template match stream ended: {} events streamed", eventsStreamed);
+        return Status::OK;
+    }
+
+    Status OpenFrameRing(ServerContext *context, const OpenFrameRingRequest *request,
+                         OpenFrameRingResponse *response) override {
+        FrameBroadcaster *broadcaster = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!frameBroadcaster_ || !frameBroadcaster_->IsRunning()) {
+                response->set_success(false);
+                response->set_message("Capture not initialized or FrameBroadcaster not running");
+                return Status::OK;
+            }
+            broadcaster = frameBroadcaster_.get();
         }
 
-        // Unsubscribe
-        broadcaster->Unsubscribe(subscriptionId);
-        spdlog::info("Frame stream ended: {} frames streamed", framesStreamed);
+        FrameOutputSpec spec;
+        spec.width = request->width();
+        spec.height = request->height();
+        if (spec.width < 0 || spec.height < 0 ||
+            !FrameConverter::ParsePixelFormat(request->pixel_format(), spec.pixelFormat) ||
+            !FrameConverter::ParseResizeFilter(request->resize_filter(), spec.filter)) {
+            response->set_success(false);
+            response->set_message("Invalid output size, pixel_format or resize_filter");
+            return Status::OK;
+        }
+        uint32_t slotCount = request->slot_count() > 0 ? request->slot_count() : 4;
+
+        std::lock_guard<std::mutex> ringsLock(frameRingsMutex_);
+        auto it = frameRings_.find(spec);
+        if (it == frameRings_.end()) {
+            std::string name = "siphon_frames_" + std::to_string(GetCurrentProcessId()) + "_" +
+                               std::to_string(nextFrameRingId_++);
+            auto publisher =
+                std::make_unique<FrameRingPublisher>(broadcaster, spec, name, slotCount);
+            if (!publisher->Start(std::chrono::milliseconds(2000))) {
+                response->set_success(false);
+                response->set_message("Failed to create frame ring " + name);
+                return Status::OK;
+            }
+            it = frameRings_.emplace(spec, std::move(publisher)).first;
+        }
 
+        FrameRingPublisher &ring = *it->second;
+        response->set_success(true);
+        response->set_message("Frame ring ready");
+        response->set_segment_name(ring.GetName());
+        response->set_slot_count(ring.GetSlotCount());
+        response->set_slot_capacity(static_cast<int64_t>(ring.GetSlotCapacity()));
+        spdlog::info("Frame ring handed out: {} ({}x{}, {})", ring.GetName(), spec.width,
+                     spec.height, FrameConverter::PixelFormatName(spec.pixelFormat));
         return Status::OK;
     }
 };
@@ -0,0 +1,45 @@
+// Joins the segments of a segmented recording into one video without re-encoding.
+// Usage: siphon_stitch <session_dir | segments.ffconcat> [output]
+// The default output is video.mp4 (video.mkv for FFV1) in the session directory.
+
+#include "segment_stitcher.h"
+#include <filesystem>
+#include <iostream>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: siphon_stitch <session_dir | segments.ffconcat> [output]\n";
+        return 2;
+    }
+
+    fs::path playlist = argv[1];
+    if (fs::is_directory(playlist)) {
+        playlist /= "segments.ffconcat";
+    }
+
+    std::string output;
+    if (argc > 2) {
+        output = argv[2];
+    } else {
+        std::vector<SegmentStitcher::Entry> entries;
+        std::string error;
+        if (!SegmentStitcher::ReadPlaylist(playlist.string(), entries, error)) {
+            spdlog::error("{}", error);
+            return 1;
+        }
+        output = (playlist.parent_path() /
+                  ("video" + fs::path(entries.front().file).extension().string()))
+                     .string();
+    }
+
+    std::string error;
+    if (!SegmentStitcher::Stitch(playlist.string(), output, error)) {
+        spdlog::error("Stitch failed: {}", error);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,357 @@
+#include "stream_encoder.h"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+
+// Packets buffered per viewer before it is considered behind and resynced on a keyframe
+constexpr size_t kMaxViewerPackets = 30;
+
+std::string AvError(int ret) {
+    char errbuf[AV_ERROR_MAX_STRING_SIZE];
+    av_strerror(ret, errbuf, sizeof(errbuf));
+    return errbuf;
+}
+
+} // namespace
+
+std::string StreamEncoderConfig::Key() const {
+    return codec + "/gop" + std::to_string(gopSize) + "/crf" + std::to_string(crf) + "/" + preset +
+           "/" + std::to_string(spec.width) + "x" + std::to_string(spec.height) + "/" +
+           (spec.filter == ResizeFilter::Box ? "box" : "bilinear") + "/roi" +
+           std::to_string(spec.region.x) + "," + std::to_string(spec.region.y) + "," +
+           std::to_string(spec.region.width) + "x" + std::to_string(spec.region.height) + "/fps" +
+           std::to_string(rateLimit.maxFps) + "/n" + std::to_string(rateLimit.everyNthFrame);
+}
+
+StreamEncoder::StreamEncoder(FrameBroadcaster *broadcaster, const StreamEncoderConfig &config)
+    : broadcaster_(broadcaster), config_(config), subscriptionId_(0), hasPendingFrame_(false),
+      shouldStop_(false), isRunning_(false), keyframeRequested_(false), codecContext_(nullptr),
+      swsContext_(nullptr), yuvFrame_(nullptr), packet_(nullptr), sourceWidth_(0),
+      sourceHeight_(0), firstFrameTimestamp_(-1), nextViewerId_(1), packetsPublished_(0) {
+    config_.spec.pixelFormat = PixelFormat::BGRA; // Encoder consumes BGRA
+}
+
+StreamEncoder::~StreamEncoder() { Stop(); }
+
+bool StreamEncoder::Start() {
+    if (isRunning_) {
+        return true;
+    }
+
+    shouldStop_ = false;
+    encoderThread_ = std::thread(&StreamEncoder::EncoderThread, this);
+    subscriptionId_ =
+        broadcaster_->Subscribe([this](const CapturedFrame &frame) { OnFrame(frame); },
+                                config_.spec, config_.rateLimit);
+    isRunning_ = true;
+
+    spdlog::info("StreamEncoder started: {}", config_.Key());
+    return true;
+}
+
+void StreamEncoder::Stop() {
+    if (!isRunning_) {
+        return;
+    }
+
+    broadcaster_->Unsubscribe(subscriptionId_);
+
+    shouldStop_ = true;
+    frameCv_.notify_all();
+    if (encoderThread_.joinable()) {
+        encoderThread_.join();
+    }
+    CloseCodec();
+
+    isRunning_ = false;
+    packetCv_.notify_all();
+    spdlog::info("StreamEncoder stopped: {}", config_.Key());
+}
+
+uint64_t StreamEncoder::AddViewer() {
+    uint64_t viewerId;
+    {
+        std::lock_guard<std::mutex> lock(viewersMutex_);
+        viewerId = nextViewerId_++;
+        viewers_[viewerId].forcedKeyframeAt = packetsPublished_;
+    }
+
+    // Late joiners get an IDR instead of waiting for the next periodic keyframe
+    RequestKeyframe();
+    return viewerId;
+}
+
+void StreamEncoder::RemoveViewer(uint64_t viewerId) {
+    std::lock_guard<std::mutex> lock(viewersMutex_);
+    viewers_.erase(viewerId);
+}
+
+void StreamEncoder::ResyncViewer(uint64_t viewerId) {
+    {
+        std::lock_guard<std::mutex> lock(viewersMutex_);
+        auto it = viewers_.find(viewerId);
+        if (it == viewers_.end()) {
+            return;
+        }
+        it->second.packets.clear();
+        it->second.waitingForKeyframe = true;
+        if (!MayForceKeyframe(it->second)) {
+            return; // Waits for the next periodic (or another viewer's) keyframe
+        }
+    }
+    RequestKeyframe();
+}
+
+// Called with viewersMutex_ held
+bool StreamEncoder::MayForceKeyframe(Viewer &viewer) {
+    const uint64_t gop = static_cast<uint64_t>(std::max(config_.gopSize, 1));
+    if (packetsPublished_ - viewer.forcedKeyframeAt < gop) {
+        return false;
+    }
+    viewer.forcedKeyframeAt = packetsPublished_;
+    return true;
+}
+
+bool StreamEncoder::NextPacket(uint64_t viewerId, EncodedPacket &out,
+                               std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(viewersMutex_);
+    auto it = viewers_.find(viewerId);
+    if (it == viewers_.end()) {
+        return false;
+    }
+
+    Viewer &viewer = it->second;
+    if (!packetCv_.wait_for(lock, timeout,
+                            [&] { return !viewer.packets.empty() || !isRunning_; })) {
+        return false;
+    }
+    if (viewer.packets.empty()) {
+        return false;
+    }
+
+    out = std::move(viewer.packets.front());
+    viewer.packets.pop_front();
+    return true;
+}
+
+void StreamEncoder::OnFrame(const CapturedFrame &frame) {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    pendingFrame_ = frame;
+    hasPendingFrame_ = true;
+    frameCv_.notify_one();
+}
+
+void StreamEncoder::EncoderThread() {
+    while (true) {
+        CapturedFrame frame;
+        {
+            std::unique_lock<std::mutex> lock(frameMutex_);
+            frameCv_.wait(lock, [this] { return hasPendingFrame_ || shouldStop_; });
+            if (shouldStop_) {
+                break;
+            }
+            frame = std::move(pendingFrame_);
+            hasPendingFrame_ = false;
+        }
+
+        if (!EncodeInternal(frame)) {
+            spdlog::error("StreamEncoder: failed to encode frame {}", frame.frameNumber);
+        }
+    }
+}
+
+bool StreamEncoder::OpenCodec(int width, int height) {
+    CloseCodec();
+
+    const AVCodec *codec = avcodec_find_encoder(config_.codec == "hevc" ? AV_CODEC_ID_HEVC
+                                                                        : AV_CODEC_ID_H264);
+    if (!codec) {
+        spdlog::error("{} encoder not found", config_.codec);
+        return false;
+    }
+
+    codecContext_ = avcodec_alloc_context3(codec);
+    if (!codecContext_) {
+        spdlog::error("Could not allocate codec context");
+        return false;
+    }
+
+    // 4:2:0 needs even dimensions; an odd last row/column is cropped, not scaled away
+    int encodedWidth = width & ~1;
+    int encodedHeight = height & ~1;
+
+    codecContext_->width = encodedWidth;
+    codecContext_->height = encodedHeight;
+    codecContext_->time_base = AVRational{1, 1000000}; // Microsecond time base
+    codecContext_->framerate = AVRational{0, 1};       // Variable framerate
+    codecContext_->pix_fmt = AV_PIX_FMT_YUV420P;
+    codecContext_->gop_size = config_.gopSize;
+    codecContext_->max_b_frames = 0; // Every packet is decodable on arrival
+
+    // No GLOBAL_HEADER flag: parameter sets are repeated in-band on every keyframe, so any
+    // keyframe is a valid entry point for a viewer
+    av_opt_set(codecContext_->priv_data, "preset", config_.preset.c_str(), 0);
+    av_opt_set(codecContext_->priv_data, "tune", "zerolatency", 0);
+    av_opt_set(codecContext_->priv_data, "crf", std::to_string(config_.crf).c_str(), 0);
+    av_opt_set(codecContext_->priv_data, "forced-idr", "1", 0); // Forced I-frames become IDRs
+
+    int ret = avcodec_open2(codecContext_, codec, nullptr);
+    if (ret < 0) {
+        spdlog::error("Could not open {} codec: {}", config_.codec, AvError(ret));
+        CloseCodec();
+        return false;
+    }
+
+    yuvFrame_ = av_frame_alloc();
+    packet_ = av_packet_alloc();
+    if (!yuvFrame_ || !packet_) {
+        spdlog::error("Could not allocate frame/packet");
+        CloseCodec();
+        return false;
+    }
+
+    yuvFrame_->format = codecContext_->pix_fmt;
+    yuvFrame_->width = encodedWidth;
+    yuvFrame_->height = encodedHeight;
+    if (av_frame_get_buffer(yuvFrame_, 0) < 0) {
+        spdlog::error("Could not allocate frame buffer");
+        CloseCodec();
+        return false;
+    }
+
+    // Same size in and out, so only colour conversion runs; EncodeInternal keeps the source
+    // stride, which leaves the cropped column out of every row
+    swsContext_ = sws_getContext(encodedWidth, encodedHeight, AV_PIX_FMT_BGRA, encodedWidth,
+                                 encodedHeight, AV_PIX_FMT_YUV420P, SWS_BILINEAR, nullptr,
+                                 nullptr, nullptr);
+    if (!swsContext_) {
+        spdlog::error("Could not initialize swscale context");
+        CloseCodec();
+        return false;
+    }
+
+    sourceWidth_ = width;
+    sourceHeight_ = height;
+    firstFrameTimestamp_ = -1;
+
+    spdlog::info("StreamEncoder opened {} {}x{} (gop={}, crf={}, preset={})", config_.codec,
+                 encodedWidth, encodedHeight, config_.gopSize, config_.crf, config_.preset);
+    return true;
+}
+
+void StreamEncoder::CloseCodec() {
+    if (swsContext_) {
+        sws_freeContext(swsContext_);
+        swsContext_ = nullptr;
+    }
+    if (yuvFrame_) {
+        av_frame_free(&yuvFrame_);
+    }
+    if (packet_) {
+        av_packet_free(&packet_);
+    }
+    if (codecContext_) {
+        avcodec_free_context(&codecContext_);
+    }
+    sourceWidth_ = 0;
+    sourceHeight_ = 0;
+}
+
+bool StreamEncoder::EncodeInternal(const CapturedFrame &frame) {
+    // (Re)open on the first frame and on capture size changes; the first frame is an IDR
+    if (!codecContext_ || frame.width != sourceWidth_ || frame.height != sourceHeight_) {
+        if (!OpenCodec(frame.width, frame.height)) {
+            return false;
+        }
+    }
+
+    int ret = av_frame_make_writable(yuvFrame_);
+    if (ret < 0) {
+        spdlog::error("Could not make frame writable");
+        return false;
+    }
+
+    const uint8_t *srcData[1] = {frame.pixels.data()};
+    int srcLinesize[1] = {frame.width * 4};
+    sws_scale(swsContext_, srcData, srcLinesize, 0, yuvFrame_->height, yuvFrame_->data,
+              yuvFrame_->linesize);
+
+    if (firstFrameTimestamp_ < 0) {
+        firstFrameTimestamp_ = frame.timestampUs;
+    }
+    yuvFrame_->pts = frame.timestampUs - firstFrameTimestamp_;
+    yuvFrame_->pict_type =
+        keyframeRequested_.exchange(false) ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+
+    ret = avcodec_send_frame(codecContext_, yuvFrame_);
+    if (ret < 0) {
+        spdlog::error("Error sending frame to encoder: {}", AvError(ret));
+        return false;
+    }
+
+    // zerolatency without B-frames: one packet per frame, available immediately
+    while (true) {
+        ret = avcodec_receive_packet(codecContext_, packet_);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            break;
+        } else if (ret < 0) {
+            spdlog::error("Error receiving packet from encoder: {}", AvError(ret));
+            return false;
+        }
+
+        EncodedPacket packet;
+        packet.data = std::make_shared<std::vector<uint8_t>>(packet_->data,
+                                                             packet_->data + packet_->size);
+        packet.keyframe = (packet_->flags & AV_PKT_FLAG_KEY) != 0;
+        packet.frameNumber = frame.frameNumber;
+        packet.timestampUs = frame.timestampUs;
+        packet.width = codecContext_->width;
+        packet.height = codecContext_->height;
+        av_packet_unref(packet_);
+
+        Publish(std::move(packet));
+    }
+
+    return true;
+}
+
+void StreamEncoder::Publish(EncodedPacket packet) {
+    bool needKeyframe = false;
+    {
+        std::lock_guard<std::mutex> lock(viewersMutex_);
+        packetsPublished_++;
+        for (auto &[id, viewer] : viewers_) {
+            if (viewer.waitingForKeyframe) {
+                if (!packet.keyframe) {
+                    continue;
+                }
+                viewer.waitingForKeyframe = false;
+            }
+
+            // A viewer that fell behind can't skip inter frames; drop its backlog and resync
+            if (viewer.packets.size() >= kMaxViewerPackets) {
+                spdlog::warn("StreamEncoder: viewer {} fell behind, resyncing on next keyframe",
+                             id);
+                viewer.packets.clear();
+                viewer.waitingForKeyframe = true;
+                needKeyframe |= MayForceKeyframe(viewer);
+                continue;
+            }
+
+            viewer.packets.push_back(packet);
+        }
+    }
+    packetCv_.notify_all();
+
+    if (needKeyframe) {
+        RequestKeyframe();
+    }
+}
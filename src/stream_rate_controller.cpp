@@ -0,0 +1,120 @@
+#include "stream_rate_controller.h"
+#include <algorithm>
+#include <chrono>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+constexpr double kEwmaWeight = 0.2;
+constexpr int kQualityStep = 10;
+constexpr float kScaleStep = 0.125f;
+constexpr int kFramesBetweenSteps = 10; // Let a step take effect before judging it
+constexpr int kCalmFramesToStepUp = 30;
+
+} // namespace
+
+StreamRateController::StreamRateController(const RateControlOptions &options, int quality)
+    : options_(options), maxQuality_(quality), quality_(quality), scale_(1.0f), writeUsEwma_(0.0),
+      bytesPerUsEwma_(0.0), framesSinceStep_(0), calmFrames_(0), droppedFrames_(0) {
+    options_.minQuality =
+        options_.minQuality > 0 ? std::min(options_.minQuality, quality) : quality;
+    options_.minScale = std::clamp(options_.minScale, 0.1f, 1.0f);
+}
+
+int64_t StreamRateController::NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+bool StreamRateController::ShouldSend(int64_t timestampUs, size_t bytes) {
+    if (options_.maxLatencyUs <= 0) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Expected delivery time: age of the frame plus its write, at the measured throughput when
+    // the size is known and a typical write otherwise
+    int64_t ageUs = NowUs() - timestampUs;
+    double writeUs = bytes > 0 && bytesPerUsEwma_ > 0.0 ? bytes / bytesPerUsEwma_ : writeUsEwma_;
+    if (ageUs + static_cast<int64_t>(writeUs) <= options_.maxLatencyUs) {
+        return true;
+    }
+
+    droppedFrames_++;
+    Adapt(true);
+    return false;
+}
+
+void StreamRateController::OnWrite(size_t bytes, int64_t writeUs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    writeUsEwma_ = writeUsEwma_ == 0.0 ? static_cast<double>(writeUs)
+                                       : writeUsEwma_ + kEwmaWeight * (writeUs - writeUsEwma_);
+    if (writeUs > 0) {
+        double bytesPerUs = static_cast<double>(bytes) / writeUs;
+        bytesPerUsEwma_ = bytesPerUsEwma_ == 0.0
+                              ? bytesPerUs
+                              : bytesPerUsEwma_ + kEwmaWeight * (bytesPerUs - bytesPerUsEwma_);
+    }
+
+    int64_t now = NowUs();
+    sendTimesUs_.push_back(now);
+    while (!sendTimesUs_.empty() && now - sendTimesUs_.front() > 1000000) {
+        sendTimesUs_.pop_front();
+    }
+
+    // Writes eating half the budget mean the transport is backing up
+    if (options_.maxLatencyUs > 0) {
+        Adapt(writeUsEwma_ > options_.maxLatencyUs / 2);
+    }
+}
+
+float StreamRateController::GetEffectiveFps() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t now = NowUs();
+    while (!sendTimesUs_.empty() && now - sendTimesUs_.front() > 1000000) {
+        sendTimesUs_.pop_front();
+    }
+    return static_cast<float>(sendTimesUs_.size());
+}
+
+void StreamRateController::Adapt(bool congested) {
+    framesSinceStep_++;
+    calmFrames_ = congested ? 0 : calmFrames_ + 1;
+    if (framesSinceStep_ < kFramesBetweenSteps) {
+        return;
+    }
+
+    int quality = quality_;
+    float scale = scale_;
+
+    if (congested) {
+        // Cheaper bytes first, then fewer pixels
+        if (quality > options_.minQuality) {
+            quality = std::max(quality - kQualityStep, options_.minQuality);
+        } else if (scale > options_.minScale) {
+            scale = std::max(scale - kScaleStep, options_.minScale);
+        } else {
+            return;
+        }
+    } else if (calmFrames_ >= kCalmFramesToStepUp && writeUsEwma_ < options_.maxLatencyUs / 8) {
+        // Recover in reverse order
+        if (scale < 1.0f) {
+            scale = std::min(scale + kScaleStep, 1.0f);
+        } else if (quality < maxQuality_) {
+            quality = std::min(quality + kQualityStep, maxQuality_);
+        } else {
+            return;
+        }
+        calmFrames_ = 0;
+    } else {
+        return;
+    }
+
+    quality_ = quality;
+    scale_ = scale;
+    framesSinceStep_ = 0;
+    spdlog::debug("Stream rate control: quality={}, scale={:.3f} (write {:.1f} ms, {:.1f} MB/s)",
+                  quality, scale, writeUsEwma_ / 1000.0, bytesPerUsEwma_);
+}
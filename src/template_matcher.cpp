@@ -0,0 +1,631 @@
+#include "template_matcher.h"
+#include "cpu_features.h"
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+
+namespace {
+
+constexpr int kMaxPyramidLevels = 4;
+constexpr int kMinCoarseSide = 8;     // Auto levels keep the template's short side >= this
+constexpr int kCoarseCandidates = 3;  // Peaks carried from the coarsest level into refinement
+constexpr int kRefineRadius = 2;      // Search window (+/- pixels) at each finer level
+
+// Per-row kernels over n bytes of an image row (a) and a template row (b)
+
+uint32_t SadRowScalar(const uint8_t *a, const uint8_t *b, int n) {
+    uint32_t sad = 0;
+    for (int i = 0; i < n; ++i) {
+        sad += static_cast<uint32_t>(std::abs(a[i] - b[i]));
+    }
+    return sad;
+}
+
+uint64_t DotRowScalar(const uint8_t *a, const uint8_t *b, int n) {
+    uint64_t dot = 0;
+    for (int i = 0; i < n; ++i) {
+        dot += static_cast<uint32_t>(a[i]) * b[i];
+    }
+    return dot;
+}
+
+void StatsRowScalar(const uint8_t *a, const uint8_t *b, int n, uint64_t &sum, uint64_t &sumSq,
+                    uint64_t &dot) {
+    for (int i = 0; i < n; ++i) {
+        sum += a[i];
+        sumSq += static_cast<uint32_t>(a[i]) * a[i];
+        dot += static_cast<uint32_t>(a[i]) * b[i];
+    }
+}
+
+SIPHON_TARGET_AVX2 uint32_t SadRowAVX2(const uint8_t *a, const uint8_t *b, int n) {
+    __m256i acc = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+    }
+    __m128i acc128 =
+        _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    if (i + 16 <= n) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        acc128 = _mm_add_epi64(acc128, _mm_sad_epu8(va, vb));
+        i += 16;
+    }
+    uint32_t sad = static_cast<uint32_t>(_mm_cvtsi128_si64(acc128) +
+                                         _mm_extract_epi64(acc128, 1));
+    return sad + SadRowScalar(a + i, b + i, n - i);
+}
+
+// 16 bytes zero-extended to 16-bit lanes
+SIPHON_TARGET_AVX2 __m256i Widen16(const uint8_t *p) {
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+
+// Sum of the eight 32-bit lanes
+SIPHON_TARGET_AVX2 uint64_t HorizontalSum(__m256i v) {
+    alignas(32) uint32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), v);
+    uint64_t sum = 0;
+    for (uint32_t lane : lanes) {
+        sum += lane;
+    }
+    return sum;
+}
+
+// 16 pixels per step; each madd lane adds at most 2 * 255^2, so a u32 lane holds 16k steps
+SIPHON_TARGET_AVX2 uint64_t DotRowAVX2(const uint8_t *a, const uint8_t *b, int n) {
+    __m256i acc = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = Widen16(a + i);
+        __m256i vb = Widen16(b + i);
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+    return HorizontalSum(acc) + DotRowScalar(a + i, b + i, n - i);
+}
+
+SIPHON_TARGET_AVX2 void StatsRowAVX2(const uint8_t *a, const uint8_t *b, int n, uint64_t &sum,
+                                     uint64_t &sumSq, uint64_t &dot) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i accSum = _mm256_setzero_si256();
+    __m256i accSq = _mm256_setzero_si256();
+    __m256i accDot = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = Widen16(a + i);
+        __m256i vb = Widen16(b + i);
+        accSum = _mm256_add_epi32(accSum, _mm256_madd_epi16(va, ones));
+        accSq = _mm256_add_epi32(accSq, _mm256_madd_epi16(va, va));
+        accDot = _mm256_add_epi32(accDot, _mm256_madd_epi16(va, vb));
+    }
+    sum += HorizontalSum(accSum);
+    sumSq += HorizontalSum(accSq);
+    dot += HorizontalSum(accDot);
+    StatsRowScalar(a + i, b + i, n - i, sum, sumSq, dot);
+}
+
+// Exhaustive searches vectorize across positions instead: one template pixel is broadcast and
+// compared against the image pixels under 16 (NCC) or 32 (SAD) neighbouring windows at once, which
+// keeps the lanes busy for the narrow templates of coarse pyramid levels.
+
+// Dot products for windows x0..x0+15; origin points at (x0, y). Lanes are u32, so the template
+// may have at most 66051 pixels (255^2 per pixel).
+SIPHON_TARGET_AVX2 void DotPositionsAVX2(const uint8_t *origin, size_t stride, const uint8_t *templ,
+                                         int tw, int th, uint32_t out[16]) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i accLo = zero; // Windows 0-3, 8-11
+    __m256i accHi = zero; // Windows 4-7, 12-15
+    for (int ty = 0; ty < th; ++ty) {
+        const uint8_t *row = origin + ty * stride;
+        const uint8_t *t = templ + static_cast<size_t>(ty) * tw;
+        int tx = 0;
+        for (; tx + 1 < tw; tx += 2) {
+            __m256i v0 = Widen16(row + tx);
+            __m256i v1 = Widen16(row + tx + 1);
+            __m256i pair = _mm256_set1_epi32(t[tx] | (t[tx + 1] << 16));
+            accLo = _mm256_add_epi32(accLo, _mm256_madd_epi16(_mm256_unpacklo_epi16(v0, v1), pair));
+            accHi = _mm256_add_epi32(accHi, _mm256_madd_epi16(_mm256_unpackhi_epi16(v0, v1), pair));
+        }
+        if (tx < tw) {
+            __m256i v0 = Widen16(row + tx);
+            __m256i single = _mm256_set1_epi32(t[tx]);
+            accLo =
+                _mm256_add_epi32(accLo, _mm256_madd_epi16(_mm256_unpacklo_epi16(v0, zero), single));
+            accHi =
+                _mm256_add_epi32(accHi, _mm256_madd_epi16(_mm256_unpackhi_epi16(v0, zero), single));
+        }
+    }
+    alignas(32) uint32_t lo[8];
+    alignas(32) uint32_t hi[8];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lo), accLo);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(hi), accHi);
+    for (int i = 0; i < 4; ++i) {
+        out[i] = lo[i];
+        out[4 + i] = hi[i];
+        out[8 + i] = lo[4 + i];
+        out[12 + i] = hi[4 + i];
+    }
+}
+
+// Widen 16-bit SAD partials into acc (windows 0-7, 16-23, 8-15, 24-31) and clear them
+SIPHON_TARGET_AVX2 void FlushSadPartials(__m256i acc[4], __m256i &sumLo, __m256i &sumHi) {
+    acc[0] = _mm256_add_epi32(acc[0], _mm256_cvtepu16_epi32(_mm256_castsi256_si128(sumLo)));
+    acc[1] =
+        _mm256_add_epi32(acc[1], _mm256_cvtepu16_epi32(_mm256_extracti128_si256(sumLo, 1)));
+    acc[2] = _mm256_add_epi32(acc[2], _mm256_cvtepu16_epi32(_mm256_castsi256_si128(sumHi)));
+    acc[3] =
+        _mm256_add_epi32(acc[3], _mm256_cvtepu16_epi32(_mm256_extracti128_si256(sumHi, 1)));
+    sumLo = sumHi = _mm256_setzero_si256();
+}
+
+// SADs for windows x0..x0+31; origin points at (x0, y)
+SIPHON_TARGET_AVX2 void SadPositionsAVX2(const uint8_t *origin, size_t stride, const uint8_t *templ,
+                                         int tw, int th, uint32_t out[32]) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc[4] = {zero, zero, zero, zero};
+    __m256i sumLo = zero;
+    __m256i sumHi = zero;
+    int pending = 0;
+    for (int ty = 0; ty < th; ++ty) {
+        const uint8_t *row = origin + ty * stride;
+        const uint8_t *t = templ + static_cast<size_t>(ty) * tw;
+        for (int tx = 0; tx < tw; ++tx) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + tx));
+            __m256i tv = _mm256_set1_epi8(static_cast<char>(t[tx]));
+            __m256i diff = _mm256_or_si256(_mm256_subs_epu8(v, tv), _mm256_subs_epu8(tv, v));
+            sumLo = _mm256_add_epi16(sumLo, _mm256_unpacklo_epi8(diff, zero));
+            sumHi = _mm256_add_epi16(sumHi, _mm256_unpackhi_epi8(diff, zero));
+            // 16-bit lanes hold 257 differences of up to 255
+            if (++pending == 257) {
+                FlushSadPartials(acc, sumLo, sumHi);
+                pending = 0;
+            }
+        }
+    }
+    FlushSadPartials(acc, sumLo, sumHi);
+    alignas(32) uint32_t lanes[4][8];
+    for (int i = 0; i < 4; ++i) {
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[i]), acc[i]);
+    }
+    for (int i = 0; i < 8; ++i) {
+        out[i] = lanes[0][i];
+        out[16 + i] = lanes[1][i];
+        out[8 + i] = lanes[2][i];
+        out[24 + i] = lanes[3][i];
+    }
+}
+
+// Halve an image with a 2x2 box filter (odd trailing row/column dropped)
+void Downsample(const GrayImage &src, GrayImage &dst) {
+    dst.width = src.width / 2;
+    dst.height = src.height / 2;
+    dst.pixels.resize(static_cast<size_t>(dst.width) * dst.height);
+    for (int y = 0; y < dst.height; ++y) {
+        const uint8_t *r0 = src.pixels.data() + static_cast<size_t>(2 * y) * src.width;
+        const uint8_t *r1 = r0 + src.width;
+        uint8_t *out = dst.pixels.data() + static_cast<size_t>(y) * dst.width;
+        for (int x = 0; x < dst.width; ++x) {
+            out[x] = static_cast<uint8_t>((r0[2 * x] + r0[2 * x + 1] + r1[2 * x] +
+                                           r1[2 * x + 1] + 2) >> 2);
+        }
+    }
+}
+
+// pyramid[0] is full resolution; adds levels until pyramid[levels] exists
+void ExtendPyramid(std::vector<GrayImage> &pyramid, int levels) {
+    while (static_cast<int>(pyramid.size()) <= levels) {
+        GrayImage next;
+        Downsample(pyramid.back(), next);
+        pyramid.push_back(std::move(next));
+    }
+}
+
+int AutoLevels(int width, int height) {
+    int levels = 0;
+    while (levels < kMaxPyramidLevels &&
+           (std::min(width, height) >> (levels + 1)) >= kMinCoarseSide) {
+        levels++;
+    }
+    return levels;
+}
+
+// Scores template placements in one pyramid level
+class Scorer {
+  public:
+    Scorer(const GrayImage &image, const GrayImage &templ, MatchMethod method)
+        : image_(image), templ_(templ), method_(method), avx2_(FrameConverter::IsSimdEnabled()),
+          count_(static_cast<double>(templ.width) * templ.height) {
+        uint64_t sum = 0, sumSq = 0;
+        for (uint8_t v : templ.pixels) {
+            sum += v;
+            sumSq += static_cast<uint32_t>(v) * v;
+        }
+        templSum_ = static_cast<double>(sum);
+        templVar_ = static_cast<double>(sumSq) - templSum_ * templSum_ / count_;
+    }
+
+    int MaxX() const { return image_.width - templ_.width; }
+    int MaxY() const { return image_.height - templ_.height; }
+
+    // Window sums from integral images, for exhaustive NCC searches
+    void BuildIntegral() {
+        if (method_ != MatchMethod::NCC) {
+            return;
+        }
+        const size_t stride = static_cast<size_t>(image_.width) + 1;
+        integral_.assign(stride * (image_.height + 1), 0);
+        integralSq_.assign(stride * (image_.height + 1), 0);
+        for (int y = 0; y < image_.height; ++y) {
+            const uint8_t *row = image_.pixels.data() + static_cast<size_t>(y) * image_.width;
+            uint64_t rowSum = 0, rowSq = 0;
+            for (int x = 0; x < image_.width; ++x) {
+                rowSum += row[x];
+                rowSq += static_cast<uint32_t>(row[x]) * row[x];
+                integral_[(y + 1) * stride + x + 1] = integral_[y * stride + x + 1] + rowSum;
+                integralSq_[(y + 1) * stride + x + 1] = integralSq_[y * stride + x + 1] + rowSq;
+            }
+        }
+    }
+
+    float Score(int x, int y) const {
+        const uint8_t *origin = image_.pixels.data() + static_cast<size_t>(y) * image_.width + x;
+        const int tw = templ_.width;
+
+        if (method_ == MatchMethod::SAD) {
+            uint64_t sad = 0;
+            for (int ty = 0; ty < templ_.height; ++ty) {
+                const uint8_t *a = origin + static_cast<size_t>(ty) * image_.width;
+                const uint8_t *b = templ_.pixels.data() + static_cast<size_t>(ty) * tw;
+                sad += avx2_ ? SadRowAVX2(a, b, tw) : SadRowScalar(a, b, tw);
+            }
+            return SadScore(sad);
+        }
+
+        uint64_t sum = 0, sumSq = 0, dot = 0;
+        for (int ty = 0; ty < templ_.height; ++ty) {
+            const uint8_t *a = origin + static_cast<size_t>(ty) * image_.width;
+            const uint8_t *b = templ_.pixels.data() + static_cast<size_t>(ty) * tw;
+            if (!integral_.empty()) {
+                dot += avx2_ ? DotRowAVX2(a, b, tw) : DotRowScalar(a, b, tw);
+            } else if (avx2_) {
+                StatsRowAVX2(a, b, tw, sum, sumSq, dot);
+            } else {
+                StatsRowScalar(a, b, tw, sum, sumSq, dot);
+            }
+        }
+        if (!integral_.empty()) {
+            WindowSums(x, y, sum, sumSq);
+        }
+        return NccScore(sum, sumSq, dot);
+    }
+
+    // Scores of every window in row y (MaxX() + 1 values)
+    void ScoreRow(int y, std::vector<float> &scores) const {
+        scores.resize(MaxX() + 1);
+        const size_t stride = image_.width;
+        const uint8_t *row = image_.pixels.data() + static_cast<size_t>(y) * stride;
+        int x = 0;
+        if (avx2_ && method_ == MatchMethod::SAD) {
+            uint32_t sads[32];
+            for (; x + 31 <= MaxX(); x += 32) {
+                SadPositionsAVX2(row + x, stride, templ_.pixels.data(), templ_.width,
+                                 templ_.height, sads);
+                for (int i = 0; i < 32; ++i) {
+                    scores[x + i] = SadScore(sads[i]);
+                }
+            }
+        } else if (avx2_ && !integral_.empty() && count_ <= 66051) {
+            uint32_t dots[16];
+            for (; x + 15 <= MaxX(); x += 16) {
+                DotPositionsAVX2(row + x, stride, templ_.pixels.data(), templ_.width,
+                                 templ_.height, dots);
+                for (int i = 0; i < 16; ++i) {
+                    uint64_t sum, sumSq;
+                    WindowSums(x + i, y, sum, sumSq);
+                    scores[x + i] = NccScore(sum, sumSq, dots[i]);
+                }
+            }
+        }
+        for (; x <= MaxX(); ++x) {
+            scores[x] = Score(x, y);
+        }
+    }
+
+  private:
+    float SadScore(uint64_t sad) const { return 1.0f - static_cast<float>(sad / (255.0 * count_)); }
+
+    float NccScore(uint64_t sum, uint64_t sumSq, uint64_t dot) const {
+        const double imageSum = static_cast<double>(sum);
+        const double imageVar = static_cast<double>(sumSq) - imageSum * imageSum / count_;
+        if (imageVar <= 1e-6 || templVar_ <= 1e-6) {
+            return 0.0f; // Flat window: no correlation defined
+        }
+        const double numerator = static_cast<double>(dot) - imageSum * templSum_ / count_;
+        return static_cast<float>(
+            std::clamp(numerator / std::sqrt(imageVar * templVar_), -1.0, 1.0));
+    }
+
+    void WindowSums(int x, int y, uint64_t &sum, uint64_t &sumSq) const {
+        const size_t stride = static_cast<size_t>(image_.width) + 1;
+        const size_t top = y * stride, bottom = (y + templ_.height) * stride;
+        const size_t left = x, right = x + templ_.width;
+        sum = integral_[bottom + right] - integral_[bottom + left] - integral_[top + right] +
+              integral_[top + left];
+        sumSq = integralSq_[bottom + right] - integralSq_[bottom + left] -
+                integralSq_[top + right] + integralSq_[top + left];
+    }
+
+    const GrayImage &image_;
+    const GrayImage &templ_;
+    MatchMethod method_;
+    bool avx2_;
+    double count_;
+    double templSum_;
+    double templVar_;
+    std::vector<uint64_t> integral_;
+    std::vector<uint64_t> integralSq_;
+};
+
+struct Candidate {
+    float score;
+    int32_t x;
+    int32_t y;
+};
+
+// Keep the best few peaks, at least half a template apart
+void AddCandidate(std::vector<Candidate> &candidates, const Candidate &c, int minDx, int minDy) {
+    for (Candidate &existing : candidates) {
+        if (std::abs(existing.x - c.x) < minDx && std::abs(existing.y - c.y) < minDy) {
+            if (c.score > existing.score) {
+                existing = c;
+                // Bubble the improved peak up to keep the list sorted
+                for (size_t i = &existing - candidates.data(); i > 0; --i) {
+                    if (candidates[i].score <= candidates[i - 1].score) {
+                        break;
+                    }
+                    std::swap(candidates[i], candidates[i - 1]);
+                }
+            }
+            return;
+        }
+    }
+    if (static_cast<int>(candidates.size()) == kCoarseCandidates) {
+        if (c.score <= candidates.back().score) {
+            return;
+        }
+        candidates.pop_back();
+    }
+    auto it = std::find_if(candidates.begin(), candidates.end(),
+                           [&](const Candidate &existing) { return c.score > existing.score; });
+    candidates.insert(it, c);
+}
+
+// Exhaustive search at the coarsest level, then refine each peak down the pyramid. Both pyramids
+// must have at least levels + 1 entries.
+float SearchPyramid(const std::vector<GrayImage> &image, const std::vector<GrayImage> &templ,
+                    MatchMethod method, int levels, int32_t &bestX, int32_t &bestY) {
+    bestX = bestY = 0;
+    if (templ[0].width > image[0].width || templ[0].height > image[0].height) {
+        return -1.0f;
+    }
+
+    std::vector<Candidate> candidates;
+    {
+        Scorer scorer(image[levels], templ[levels], method);
+        scorer.BuildIntegral();
+        const int minDx = std::max(1, templ[levels].width / 2);
+        const int minDy = std::max(1, templ[levels].height / 2);
+        std::vector<float> scores;
+        for (int y = 0; y <= scorer.MaxY(); ++y) {
+            scorer.ScoreRow(y, scores);
+            for (int x = 0; x <= scorer.MaxX(); ++x) {
+                float score = scores[x];
+                if (static_cast<int>(candidates.size()) < kCoarseCandidates ||
+                    score > candidates.back().score) {
+                    AddCandidate(candidates, {score, x, y}, minDx, minDy);
+                }
+            }
+        }
+    }
+
+    float bestScore = -1.0f;
+    for (Candidate c : candidates) {
+        for (int level = levels - 1; level >= 0; --level) {
+            Scorer scorer(image[level], templ[level], method);
+            const int cx = c.x * 2, cy = c.y * 2;
+            c.score = -2.0f;
+            for (int y = std::max(0, cy - kRefineRadius);
+                 y <= std::min(scorer.MaxY(), cy + kRefineRadius); ++y) {
+                for (int x = std::max(0, cx - kRefineRadius);
+                     x <= std::min(scorer.MaxX(), cx + kRefineRadius); ++x) {
+                    float score = scorer.Score(x, y);
+                    if (score > c.score) {
+                        c = {score, x, y};
+                    }
+                }
+            }
+        }
+        if (c.score > bestScore) {
+            bestScore = c.score;
+            bestX = c.x;
+            bestY = c.y;
+        }
+    }
+    return bestScore;
+}
+
+} // namespace
+
+int32_t TemplateMatcher::AddTemplate(const TemplateSpec &spec, std::string &error) {
+    if (spec.width <= 0 || spec.height <= 0) {
+        error = "Template width and height must be > 0";
+        return -1;
+    }
+    if (spec.bgra.size() != static_cast<size_t>(spec.width) * spec.height * 4) {
+        error = "Template data must be width * height * 4 BGRA bytes";
+        return -1;
+    }
+    const FrameRegion &region = spec.searchRegion;
+    if (region.x < 0 || region.y < 0 || region.width < 0 || region.height < 0) {
+        error = "Search region must not be negative";
+        return -1;
+    }
+    if ((region.width > 0 && region.width < spec.width) ||
+        (region.height > 0 && region.height < spec.height)) {
+        error = "Search region is smaller than the template";
+        return -1;
+    }
+    if (spec.threshold < -1.0f || spec.threshold > 1.0f) {
+        error = "Threshold must be between -1 and 1";
+        return -1;
+    }
+
+    auto entry = std::make_shared<Template>();
+    entry->spec = spec;
+    entry->spec.bgra.clear();
+    entry->spec.bgra.shrink_to_fit();
+
+    GrayImage gray;
+    gray.width = spec.width;
+    gray.height = spec.height;
+    gray.pixels.resize(static_cast<size_t>(spec.width) * spec.height);
+    FrameConverter::BGRAToGray8(spec.bgra.data(), gray.pixels.data(), gray.pixels.size());
+
+    // Every level must keep at least 2 template pixels on its short side
+    int maxLevels = 0;
+    while ((std::min(spec.width, spec.height) >> (maxLevels + 1)) >= 2) {
+        maxLevels++;
+    }
+    entry->levels = spec.pyramidLevels < 0 ? AutoLevels(spec.width, spec.height)
+                                           : std::min(spec.pyramidLevels, maxLevels);
+    entry->pyramid.push_back(std::move(gray));
+    ExtendPyramid(entry->pyramid, entry->levels);
+
+    if (spec.method == MatchMethod::NCC) {
+        const auto &pixels = entry->pyramid[0].pixels;
+        auto [lo, hi] = std::minmax_element(pixels.begin(), pixels.end());
+        if (*lo == *hi) {
+            error = "Template has no contrast; use SAD matching for flat templates";
+            return -1;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    int32_t templateId = nextTemplateId_++;
+    templates_[templateId] = std::move(entry);
+    return templateId;
+}
+
+bool TemplateMatcher::RemoveTemplate(int32_t templateId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return templates_.erase(templateId) > 0;
+}
+
+bool TemplateMatcher::HasTemplate(int32_t templateId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return templates_.count(templateId) > 0;
+}
+
+size_t TemplateMatcher::GetTemplateCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return templates_.size();
+}
+
+void TemplateMatcher::Match(const uint8_t *bgra, int width, int height,
+                            const std::vector<int32_t> &templateIds,
+                            std::vector<TemplateMatch> &results) {
+    results.clear();
+
+    // Snapshot so matching runs without the lock; removed templates finish this frame
+    std::vector<std::pair<int32_t, std::shared_ptr<const Template>>> selected;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (templateIds.empty()) {
+            selected.assign(templates_.begin(), templates_.end());
+        } else {
+            for (int32_t id : templateIds) {
+                auto it = templates_.find(id);
+                if (it != templates_.end()) {
+                    selected.emplace_back(*it);
+                }
+            }
+        }
+    }
+
+    // Templates sharing a search region share its grayscale pyramid
+    std::map<FrameRegion, std::vector<GrayImage>> pyramids;
+    for (const auto &[templateId, entry] : selected) {
+        TemplateMatch match;
+        match.templateId = templateId;
+        match.name = entry->spec.name;
+        match.width = entry->spec.width;
+        match.height = entry->spec.height;
+
+        FrameRegion region;
+        if (!bgra ||
+            !FrameConverter::ResolveRegion(entry->spec.searchRegion, width, height, region) ||
+            region.width < match.width || region.height < match.height) {
+            results.push_back(match);
+            continue;
+        }
+
+        std::vector<GrayImage> &pyramid = pyramids[region];
+        if (pyramid.empty()) {
+            GrayImage gray;
+            FrameOutputSpec spec;
+            spec.pixelFormat = PixelFormat::GRAY8;
+            spec.region = region;
+            FrameConverter::Convert(bgra, width, height, spec, gray.pixels, gray.width,
+                                    gray.height);
+            pyramid.push_back(std::move(gray));
+        }
+        ExtendPyramid(pyramid, entry->levels);
+
+        int32_t x = 0, y = 0;
+        match.score =
+            SearchPyramid(pyramid, entry->pyramid, entry->spec.method, entry->levels, x, y);
+        match.x = region.x + x;
+        match.y = region.y + y;
+        match.matched = match.score >= entry->spec.threshold;
+        results.push_back(match);
+    }
+}
+
+float TemplateMatcher::FindBest(const GrayImage &image, const GrayImage &templ, MatchMethod method,
+                                int levels, int32_t &x, int32_t &y) {
+    x = y = 0;
+    if (templ.width <= 0 || templ.height <= 0 || templ.width > image.width ||
+        templ.height > image.height) {
+        return -1.0f;
+    }
+    if (levels < 0) {
+        levels = AutoLevels(templ.width, templ.height);
+    }
+    while (levels > 0 && (std::min(templ.width, templ.height) >> levels) < 2) {
+        levels--;
+    }
+
+    std::vector<GrayImage> imagePyramid{image};
+    std::vector<GrayImage> templPyramid{templ};
+    ExtendPyramid(imagePyramid, levels);
+    ExtendPyramid(templPyramid, levels);
+    return SearchPyramid(imagePyramid, templPyramid, method, levels, x, y);
+}
+
+bool TemplateMatcher::ParseMethod(const std::string &name, MatchMethod &method) {
+    if (name.empty() || name == "ncc") {
+        method = MatchMethod::NCC;
+    } else if (name == "sad") {
+        method = MatchMethod::SAD;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string TemplateMatcher::MethodName(MatchMethod method) {
+    return method == MatchMethod::SAD ? "sad" : "ncc";
+}
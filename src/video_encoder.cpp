@@ -1,19 +1,93 @@
 #include "video_encoder.h"
+#include <algorithm>
+#include <chrono>
 #include <spdlog/spdlog.h>
 
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/opt.h>
-#include <libswscale/swscale.h>
+}
+
+namespace {
+
+constexpr int kDegradeCrfStep = 4;        // CRF added per degrade level
+constexpr int kMaxDegradeLevel = 3;       // Up to base + 12
+constexpr int kCalmFramesToRecover = 150; // ~10 s at 15 fps with a short queue per level
+
+// FFV1 splits each frame into a grid of slices; only these counts are accepted
+constexpr int kFfv1SliceCounts[] = {4, 6, 9, 12, 16, 24, 30};
+constexpr int kFfv1DefaultSlices = 16;
+
+struct CodecDefaults {
+    const char *name;
+    const char *encoder; // FFmpeg encoder name
+    int crf;
+    const char *preset;
+};
+
+constexpr CodecDefaults kCodecs[] = {
+    {"h264", "libx264", 20, "veryfast"},
+    {"hevc", "libx265", 22, "fast"},
+    {"ffv1", "ffv1", -1, ""},
+    {"av1", "libsvtav1", 30, "8"},
+};
+
+const CodecDefaults *FindCodec(const std::string &name) {
+    for (const CodecDefaults &codec : kCodecs) {
+        if (name == codec.name) {
+            return &codec;
+        }
+    }
+    return nullptr;
+}
+
+// Push what the OS has cached for the file to disk. A separate descriptor is enough: the
+// flush covers the file, not the handle that wrote it.
+bool SyncFile(const std::string &path) {
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_WRONLY | _O_BINARY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = _commit(fd) == 0;
+    _close(fd);
+#else
+    int fd = open(path.c_str(), O_WRONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    close(fd);
+#endif
+    return ok;
+}
+
+} // namespace
+
+bool VideoEncoderConfig::IsSupportedCodec(const std::string &codec) {
+    return FindCodec(codec) != nullptr;
+}
+
+std::string VideoEncoderConfig::FileExtension(const std::string &codec) {
+    return codec == "ffv1" ? ".mkv" : ".mp4";
 }
 
 VideoEncoder::VideoEncoder()
     : width_(0), height_(0), fps_(60), formatContext_(nullptr), codecContext_(nullptr),
-      videoStream_(nullptr), swsContext_(nullptr), yuvFrame_(nullptr), packet_(nullptr),
-      shouldStop_(false), finalized_(false), framesEncoded_(0), firstFrameTimestamp_(-1),
-      lastFrameTimestamp_(-1) {}
+      videoStream_(nullptr), yuvFrame_(nullptr), packet_(nullptr), finalized_(false),
+      stopSync_(false), framesEncoded_(0), framesDropped_(0), lastEncodeMs_(0.0),
+      totalEncodeMs_(0.0), degradeLevel_(0), appliedDegradeLevel_(0), degradeRaisedAt_(0),
+      calmFrames_(0), firstFrameTimestamp_(-1), lastFrameTimestamp_(-1) {}
 
 VideoEncoder::~VideoEncoder() {
     if (!finalized_) {
@@ -21,39 +95,79 @@ VideoEncoder::~VideoEncoder() {
     }
 }
 
-bool VideoEncoder::Initialize(const std::string &outputPath, int width, int height, int fps) {
+bool VideoEncoder::Initialize(const std::string &outputPath, int width, int height, int fps,
+                              const VideoEncoderConfig &config,
+                              const EncoderQueueOptions &queueOptions) {
     outputPath_ = outputPath;
     width_ = width;
     height_ = height;
     fps_ = fps;
+    queueOptions_ = queueOptions;
+    queueOptions_.maxQueueFrames = std::max<size_t>(queueOptions_.maxQueueFrames, 1);
+
+    const CodecDefaults *defaults = FindCodec(config.codec);
+    if (!defaults) {
+        spdlog::error("Unsupported recording codec: {}", config.codec);
+        return false;
+    }
+    config_ = config;
+    if (config_.crf < 0) {
+        config_.crf = defaults->crf;
+    }
+    if (config_.preset.empty()) {
+        config_.preset = defaults->preset;
+    }
+    config_.fragmentMs = std::max(config_.fragmentMs, 100);
+    config_.syncIntervalMs = std::max(config_.syncIntervalMs, 0);
+
+    // Only libx264 picks up CRF changes mid-stream
+    if (queueOptions_.policy == QueueFullPolicy::Degrade && config_.codec != "h264") {
+        spdlog::warn("Queue policy 'degrade' needs h264, using 'drop_oldest' for {}",
+                     config_.codec);
+        queueOptions_.policy = QueueFullPolicy::DropOldest;
+    }
 
     if (!InitializeFFmpeg()) {
         return false;
     }
 
     // Start encoder thread
-    shouldStop_ = false;
+    frameQueue_ = std::make_unique<RingQueue<EncoderFrame, QueueConcurrency::Mpmc>>(
+        queueOptions_.maxQueueFrames);
     encoderThread_ = std::thread(&VideoEncoder::EncoderThread, this);
+    if (config_.fragmented && config_.syncIntervalMs > 0) {
+        stopSync_ = false;
+        syncThread_ = std::thread(&VideoEncoder::SyncThread, this);
+    }
 
     spdlog::info("VideoEncoder initialized: {}", outputPath_);
-    spdlog::info("Resolution: {}x{}, Codec: H.264 CRF-20 (~15fps)", width_, height_);
+    spdlog::info("Resolution: {}x{}, Codec: {} CRF {} preset '{}', threads {}/{} (frame/slice)",
+                 width_, height_, config_.codec, config_.crf, config_.preset, config_.frameThreads,
+                 config_.sliceThreads);
+    spdlog::info("Encoder queue: {} frames, policy {}", queueOptions_.maxQueueFrames,
+                 QueueFullPolicyName(queueOptions_.policy));
+    if (config_.fragmented) {
+        spdlog::info("Fragmented output: {} ms fragments, sync every {} ms", config_.fragmentMs,
+                     config_.syncIntervalMs);
+    }
 
     return true;
 }
 
 bool VideoEncoder::InitializeFFmpeg() {
     try {
-        // Allocate output context (MP4 format)
+        // Allocate output context (container from the file extension)
         avformat_alloc_output_context2(&formatContext_, nullptr, nullptr, outputPath_.c_str());
         if (!formatContext_) {
             spdlog::error("Could not create output context");
             return false;
         }
 
-        // Find H.264 codec
-        const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+        const char *encoderName = FindCodec(config_.codec)->encoder;
+        const AVCodec *codec = avcodec_find_encoder_by_name(encoderName);
         if (!codec) {
-            spdlog::error("H.264 codec not found. Please install FFmpeg with libx264 support.");
+            spdlog::error("Encoder {} not found. Please install FFmpeg with {} support.",
+                          encoderName, encoderName);
             return false;
         }
 
@@ -76,13 +190,17 @@ bool VideoEncoder::InitializeFFmpeg() {
         codecContext_->height = height_;
         codecContext_->time_base = AVRational{1, 1000000}; // Microsecond time base
         codecContext_->framerate = AVRational{0, 1};       // Variable framerate
-        codecContext_->pix_fmt = AV_PIX_FMT_YUV420P;
-        codecContext_->bit_rate = 8000000; // 8 Mbps bitrate
-        codecContext_->gop_size = 60;      // Keyframe every ~1 second
-
-        // H.264 settings optimized for 15fps recording
-        av_opt_set(codecContext_->priv_data, "preset", "veryfast", 0); // Fast encoding
-        av_opt_set(codecContext_->priv_data, "crf", "20", 0);          // Good quality
+        codecContext_->gop_size = 60;                      // Keyframe every ~1 second
+        // FFV1 stores the capture's RGB losslessly (BGRA without alpha); the rest use 4:2:0
+        codecContext_->pix_fmt =
+            config_.codec == "ffv1" ? AV_PIX_FMT_0RGB32 : AV_PIX_FMT_YUV420P;
+        if (config_.codec != "ffv1") {
+            codecContext_->colorspace = config_.colorMatrix == YuvMatrix::BT709
+                                            ? AVCOL_SPC_BT709
+                                            : AVCOL_SPC_SMPTE170M;
+            codecContext_->color_range = config_.fullRange ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+        }
+        ApplyCodecOptions();
 
         // Some formats require global headers
         if (formatContext_->oformat->flags & AVFMT_GLOBALHEADER) {
@@ -128,12 +246,16 @@ bool VideoEncoder::InitializeFFmpeg() {
             return false;
         }
 
-        // Initialize swscale context for BGRA -> YUV420P conversion
-        swsContext_ = sws_getContext(width_, height_, AV_PIX_FMT_BGRA, width_, height_,
-                                     AV_PIX_FMT_YUV420P, SWS_BILINEAR, nullptr, nullptr, nullptr);
-        if (!swsContext_) {
-            spdlog::error("Could not initialize swscale context");
-            return false;
+        // BGRA -> YUV420P conversion; FFV1's BGR0 input has the capture's byte layout
+        if (config_.codec != "ffv1") {
+            yuvConverter_ = std::make_unique<YuvConverter>(config_.colorMatrix, config_.fullRange,
+                                                           YuvLayout::I420,
+                                                           config_.convertThreads);
+            spdlog::info("YUV conversion: {} {} range, {} kernel, {} threads",
+                         YuvConverter::MatrixName(config_.colorMatrix),
+                         config_.fullRange ? "full" : "limited",
+                         YuvConverter::KernelName(yuvConverter_->GetKernel()),
+                         yuvConverter_->GetThreadCount());
         }
 
         // Open output file
@@ -147,8 +269,23 @@ bool VideoEncoder::InitializeFFmpeg() {
             }
         }
 
-        // Write header
-        ret = avformat_write_header(formatContext_, nullptr);
+        // Write header. Fragmented MP4 puts an empty moov up front and a moof per fragment,
+        // cut at keyframes or after fragmentMs, so no trailer is needed to play it back.
+        AVDictionary *muxerOptions = nullptr;
+        if (config_.fragmented) {
+            const int64_t fragmentUs = static_cast<int64_t>(config_.fragmentMs) * 1000;
+            if (config_.codec == "ffv1") {
+                av_dict_set(&muxerOptions, "cluster_time_limit",
+                            std::to_string(config_.fragmentMs).c_str(), 0);
+            } else {
+                av_dict_set(&muxerOptions, "movflags", "frag_keyframe+empty_moov+default_base_moof",
+                            0);
+                av_dict_set(&muxerOptions, "frag_duration", std::to_string(fragmentUs).c_str(), 0);
+            }
+        }
+        ret = avformat_write_header(formatContext_, &muxerOptions);
+        av_dict_free(&muxerOptions);
+        lastFlush_ = std::chrono::steady_clock::now();
         if (ret < 0) {
             char errbuf[AV_ERROR_MAX_STRING_SIZE];
             av_strerror(ret, errbuf, sizeof(errbuf));
@@ -156,7 +293,10 @@ bool VideoEncoder::InitializeFFmpeg() {
             return false;
         }
 
-        spdlog::info("FFmpeg initialized successfully with H.264 CRF-20 codec (~15fps)");
+        spdlog::info("FFmpeg initialized successfully with {} ({})", encoderName,
+                     codecContext_->thread_count > 0
+                         ? std::to_string(codecContext_->thread_count) + " threads"
+                         : "auto threads");
         return true;
 
     } catch (const std::exception &e) {
@@ -166,44 +306,142 @@ bool VideoEncoder::InitializeFFmpeg() {
     }
 }
 
+// Rate control, preset and threading for the selected codec (before avcodec_open2)
+void VideoEncoder::ApplyCodecOptions() {
+    void *priv = codecContext_->priv_data;
+    const std::string crf = std::to_string(config_.crf);
+
+    if (config_.codec == "h264") {
+        codecContext_->bit_rate = 8000000; // 8 Mbps cap, CRF takes precedence
+        av_opt_set(priv, "preset", config_.preset.c_str(), 0);
+        av_opt_set(priv, "crf", crf.c_str(), 0);
+        if (config_.zeroLatency) {
+            av_opt_set(priv, "tune", "zerolatency", 0);
+        }
+        // Sliced threads add no frame latency; frame threads scale further
+        if (config_.sliceThreads > 0) {
+            codecContext_->thread_type = FF_THREAD_SLICE;
+            codecContext_->thread_count = config_.sliceThreads;
+        } else if (config_.frameThreads > 0) {
+            codecContext_->thread_type = FF_THREAD_FRAME;
+            codecContext_->thread_count = config_.frameThreads;
+        }
+    } else if (config_.codec == "hevc") {
+        av_opt_set(priv, "preset", config_.preset.c_str(), 0);
+        av_opt_set(priv, "crf", crf.c_str(), 0);
+        if (config_.zeroLatency) {
+            av_opt_set(priv, "tune", "zerolatency", 0);
+        }
+        std::string params;
+        if (config_.frameThreads > 0) {
+            params += "frame-threads=" + std::to_string(config_.frameThreads);
+        }
+        if (config_.sliceThreads > 0) {
+            params += (params.empty() ? "" : ":") + std::string("pools=") +
+                      std::to_string(config_.sliceThreads);
+        }
+        if (!params.empty()) {
+            av_opt_set(priv, "x265-params", params.c_str(), 0);
+        }
+    } else if (config_.codec == "ffv1") {
+        // Level 3 is required for slices; each slice is coded independently on its own thread
+        int requested = config_.sliceThreads > 0 ? config_.sliceThreads : kFfv1DefaultSlices;
+        int slices = kFfv1SliceCounts[0];
+        for (int count : kFfv1SliceCounts) {
+            if (count <= requested) {
+                slices = count;
+            }
+        }
+        codecContext_->level = 3;
+        codecContext_->thread_type = FF_THREAD_SLICE;
+        codecContext_->thread_count = config_.frameThreads > 0 ? config_.frameThreads : slices;
+        av_opt_set(priv, "slices", std::to_string(slices).c_str(), 0);
+        av_opt_set(priv, "slicecrc", "1", 0);
+    } else if (config_.codec == "av1") {
+        av_opt_set(priv, "preset", config_.preset.c_str(), 0);
+        av_opt_set(priv, "crf", crf.c_str(), 0);
+        if (config_.frameThreads > 0) {
+            av_opt_set(priv, "svtav1-params",
+                       ("lp=" + std::to_string(config_.frameThreads)).c_str(), 0);
+        }
+    }
+}
+
 void VideoEncoder::EncodeFrame(EncoderFrame frame) {
-    if (finalized_) {
-        spdlog::warn("Cannot encode frame - encoder already finalized");
+    if (finalized_ || !frameQueue_) {
+        spdlog::warn("Cannot encode frame - encoder not running");
         return;
     }
 
-    std::lock_guard<std::mutex> lock(queueMutex_);
-    frameQueue_.push(std::move(frame));
-    queueCV_.notify_one();
+    switch (queueOptions_.policy) {
+    case QueueFullPolicy::Block:
+        frameQueue_->push(std::move(frame));
+        break;
+    case QueueFullPolicy::DropNewest:
+        if (!frameQueue_->try_push(std::move(frame))) {
+            DropFrame(frame, "encoder_queue_full");
+        }
+        break;
+    case QueueFullPolicy::DropOldest:
+    case QueueFullPolicy::Degrade:
+        // This is the only producer, so a pop makes room unless the encoder is mid-pop
+        while (!frameQueue_->try_push(std::move(frame)) && !frameQueue_->closed()) {
+            EncoderFrame oldest;
+            if (frameQueue_->try_pop(oldest)) {
+                if (queueOptions_.policy == QueueFullPolicy::Degrade) {
+                    RaiseDegradeLevel();
+                }
+                DropFrame(oldest, "encoder_queue_full");
+            }
+        }
+        break;
+    }
+}
+
+void VideoEncoder::DropFrame(const EncoderFrame &frame, const char *reason) {
+    framesDropped_++;
+    if (queueOptions_.onDrop) {
+        queueOptions_.onDrop(frame, reason);
+    }
 }
 
 void VideoEncoder::EncoderThread() {
     spdlog::info("Video encoder thread started");
 
-    while (true) {
-        EncoderFrame frame;
-
-        {
-            std::unique_lock<std::mutex> lock(queueMutex_);
-            queueCV_.wait(lock, [this] { return !frameQueue_.empty() || shouldStop_; });
-
-            if (shouldStop_ && frameQueue_.empty()) {
-                break;
-            }
+    EncoderFrame frame;
+    int sizeMismatches = 0;
+    while (frameQueue_->pop(frame)) {
+        if (queueOptions_.policy == QueueFullPolicy::Degrade) {
+            UpdateDegradeLevel(frameQueue_->size());
+        }
 
-            if (!frameQueue_.empty()) {
-                frame = std::move(frameQueue_.front());
-                frameQueue_.pop();
-            } else {
-                continue;
+        // The stream size is fixed once opened (e.g. the game window was resized); such frames
+        // are reported as dropped, not encoded
+        if (frame.width != width_ || frame.height != height_ ||
+            frame.pixels.size() < static_cast<size_t>(width_) * height_ * 4) {
+            if (sizeMismatches++ == 0) {
+                spdlog::error("Frame {} is {}x{}, encoder expects {}x{} - dropping mismatched "
+                              "frames",
+                              frame.frameNumber, frame.width, frame.height, width_, height_);
             }
+            DropFrame(frame, "size_mismatch");
+            continue;
         }
 
+        auto encodeStart = std::chrono::steady_clock::now();
         if (!EncodeFrameInternal(frame)) {
             spdlog::error("Failed to encode frame {}", framesEncoded_.load());
         }
+        double encodeMs = std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - encodeStart)
+                              .count();
+        lastEncodeMs_ = encodeMs;
+        totalEncodeMs_ = totalEncodeMs_ + encodeMs;
 
         framesEncoded_++;
+        if (queueOptions_.onEncoded) {
+            queueOptions_.onEncoded(frame, encodeMs);
+        }
 
         // Log progress every 60 frames
         if (framesEncoded_ % 60 == 0) {
@@ -212,11 +450,50 @@ void VideoEncoder::EncoderThread() {
         }
     }
 
+    if (sizeMismatches > 0) {
+        spdlog::warn("{} frames dropped for not matching the encoder size", sizeMismatches);
+    }
     spdlog::info("Video encoder thread stopped - {} frames encoded", framesEncoded_.load());
 }
 
+// Called by EncodeFrame when the queue is full
+void VideoEncoder::RaiseDegradeLevel() {
+    std::lock_guard<std::mutex> lock(degradeMutex_);
+    // One step per queue's worth of encoded frames, so a step can take effect first
+    if (degradeLevel_ < kMaxDegradeLevel &&
+        framesEncoded_ - degradeRaisedAt_ >= static_cast<int>(queueOptions_.maxQueueFrames)) {
+        degradeLevel_++;
+        degradeRaisedAt_ = framesEncoded_;
+        calmFrames_ = 0;
+    }
+}
+
+// Called by the encoder thread: step quality back up once the queue has stayed short
+void VideoEncoder::UpdateDegradeLevel(size_t queueSize) {
+    std::lock_guard<std::mutex> lock(degradeMutex_);
+    if (degradeLevel_ == 0 || queueSize > queueOptions_.maxQueueFrames / 4) {
+        calmFrames_ = 0;
+        return;
+    }
+    if (++calmFrames_ >= kCalmFramesToRecover) {
+        degradeLevel_--;
+        calmFrames_ = 0;
+    }
+}
+
 bool VideoEncoder::EncodeFrameInternal(const EncoderFrame &frame) {
     try {
+        // libx264 reconfigures CRF between frames; the preset can't change mid-stream
+        const int degradeLevel = degradeLevel_;
+        if (degradeLevel != appliedDegradeLevel_) {
+            const int crf = config_.crf + degradeLevel * kDegradeCrfStep;
+            av_opt_set(codecContext_->priv_data, "crf", std::to_string(crf).c_str(), 0);
+            spdlog::warn("Encoder queue {} - CRF {} -> {}",
+                         degradeLevel > appliedDegradeLevel_ ? "full" : "recovered",
+                         config_.crf + appliedDegradeLevel_ * kDegradeCrfStep, crf);
+            appliedDegradeLevel_ = degradeLevel;
+        }
+
         // Make frame writable
         int ret = av_frame_make_writable(yuvFrame_);
         if (ret < 0) {
@@ -224,12 +501,21 @@ bool VideoEncoder::EncodeFrameInternal(const EncoderFrame &frame) {
             return false;
         }
 
-        // Convert BGRA to YUV420P
-        const uint8_t *srcData[1] = {frame.pixels.data()};
-        int srcLinesize[1] = {frame.width * 4}; // BGRA = 4 bytes per pixel
-
-        sws_scale(swsContext_, srcData, srcLinesize, 0, frame.height, yuvFrame_->data,
-                  yuvFrame_->linesize);
+        if (yuvConverter_) {
+            YuvPlanes planes;
+            for (int i = 0; i < 3; ++i) {
+                planes.data[i] = yuvFrame_->data[i];
+                planes.linesize[i] = yuvFrame_->linesize[i];
+            }
+            yuvConverter_->Convert(frame.pixels.data(), width_, height_, 0, planes);
+        } else {
+            const size_t rowBytes = static_cast<size_t>(width_) * 4;
+            uint8_t *dst = yuvFrame_->data[0];
+            for (int y = 0; y < height_; ++y) {
+                std::copy_n(frame.pixels.data() + y * rowBytes, rowBytes, dst);
+                dst += yuvFrame_->linesize[0];
+            }
+        }
 
         // Set presentation timestamp using actual capture time for variable FPS
         if (firstFrameTimestamp_ < 0) {
@@ -277,6 +563,16 @@ bool VideoEncoder::EncodeFrameInternal(const EncoderFrame &frame) {
             }
         }
 
+        // Hand finished fragments to the OS so a killed process loses at most one fragment.
+        // The write is a memcpy into the page cache; the fsync happens on the sync thread.
+        if (config_.fragmented && formatContext_->pb) {
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastFlush_ >= std::chrono::milliseconds(config_.fragmentMs)) {
+                avio_flush(formatContext_->pb);
+                lastFlush_ = now;
+            }
+        }
+
         return true;
 
     } catch (const std::exception &e) {
@@ -292,15 +588,25 @@ void VideoEncoder::Finalize() {
 
     spdlog::info("Finalizing video encoder - queue size: {}", GetQueueSize());
 
-    // Signal encoder thread to stop
-    shouldStop_ = true;
-    queueCV_.notify_all();
+    // Close the queue; the encoder thread drains it and stops
+    if (frameQueue_) {
+        frameQueue_->close();
+    }
 
     // Wait for encoder thread
     if (encoderThread_.joinable()) {
         encoderThread_.join();
     }
 
+    if (syncThread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(syncMutex_);
+            stopSync_ = true;
+        }
+        syncCV_.notify_all();
+        syncThread_.join();
+    }
+
     // Flush encoder
     if (codecContext_) {
         avcodec_send_frame(codecContext_, nullptr);
@@ -333,15 +639,28 @@ void VideoEncoder::Finalize() {
 
     spdlog::info("Video encoder finalized");
     spdlog::info("  Total frames: {}", framesEncoded_.load());
+    spdlog::info("  Dropped (queue full): {}", framesDropped_.load());
+    spdlog::info("  Average encode time: {:.2f}ms", GetAverageEncodeMs());
     spdlog::info("  Duration: {:.2f}s", durationSec);
     spdlog::info("  Actual FPS: {:.2f}", actualFps);
 }
 
-void VideoEncoder::CleanupFFmpeg() {
-    if (swsContext_) {
-        sws_freeContext(swsContext_);
-        swsContext_ = nullptr;
+void VideoEncoder::SyncThread() {
+    const auto interval = std::chrono::milliseconds(config_.syncIntervalMs);
+    bool warned = false;
+    std::unique_lock<std::mutex> lock(syncMutex_);
+    while (!syncCV_.wait_for(lock, interval, [this] { return stopSync_; })) {
+        lock.unlock();
+        if (!SyncFile(outputPath_) && !warned) {
+            spdlog::warn("Could not sync {} to disk", outputPath_);
+            warned = true;
+        }
+        lock.lock();
     }
+}
+
+void VideoEncoder::CleanupFFmpeg() {
+    yuvConverter_.reset();
 
     if (yuvFrame_) {
         av_frame_free(&yuvFrame_);
@@ -364,7 +683,40 @@ void VideoEncoder::CleanupFFmpeg() {
     }
 }
 
+double VideoEncoder::GetAverageEncodeMs() const {
+    int frames = framesEncoded_.load();
+    return frames > 0 ? totalEncodeMs_.load() / frames : 0.0;
+}
+
 size_t VideoEncoder::GetQueueSize() const {
-    std::lock_guard<std::mutex> lock(const_cast<std::mutex &>(queueMutex_));
-    return frameQueue_.size();
+    return frameQueue_ ? frameQueue_->size() : 0;
+}
+
+bool VideoEncoder::ParseQueueFullPolicy(const std::string &name, QueueFullPolicy &policy) {
+    if (name == "block") {
+        policy = QueueFullPolicy::Block;
+    } else if (name == "drop_newest") {
+        policy = QueueFullPolicy::DropNewest;
+    } else if (name.empty() || name == "drop_oldest") {
+        policy = QueueFullPolicy::DropOldest;
+    } else if (name == "degrade") {
+        policy = QueueFullPolicy::Degrade;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string VideoEncoder::QueueFullPolicyName(QueueFullPolicy policy) {
+    switch (policy) {
+    case QueueFullPolicy::Block:
+        return "block";
+    case QueueFullPolicy::DropNewest:
+        return "drop_newest";
+    case QueueFullPolicy::Degrade:
+        return "degrade";
+    case QueueFullPolicy::DropOldest:
+    default:
+        return "drop_oldest";
+    }
 }
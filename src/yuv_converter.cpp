@@ -0,0 +1,401 @@
+#include "yuv_converter.h"
+#include "cpu_features.h"
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+
+namespace {
+
+constexpr int kMaxAutoThreads = 4;
+
+using Coefficients = YuvConverter::Coefficients;
+
+uint8_t Clamp8(int value) { return static_cast<uint8_t>(std::clamp(value, 0, 255)); }
+
+// Coefficients for one matrix and range. The green term absorbs rounding so that grey input
+// gives exactly the black-to-white luma scale and neutral chroma.
+Coefficients MakeCoefficients(YuvMatrix matrix, bool fullRange) {
+    const double kr = matrix == YuvMatrix::BT709 ? 0.2126 : 0.299;
+    const double kb = matrix == YuvMatrix::BT709 ? 0.0722 : 0.114;
+    const double yScale = fullRange ? 1.0 : 219.0 / 255.0;
+    const double cScale = fullRange ? 1.0 : 224.0 / 255.0;
+    auto fixed = [](double value) { return static_cast<int>(std::lround(value * 32768.0)); };
+
+    Coefficients c;
+    const int yTotal = fixed(yScale);
+    const int yb = fixed(kb * yScale);
+    const int yr = fixed(kr * yScale);
+    c.y[0] = static_cast<int16_t>(yb);
+    c.y[1] = static_cast<int16_t>(yTotal - yb - yr);
+    c.y[2] = static_cast<int16_t>(yr);
+
+    const int half = fixed(0.5 * cScale);
+    const int ur = -fixed(kr / (2.0 * (1.0 - kb)) * cScale);
+    c.u[0] = static_cast<int16_t>(half);
+    c.u[1] = static_cast<int16_t>(-half - ur);
+    c.u[2] = static_cast<int16_t>(ur);
+
+    const int vb = -fixed(kb / (2.0 * (1.0 - kr)) * cScale);
+    c.v[0] = static_cast<int16_t>(vb);
+    c.v[1] = static_cast<int16_t>(-half - vb);
+    c.v[2] = static_cast<int16_t>(half);
+
+    c.yBias = ((fullRange ? 0 : 16) << 15) + (1 << 14);
+    c.cBias = (128 << 17) + (1 << 16);
+    return c;
+}
+
+// ============================================================================
+// Scalar kernels (reference implementation)
+// ============================================================================
+
+void LumaRowScalar(const uint8_t *src, uint8_t *dst, int begin, int width,
+                   const Coefficients &c) {
+    src += static_cast<size_t>(begin) * 4;
+    for (int x = begin; x < width; ++x) {
+        dst[x] = Clamp8((src[0] * c.y[0] + src[1] * c.y[1] + src[2] * c.y[2] + c.yBias) >> 15);
+        src += 4;
+    }
+}
+
+// Chroma samples [begin, (width + 1) / 2) from two source rows. u and v advance by step, which
+// is 2 for NV12's interleaved plane.
+void ChromaRowScalar(const uint8_t *row0, const uint8_t *row1, uint8_t *u, uint8_t *v, int step,
+                     int begin, int width, const Coefficients &c) {
+    const int chromaWidth = (width + 1) / 2;
+    for (int cx = begin; cx < chromaWidth; ++cx) {
+        const size_t x0 = static_cast<size_t>(cx) * 8;
+        const size_t x1 = std::min(cx * 2 + 1, width - 1) * static_cast<size_t>(4);
+        int sum[3];
+        for (int ch = 0; ch < 3; ++ch) {
+            sum[ch] = row0[x0 + ch] + row0[x1 + ch] + row1[x0 + ch] + row1[x1 + ch];
+        }
+        u[cx * step] =
+            Clamp8((sum[0] * c.u[0] + sum[1] * c.u[1] + sum[2] * c.u[2] + c.cBias) >> 17);
+        v[cx * step] =
+            Clamp8((sum[0] * c.v[0] + sum[1] * c.v[1] + sum[2] * c.v[2] + c.cBias) >> 17);
+    }
+}
+
+// ============================================================================
+// SSE4.1 kernels. Pixels are widened to 16 bits and weighted with pmaddwd, which yields B+G and
+// R per pixel; phaddd then completes each pixel (and, for chroma, each horizontal pair).
+// ============================================================================
+
+SIPHON_TARGET_SSE41 __m128i PixelWeights128(const int16_t w[3]) {
+    return _mm_setr_epi16(w[0], w[1], w[2], 0, w[0], w[1], w[2], 0);
+}
+
+// Weighted sums of 4 BGRA pixels
+SIPHON_TARGET_SSE41 __m128i WeightedSum4SSE41(__m128i lo16, __m128i hi16, __m128i weights) {
+    return _mm_hadd_epi32(_mm_madd_epi16(lo16, weights), _mm_madd_epi16(hi16, weights));
+}
+
+SIPHON_TARGET_SSE41 int LumaRowSSE41(const uint8_t *src, uint8_t *dst, int width,
+                                     const Coefficients &c) {
+    const __m128i weights = PixelWeights128(c.y);
+    const __m128i bias = _mm_set1_epi32(c.yBias);
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4));
+        const __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4 + 16));
+        __m128i a =
+            WeightedSum4SSE41(_mm_cvtepu8_epi16(p0), _mm_unpackhi_epi8(p0, zero), weights);
+        __m128i b =
+            WeightedSum4SSE41(_mm_cvtepu8_epi16(p1), _mm_unpackhi_epi8(p1, zero), weights);
+        a = _mm_srai_epi32(_mm_add_epi32(a, bias), 15);
+        b = _mm_srai_epi32(_mm_add_epi32(b, bias), 15);
+        const __m128i words = _mm_packs_epi32(a, b);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(words, words));
+    }
+    return x;
+}
+
+// 4 chroma samples from 8 columns of two rows; returns bytes U0-3 V0-3 in the low 8 bytes
+SIPHON_TARGET_SSE41 __m128i Chroma4SSE41(const uint8_t *row0, const uint8_t *row1,
+                                         __m128i uWeights, __m128i vWeights, __m128i bias) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i pairs[2][2]; // [half][lo/hi] vertical sums, 2 pixels each
+    for (int half = 0; half < 2; ++half) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + half * 16));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + half * 16));
+        pairs[half][0] = _mm_add_epi16(_mm_cvtepu8_epi16(a), _mm_cvtepu8_epi16(b));
+        pairs[half][1] = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+    }
+    __m128i u = _mm_hadd_epi32(WeightedSum4SSE41(pairs[0][0], pairs[0][1], uWeights),
+                               WeightedSum4SSE41(pairs[1][0], pairs[1][1], uWeights));
+    __m128i v = _mm_hadd_epi32(WeightedSum4SSE41(pairs[0][0], pairs[0][1], vWeights),
+                               WeightedSum4SSE41(pairs[1][0], pairs[1][1], vWeights));
+    u = _mm_srai_epi32(_mm_add_epi32(u, bias), 17);
+    v = _mm_srai_epi32(_mm_add_epi32(v, bias), 17);
+    const __m128i words = _mm_packs_epi32(u, v);
+    return _mm_packus_epi16(words, words);
+}
+
+SIPHON_TARGET_SSE41 int ChromaRowSSE41(const uint8_t *row0, const uint8_t *row1, uint8_t *u,
+                                       uint8_t *v, bool interleaved, int width,
+                                       const Coefficients &c) {
+    const __m128i uWeights = PixelWeights128(c.u);
+    const __m128i vWeights = PixelWeights128(c.v);
+    const __m128i bias = _mm_set1_epi32(c.cBias);
+    int cx = 0;
+    for (; cx * 2 + 8 <= width; cx += 4) {
+        const __m128i uv = Chroma4SSE41(row0 + cx * 8, row1 + cx * 8, uWeights, vWeights, bias);
+        if (interleaved) {
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(u + cx * 2),
+                             _mm_unpacklo_epi8(uv, _mm_srli_si128(uv, 4)));
+        } else {
+            const int32_t uBytes = _mm_cvtsi128_si32(uv);
+            const int32_t vBytes = _mm_extract_epi32(uv, 1);
+            std::copy_n(reinterpret_cast<const uint8_t *>(&uBytes), 4, u + cx);
+            std::copy_n(reinterpret_cast<const uint8_t *>(&vBytes), 4, v + cx);
+        }
+    }
+    return cx;
+}
+
+// ============================================================================
+// AVX2 kernels. Same arithmetic as SSE4.1 on 256-bit vectors; unpack, pack and hadd work per
+// 128-bit lane, so results are put back in order with cross-lane permutes.
+// ============================================================================
+
+SIPHON_TARGET_AVX2 __m256i PixelWeights256(const int16_t w[3]) {
+    return _mm256_setr_epi16(w[0], w[1], w[2], 0, w[0], w[1], w[2], 0, w[0], w[1], w[2], 0, w[0],
+                             w[1], w[2], 0);
+}
+
+// Weighted sums of 8 BGRA pixels, ordered 0-3 | 4-7
+SIPHON_TARGET_AVX2 __m256i WeightedSum8AVX2(__m256i lo16, __m256i hi16, __m256i weights) {
+    return _mm256_hadd_epi32(_mm256_madd_epi16(lo16, weights), _mm256_madd_epi16(hi16, weights));
+}
+
+SIPHON_TARGET_AVX2 int LumaRowAVX2(const uint8_t *src, uint8_t *dst, int width,
+                                   const Coefficients &c) {
+    const __m256i weights = PixelWeights256(c.y);
+    const __m256i bias = _mm256_set1_epi32(c.yBias);
+    const __m256i zero = _mm256_setzero_si256();
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i sums[2];
+        for (int half = 0; half < 2; ++half) {
+            const __m256i px =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + (x + half * 8) * 4));
+            const __m256i sum = WeightedSum8AVX2(_mm256_unpacklo_epi8(px, zero),
+                                                 _mm256_unpackhi_epi8(px, zero), weights);
+            sums[half] = _mm256_srai_epi32(_mm256_add_epi32(sum, bias), 15);
+        }
+        const __m256i words =
+            _mm256_permute4x64_epi64(_mm256_packs_epi32(sums[0], sums[1]), 0xD8); // 0-7 | 8-15
+        const __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm256_castsi256_si128(bytes));
+    }
+    return x;
+}
+
+// 8 chroma samples from 16 columns of two rows; returns U0-7 V0-7 in the low 16 bytes
+SIPHON_TARGET_AVX2 __m128i Chroma8AVX2(const uint8_t *row0, const uint8_t *row1,
+                                       __m256i uWeights, __m256i vWeights, __m256i bias) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i pairs[2][2]; // [half][lo/hi] vertical sums; lo = pixels 0,1 | 4,5, hi = 2,3 | 6,7
+    for (int half = 0; half < 2; ++half) {
+        const __m256i a =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0 + half * 32));
+        const __m256i b =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1 + half * 32));
+        pairs[half][0] =
+            _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+        pairs[half][1] =
+            _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+    }
+    // Horizontal pair sums come out as samples 0,1,4,5 | 2,3,6,7
+    const __m256i order = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+    __m256i u = _mm256_hadd_epi32(WeightedSum8AVX2(pairs[0][0], pairs[0][1], uWeights),
+                                  WeightedSum8AVX2(pairs[1][0], pairs[1][1], uWeights));
+    __m256i v = _mm256_hadd_epi32(WeightedSum8AVX2(pairs[0][0], pairs[0][1], vWeights),
+                                  WeightedSum8AVX2(pairs[1][0], pairs[1][1], vWeights));
+    u = _mm256_srai_epi32(_mm256_add_epi32(_mm256_permutevar8x32_epi32(u, order), bias), 17);
+    v = _mm256_srai_epi32(_mm256_add_epi32(_mm256_permutevar8x32_epi32(v, order), bias), 17);
+    // Words U0-3 V0-3 | U4-7 V4-7, bytes likewise per lane; gather the U and V dwords
+    const __m256i words = _mm256_packs_epi32(u, v);
+    const __m256i bytes = _mm256_packus_epi16(words, words);
+    const __m256i gather = _mm256_setr_epi32(0, 4, 1, 5, 2, 3, 6, 7);
+    return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(bytes, gather));
+}
+
+SIPHON_TARGET_AVX2 int ChromaRowAVX2(const uint8_t *row0, const uint8_t *row1, uint8_t *u,
+                                     uint8_t *v, bool interleaved, int width,
+                                     const Coefficients &c) {
+    const __m256i uWeights = PixelWeights256(c.u);
+    const __m256i vWeights = PixelWeights256(c.v);
+    const __m256i bias = _mm256_set1_epi32(c.cBias);
+    int cx = 0;
+    for (; cx * 2 + 16 <= width; cx += 8) {
+        const __m128i uv = Chroma8AVX2(row0 + cx * 8, row1 + cx * 8, uWeights, vWeights, bias);
+        if (interleaved) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(u + cx * 2),
+                             _mm_unpacklo_epi8(uv, _mm_srli_si128(uv, 8)));
+        } else {
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(u + cx), uv);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(v + cx), _mm_srli_si128(uv, 8));
+        }
+    }
+    return cx;
+}
+
+YuvKernel ResolveKernel(YuvKernel requested) {
+    if ((requested == YuvKernel::Auto || requested == YuvKernel::AVX2) && CpuFeatures::HasAVX2()) {
+        return YuvKernel::AVX2;
+    }
+    if (requested != YuvKernel::Scalar && CpuFeatures::HasSSE41()) {
+        return YuvKernel::SSE41;
+    }
+    return YuvKernel::Scalar;
+}
+
+} // namespace
+
+YuvConverter::YuvConverter(YuvMatrix matrix, bool fullRange, YuvLayout layout, int threads)
+    : coeffs_(MakeCoefficients(matrix, fullRange)), layout_(layout),
+      kernel_(ResolveKernel(YuvKernel::Auto)), src_(nullptr), width_(0), height_(0),
+      srcStride_(0), bandRows_(0), generation_(0), pendingBands_(0), stopping_(false) {
+    if (threads <= 0) {
+        threads = std::clamp(static_cast<int>(std::thread::hardware_concurrency()) / 4, 1,
+                             kMaxAutoThreads);
+    }
+    for (int i = 1; i < threads; ++i) {
+        workers_.emplace_back(&YuvConverter::WorkerLoop, this, workers_.size());
+    }
+}
+
+YuvConverter::~YuvConverter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    workCv_.notify_all();
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+}
+
+void YuvConverter::SetKernel(YuvKernel kernel) { kernel_ = ResolveKernel(kernel); }
+
+void YuvConverter::Convert(const uint8_t *bgra, int width, int height, size_t srcStride,
+                           const YuvPlanes &dst) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    src_ = bgra;
+    width_ = width;
+    height_ = height;
+    srcStride_ = srcStride ? srcStride : static_cast<size_t>(width) * 4;
+    dst_ = dst;
+
+    // Bands start on even rows so each chroma row belongs to exactly one band
+    const int bands = static_cast<int>(workers_.size()) + 1;
+    bandRows_ = ((height + bands - 1) / bands + 1) & ~1;
+    if (!workers_.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pendingBands_ = workers_.size();
+            ++generation_;
+        }
+        workCv_.notify_all();
+    }
+
+    ConvertBand(0);
+
+    if (!workers_.empty()) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        doneCv_.wait(lock, [&] { return pendingBands_ == 0; });
+    }
+}
+
+void YuvConverter::ConvertBand(size_t band) {
+    const int rowBegin = static_cast<int>(band) * bandRows_;
+    const int rowEnd = std::min(rowBegin + bandRows_, height_);
+    const bool interleaved = layout_ == YuvLayout::NV12;
+    const int step = interleaved ? 2 : 1;
+
+    for (int y = rowBegin; y < rowEnd; y += 2) {
+        const uint8_t *row0 = src_ + static_cast<size_t>(y) * srcStride_;
+        const uint8_t *row1 = y + 1 < height_ ? row0 + srcStride_ : row0;
+        uint8_t *luma0 = dst_.data[0] + static_cast<ptrdiff_t>(y) * dst_.linesize[0];
+        uint8_t *luma1 = luma0 + dst_.linesize[0];
+        uint8_t *u = dst_.data[1] + static_cast<ptrdiff_t>(y / 2) * dst_.linesize[1];
+        uint8_t *v = interleaved ? u + 1
+                                 : dst_.data[2] + static_cast<ptrdiff_t>(y / 2) * dst_.linesize[2];
+
+        int lumaDone = 0;
+        int chromaDone = 0;
+        if (kernel_ == YuvKernel::AVX2) {
+            lumaDone = LumaRowAVX2(row0, luma0, width_, coeffs_);
+            if (row1 != row0) {
+                LumaRowAVX2(row1, luma1, width_, coeffs_);
+            }
+            chromaDone = ChromaRowAVX2(row0, row1, u, v, interleaved, width_, coeffs_);
+        } else if (kernel_ == YuvKernel::SSE41) {
+            lumaDone = LumaRowSSE41(row0, luma0, width_, coeffs_);
+            if (row1 != row0) {
+                LumaRowSSE41(row1, luma1, width_, coeffs_);
+            }
+            chromaDone = ChromaRowSSE41(row0, row1, u, v, interleaved, width_, coeffs_);
+        }
+
+        LumaRowScalar(row0, luma0, lumaDone, width_, coeffs_);
+        if (row1 != row0) {
+            LumaRowScalar(row1, luma1, lumaDone, width_, coeffs_);
+        }
+        ChromaRowScalar(row0, row1, u, v, step, chromaDone, width_, coeffs_);
+    }
+}
+
+void YuvConverter::WorkerLoop(size_t worker) {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            workCv_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+        }
+
+        ConvertBand(worker + 1);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pendingBands_ == 0) {
+            doneCv_.notify_one();
+        }
+    }
+}
+
+bool YuvConverter::ParseMatrix(const std::string &name, YuvMatrix &matrix) {
+    if (name == "bt601") {
+        matrix = YuvMatrix::BT601;
+    } else if (name == "bt709") {
+        matrix = YuvMatrix::BT709;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string YuvConverter::MatrixName(YuvMatrix matrix) {
+    return matrix == YuvMatrix::BT709 ? "bt709" : "bt601";
+}
+
+std::string YuvConverter::KernelName(YuvKernel kernel) {
+    switch (kernel) {
+    case YuvKernel::Scalar:
+        return "scalar";
+    case YuvKernel::SSE41:
+        return "sse4.1";
+    case YuvKernel::AVX2:
+        return "avx2";
+    default:
+        return "auto";
+    }
+}